@@ -0,0 +1,291 @@
+#include "UAuthBinClient.h"
+
+#include <QElapsedTimer>
+
+using namespace UAuthBinProtocol;
+
+quint32 UAuthBinClient::makeRequestId()
+{
+    //0 is kept for 'not sent'
+    if(nextRequestId_==0){
+        nextRequestId_=1;
+    }
+    return nextRequestId_++;
+}
+
+bool UAuthBinClient::writeIdent(Writer &writer, const QString &rolePermIdent, QString &lastError) const
+{
+    const auto it {internedIds_.constFind(rolePermIdent)};
+    if(it!=internedIds_.constEnd()){
+        writer.writeInternedIdent(it.value());
+        return true;
+    }
+    if(!writer.writeIdent(rolePermIdent)){
+        lastError=QStringLiteral("Role/permission ident longer than %1 bytes").arg(MaxStringSize);
+        return false;
+    }
+    return true;
+}
+
+bool UAuthBinClient::send(const QByteArray &frame, QString &lastError)
+{
+    if(socket_.state()!=QAbstractSocket::ConnectedState){
+        lastError="Not connected";
+        return false;
+    }
+    socket_.write(frame);
+    socket_.flush();
+    return true;
+}
+
+bool UAuthBinClient::waitForReply(quint32 requestId, MessageType replyType, QByteArray &outReply, QString &lastError)
+{
+    QElapsedTimer elapsedTimer {};
+    elapsedTimer.start();
+    while(!replies_.contains(requestId)){
+        const int remaining {timeout_ - static_cast<int>(elapsedTimer.elapsed())};
+        if(socket_.state()!=QAbstractSocket::ConnectedState){
+            lastError=socket_.errorString();
+            return false;
+        }
+        if(remaining <= 0){
+            //a late reply is dropped instead of piling up
+            abandonedIds_.insert(requestId);
+            lastError=QStringLiteral("Request timed out after %1 ms").arg(timeout_);
+            return false;
+        }
+        socket_.waitForReadyRead(remaining);
+    }
+    outReply=replies_.take(requestId);
+    Reader reader {outReply.constData(),outReply.size()};
+    const MessageType type {static_cast<MessageType>(reader.readUInt8())};
+    reader.readUInt32();
+    if(type==MessageType::ErrorReply){
+        lastError=reader.readString();
+        return false;
+    }
+    if(type!=replyType){
+        lastError=QStringLiteral("Unexpected reply type: %1").arg(static_cast<int>(type));
+        return false;
+    }
+    return true;
+}
+
+void UAuthBinClient::readyReadSlot()
+{
+    buffer_.append(socket_.readAll());
+    int offset {0};
+    while(buffer_.size() - offset >= 4){
+        const quint32 frameSize {qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer_.constData() + offset))};
+        if(frameSize < static_cast<quint32>(FrameHeaderSize) || frameSize > MaxFrameSize){
+            socket_.abort();
+            buffer_.clear();
+            return;
+        }
+        if(static_cast<quint32>(buffer_.size() - offset - 4) < frameSize){
+            break;
+        }
+        const QByteArray reply {buffer_.mid(offset + 4,static_cast<int>(frameSize))};
+        offset+=4 + static_cast<int>(frameSize);
+
+        Reader reader {reply.constData(),reply.size()};
+        const MessageType type {static_cast<MessageType>(reader.readUInt8())};
+        const quint32 requestId {reader.readUInt32()};
+        if(abandonedIds_.remove(requestId)){
+            continue;
+        }
+        if(!asyncRequestIds_.remove(requestId)){
+            replies_.insert(requestId,reply);
+            continue;
+        }
+        if(type==MessageType::CheckReply){
+            policyVersion_=qMax(policyVersion_,reader.readUInt64());
+            const quint8 result {reader.readUInt8()};
+            if(reader.isOk() && result <= static_cast<quint8>(Result::Unavailable)){
+                Q_EMIT checkFinishedSignal(requestId,static_cast<Result>(result));
+                continue;
+            }
+        }
+        Q_EMIT checkFailedSignal(requestId,type==MessageType::ErrorReply ? reader.readString() : QString {"Malformed reply"});
+    }
+    buffer_.remove(0,offset);
+}
+
+UAuthBinClient::UAuthBinClient(QObject *parent)
+    :QObject{parent}
+{
+    QObject::connect(&socket_,&QTcpSocket::readyRead,this,&UAuthBinClient::readyReadSlot);
+}
+
+bool UAuthBinClient::connectToServer(const QString &hostName, quint16 port, QString &lastError)
+{
+    disconnectFromServer();
+    socket_.connectToHost(hostName,port);
+    if(!socket_.waitForConnected(timeout_)){
+        lastError=socket_.errorString();
+        socket_.abort();
+        return false;
+    }
+    socket_.setSocketOption(QAbstractSocket::LowDelayOption,1);
+    return true;
+}
+
+void UAuthBinClient::disconnectFromServer()
+{
+    socket_.abort();
+    buffer_.clear();
+    replies_.clear();
+    asyncRequestIds_.clear();
+    abandonedIds_.clear();
+    //ids are per connection on the server
+    internedIds_.clear();
+}
+
+bool UAuthBinClient::isConnected() const
+{
+    return socket_.state()==QAbstractSocket::ConnectedState;
+}
+
+void UAuthBinClient::setTimeout(int timeout)
+{
+    timeout_=timeout;
+}
+
+bool UAuthBinClient::intern(const QString &rolePermIdent, QString &lastError)
+{
+    if(internedIds_.contains(rolePermIdent)){
+        return true;
+    }
+    const quint32 requestId {makeRequestId()};
+    Writer writer {MessageType::Intern,requestId};
+    if(!writer.writeString(rolePermIdent)){
+        lastError=QStringLiteral("Role/permission ident longer than %1 bytes").arg(MaxStringSize);
+        return false;
+    }
+    QByteArray reply {};
+    if(!send(writer.frame(),lastError) || !waitForReply(requestId,MessageType::InternReply,reply,lastError)){
+        return false;
+    }
+    Reader reader {reply.constData(),reply.size()};
+    reader.readUInt8();
+    reader.readUInt32();
+    const quint32 internedId {reader.readUInt32()};
+    if(!reader.isOk() || internedId==0){
+        lastError="Malformed intern reply";
+        return false;
+    }
+    internedIds_.insert(rolePermIdent,internedId);
+    return true;
+}
+
+bool UAuthBinClient::check(const QUuid &userId, const QString &rolePermIdent, Result &outResult, QString &lastError)
+{
+    const quint32 requestId {makeRequestId()};
+    Writer writer {MessageType::Check,requestId};
+    writer.writeUuid(userId);
+    QByteArray reply {};
+    if(!writeIdent(writer,rolePermIdent,lastError) || !send(writer.frame(),lastError) || !waitForReply(requestId,MessageType::CheckReply,reply,lastError)){
+        return false;
+    }
+    Reader reader {reply.constData(),reply.size()};
+    reader.readUInt8();
+    reader.readUInt32();
+    const quint64 policyVersion {reader.readUInt64()};
+    const quint8 result {reader.readUInt8()};
+    if(!reader.isOk() || result > static_cast<quint8>(Result::Unavailable)){
+        lastError="Malformed check reply";
+        return false;
+    }
+    policyVersion_=qMax(policyVersion_,policyVersion);
+    outResult=static_cast<Result>(result);
+    return true;
+}
+
+bool UAuthBinClient::checkBatch(const QVector<Check> &checks, QVector<Result> &outResults, QString &lastError)
+{
+    outResults=QVector<Result>(checks.size(),Result::Unavailable);
+    //every chunk is sent before the first reply is awaited
+    QVector<quint32> requestIds {};
+    for(int start=0;start<checks.size();start+=MaxBatchSize){
+        const int count {qMin(MaxBatchSize,checks.size() - start)};
+        const quint32 requestId {makeRequestId()};
+        Writer writer {MessageType::Batch,requestId};
+        writer.writeUInt16(static_cast<quint16>(count));
+        for(int i=start;i<start + count;++i){
+            writer.writeUuid(checks.at(i).userId);
+            if(!writeIdent(writer,checks.at(i).rolePermIdent,lastError)){
+                //chunks already sent are answered but nobody waits for them
+                for(const quint32 sentId: requestIds){
+                    abandonedIds_.insert(sentId);
+                }
+                return false;
+            }
+        }
+        if(!send(writer.frame(),lastError)){
+            return false;
+        }
+        requestIds.push_back(requestId);
+    }
+    for(int chunk=0;chunk<requestIds.size();++chunk){
+        QByteArray reply {};
+        if(!waitForReply(requestIds.at(chunk),MessageType::BatchReply,reply,lastError)){
+            for(int i=chunk + 1;i<requestIds.size();++i){
+                abandonedIds_.insert(requestIds.at(i));
+            }
+            return false;
+        }
+        Reader reader {reply.constData(),reply.size()};
+        reader.readUInt8();
+        reader.readUInt32();
+        policyVersion_=qMax(policyVersion_,reader.readUInt64());
+        const int start {chunk * MaxBatchSize};
+        const int count {reader.readUInt16()};
+        if(count!=qMin(MaxBatchSize,checks.size() - start)){
+            lastError="Malformed batch reply";
+            return false;
+        }
+        for(int i=0;i<count;++i){
+            const quint8 result {reader.readUInt8()};
+            outResults[start + i]=result <= static_cast<quint8>(Result::Unavailable) ? static_cast<Result>(result) : Result::Unavailable;
+        }
+        if(!reader.isOk()){
+            lastError="Malformed batch reply";
+            return false;
+        }
+    }
+    return true;
+}
+
+quint32 UAuthBinClient::sendCheck(const QUuid &userId, const QString &rolePermIdent)
+{
+    const quint32 requestId {makeRequestId()};
+    Writer writer {MessageType::Check,requestId};
+    writer.writeUuid(userId);
+    QString lastError {};
+    if(!writeIdent(writer,rolePermIdent,lastError) || !send(writer.frame(),lastError)){
+        return 0;
+    }
+    asyncRequestIds_.insert(requestId);
+    return requestId;
+}
+
+bool UAuthBinClient::waitForChecks(QString &lastError)
+{
+    while(!asyncRequestIds_.isEmpty()){
+        if(socket_.state()!=QAbstractSocket::ConnectedState){
+            lastError=socket_.errorString();
+            return false;
+        }
+        //the timeout applies to each wait for progress, not to the whole pipeline
+        if(!socket_.waitForReadyRead(timeout_)){
+            lastError=QStringLiteral("%1 checks not answered within %2 ms").arg(asyncRequestIds_.size()).arg(timeout_);
+            return false;
+        }
+    }
+    return true;
+}
+
+quint64 UAuthBinClient::policyVersion() const
+{
+    return policyVersion_;
+}
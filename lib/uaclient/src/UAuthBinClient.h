@@ -0,0 +1,83 @@
+#ifndef UAUTHBINCLIENT_H
+#define UAUTHBINCLIENT_H
+
+#include <QSet>
+#include <QHash>
+#include <QUuid>
+#include <QVector>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QTcpSocket>
+
+#include "UAuthBinProtocol.h"
+
+//Client of the binary authorization protocol (UA_AUTHZ_BIN_PORT), see
+//UAuthBinProtocol.h. One connection carries any number of requests: blocking
+//calls wait for their own reply only, 'sendCheck' pipelines without waiting and
+//reports through 'checkFinishedSignal'. Names idents passed to 'intern' go as a
+//4 byte id afterwards. Nothing is cached here, every check reaches the server.
+//Like any QObject it is used from the thread it lives in.
+class UAuthBinClient : public QObject
+{
+    Q_OBJECT
+public:
+    using Result=UAuthBinProtocol::Result;
+
+    //kept an aggregate, so 'Check {userId,rolePermIdent}' works in C++11
+    struct Check{
+        QUuid userId;
+        //role/permission id or space separated names, as in 'authorized-to'
+        QString rolePermIdent;
+    };
+
+private:
+    QTcpSocket socket_ {};
+    QByteArray buffer_ {};
+    quint32 nextRequestId_ {1};
+    int timeout_ {10000};
+    quint64 policyVersion_ {0};
+    QHash<quint32,QByteArray> replies_ {};
+    QSet<quint32> asyncRequestIds_ {};
+    QSet<quint32> abandonedIds_ {};
+    QHash<QString,quint32> internedIds_ {};
+
+    quint32 makeRequestId();
+    bool writeIdent(UAuthBinProtocol::Writer& writer,const QString& rolePermIdent,QString& lastError) const;
+    bool send(const QByteArray& frame,QString& lastError);
+    //Reply Frame Without Size Field, Starting With Its Type
+    bool waitForReply(quint32 requestId,UAuthBinProtocol::MessageType replyType,QByteArray& outReply,QString& lastError);
+
+private Q_SLOTS:
+    void readyReadSlot();
+
+public:
+    explicit UAuthBinClient(QObject* parent=nullptr);
+    ~UAuthBinClient()=default;
+
+    bool connectToServer(const QString& hostName,quint16 port,QString& lastError);
+    void disconnectFromServer();
+    bool isConnected() const;
+    //Timeout Of One Blocking Call In ms
+    void setTimeout(int timeout);
+
+    //Register Ident On Server, Later Checks Of It Send 4 Byte Id Instead
+    bool intern(const QString& rolePermIdent,QString& lastError);
+    //Check One Decision And Wait For It
+    bool check(const QUuid& userId,const QString& rolePermIdent,Result& outResult,QString& lastError);
+    //Check Up To 'MaxBatchSize' Decisions In One Frame
+    bool checkBatch(const QVector<Check>& checks,QVector<Result>& outResults,QString& lastError);
+    //Send Check Without Waiting, Answered By 'checkFinishedSignal' With Returned Id, 0 If Not Sent
+    quint32 sendCheck(const QUuid& userId,const QString& rolePermIdent);
+    //Block Until Every Pipelined Check Is Answered
+    bool waitForChecks(QString& lastError);
+
+    //Policy Version Of Latest Reply
+    quint64 policyVersion() const;
+
+Q_SIGNALS:
+    void checkFinishedSignal(quint32 requestId,UAuthBinProtocol::Result result);
+    void checkFailedSignal(quint32 requestId,const QString& lastError);
+};
+
+#endif // UAUTHBINCLIENT_H
@@ -0,0 +1,247 @@
+#ifndef UAUTHBINPROTOCOL_H
+#define UAUTHBINPROTOCOL_H
+
+//Binary authorization protocol served on UA_AUTHZ_BIN_PORT, shared by uaServer
+//and UAuthBinClient. All integers are big-endian.
+//
+//Frame:
+//  uint32 size          bytes after this field, at most MaxFrameSize
+//  uint8  type          MessageType
+//  uint32 requestId     chosen by the client, echoed in the reply; requests may be
+//                       pipelined, replies are matched by id, not by order
+//  payload
+//
+//Ident (role/permission to check):
+//  uint8 IdentKind, then 16 bytes uuid | uint32 interned id | uint16 size + UTF-8 names
+//
+//Requests and replies:
+//  Check    uuid user(16), ident                -> CheckReply   uint64 policyVersion, uint8 Result
+//  Batch    uint16 count, count*(uuid, ident)   -> BatchReply   uint64 policyVersion, uint16 count, count*uint8 Result
+//  Intern   uint16 size + UTF-8 ident           -> InternReply  uint32 id, valid for the connection
+//  Version  empty                               -> VersionReply uint64 policyVersion
+//  any malformed request                        -> ErrorReply   uint16 size + UTF-8 message
+//Answers are those of 'authorized-to' and 'authz:batch'; a frame that can not be
+//delimited closes the connection.
+
+#include <QUuid>
+#include <QString>
+#include <QRegularExpression>
+#include <QtEndian>
+#include <QtGlobal>
+#include <QByteArray>
+
+namespace UAuthBinProtocol{
+
+const quint32 MaxFrameSize {1024 * 1024};
+//size field excluded
+const int FrameHeaderSize {1 + 4};
+const int MaxBatchSize {1000};
+//uint16 size field of strings
+const int MaxStringSize {0xFFFF};
+
+enum class MessageType : quint8{
+    Check=0x01,
+    Batch=0x02,
+    Intern=0x03,
+    Version=0x04,
+    CheckReply=0x81,
+    BatchReply=0x82,
+    InternReply=0x83,
+    VersionReply=0x84,
+    ErrorReply=0xFF
+};
+
+enum class IdentKind : quint8{
+    Uuid=0,
+    Interned=1,
+    Names=2
+};
+
+enum class Result : quint8{
+    Denied=0,
+    Allowed=1,
+    //user or role/permission unknown, 404 of 'authorized-to'
+    NotFound=2,
+    //server not ready (integrity failed) or database error
+    Unavailable=3
+};
+
+//Appends Big-Endian Fields To Frame
+class Writer
+{
+private:
+    QByteArray data_ {};
+
+public:
+    Writer(MessageType type,quint32 requestId)
+    {
+        data_.reserve(64);
+        writeUInt32(0);
+        writeUInt8(static_cast<quint8>(type));
+        writeUInt32(requestId);
+    }
+
+    void writeUInt8(quint8 value)
+    {
+        data_.append(static_cast<char>(value));
+    }
+
+    void writeUInt16(quint16 value)
+    {
+        const quint16 bigEndian {qToBigEndian(value)};
+        data_.append(reinterpret_cast<const char*>(&bigEndian),sizeof(bigEndian));
+    }
+
+    void writeUInt32(quint32 value)
+    {
+        const quint32 bigEndian {qToBigEndian(value)};
+        data_.append(reinterpret_cast<const char*>(&bigEndian),sizeof(bigEndian));
+    }
+
+    void writeUInt64(quint64 value)
+    {
+        const quint64 bigEndian {qToBigEndian(value)};
+        data_.append(reinterpret_cast<const char*>(&bigEndian),sizeof(bigEndian));
+    }
+
+    void writeUuid(const QUuid& uuid)
+    {
+        data_.append(uuid.toRfc4122());
+    }
+
+    //Oversized Text Is Not Written, The Frame Must Be Dropped
+    bool writeString(const QString& text)
+    {
+        const QByteArray utf8 {text.toUtf8()};
+        if(utf8.size() > MaxStringSize){
+            return false;
+        }
+        writeUInt16(static_cast<quint16>(utf8.size()));
+        data_.append(utf8);
+        return true;
+    }
+
+    //Lowercase Uuid Text Goes As 16 Bytes, Anything Else As Names, Like Http Does
+    bool writeIdent(const QString& rolePermIdent)
+    {
+        static const QRegularExpression uuidRegex {"^([0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12})$"};
+        if(uuidRegex.match(rolePermIdent).hasMatch()){
+            writeUInt8(static_cast<quint8>(IdentKind::Uuid));
+            writeUuid(QUuid{rolePermIdent});
+            return true;
+        }
+        writeUInt8(static_cast<quint8>(IdentKind::Names));
+        return writeString(rolePermIdent);
+    }
+
+    void writeInternedIdent(quint32 internedId)
+    {
+        writeUInt8(static_cast<quint8>(IdentKind::Interned));
+        writeUInt32(internedId);
+    }
+
+    //Complete Frame With Its Size Field
+    QByteArray frame()
+    {
+        qToBigEndian(static_cast<quint32>(data_.size() - 4),reinterpret_cast<uchar*>(data_.data()));
+        return data_;
+    }
+};
+
+//Reads Big-Endian Fields Of One Frame, Any Overrun Sets 'isOk' False For Good
+class Reader
+{
+private:
+    const char* data_ {nullptr};
+    int size_ {0};
+    int position_ {0};
+    bool isOk_ {true};
+
+    bool take(int count)
+    {
+        if(!isOk_ || count > size_ - position_){
+            isOk_=false;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    Reader(const char* data,int size)
+        :data_{data},size_{size}
+    {
+    }
+
+    bool isOk() const
+    {
+        return isOk_;
+    }
+
+    bool atEnd() const
+    {
+        return position_==size_;
+    }
+
+    quint8 readUInt8()
+    {
+        if(!take(1)){
+            return 0;
+        }
+        return static_cast<quint8>(data_[position_++]);
+    }
+
+    quint16 readUInt16()
+    {
+        if(!take(2)){
+            return 0;
+        }
+        const quint16 value {qFromBigEndian<quint16>(reinterpret_cast<const uchar*>(data_ + position_))};
+        position_+=2;
+        return value;
+    }
+
+    quint32 readUInt32()
+    {
+        if(!take(4)){
+            return 0;
+        }
+        const quint32 value {qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(data_ + position_))};
+        position_+=4;
+        return value;
+    }
+
+    quint64 readUInt64()
+    {
+        if(!take(8)){
+            return 0;
+        }
+        const quint64 value {qFromBigEndian<quint64>(reinterpret_cast<const uchar*>(data_ + position_))};
+        position_+=8;
+        return value;
+    }
+
+    QUuid readUuid()
+    {
+        if(!take(16)){
+            return QUuid {};
+        }
+        const QUuid uuid {QUuid::fromRfc4122(QByteArray::fromRawData(data_ + position_,16))};
+        position_+=16;
+        return uuid;
+    }
+
+    QString readString()
+    {
+        const int size {readUInt16()};
+        if(!take(size)){
+            return QString {};
+        }
+        const QString text {QString::fromUtf8(data_ + position_,size)};
+        position_+=size;
+        return text;
+    }
+};
+
+}
+
+#endif // UAUTHBINPROTOCOL_H
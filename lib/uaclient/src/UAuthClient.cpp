@@ -0,0 +1,308 @@
+#include "UAuthClient.h"
+
+#include <QTimer>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QJsonDocument>
+#include <QRegularExpression>
+
+namespace{
+const QByteArray policyVersionHeader {"X-UAuth-Policy-Version"};
+//server accepts up to this many checks per batch
+const int maxBatchSize {1000};
+//long poll window, the server caps it at 60000
+const int watchTimeout {30000};
+}
+
+QNetworkRequest UAuthClient::makeRequest(const QString &path, const QUrlQuery &query) const
+{
+    QUrl url {serverUrl_};
+    //'path' is percent-encoded already
+    url.setPath(url.path(QUrl::FullyEncoded) + path,QUrl::StrictMode);
+    if(!query.isEmpty()){
+        url.setQuery(query);
+    }
+    QNetworkRequest request {url};
+    for(auto it=rawHeaders_.constBegin();it!=rawHeaders_.constEnd();++it){
+        request.setRawHeader(it.key(),it.value());
+    }
+    if(sslEnable_){
+        request.setSslConfiguration(sslConfiguration_);
+    }
+    return request;
+}
+
+bool UAuthClient::waitForReply(QNetworkReply *replyPtr, QByteArray &outBody, QString &lastError)
+{
+    if(!replyPtr->isFinished()){
+        QEventLoop eventLoop {};
+        QTimer timer {};
+        timer.setSingleShot(true);
+        QObject::connect(replyPtr,&QNetworkReply::finished,&eventLoop,&QEventLoop::quit);
+        QObject::connect(&timer,&QTimer::timeout,&eventLoop,&QEventLoop::quit);
+        timer.start(timeout_);
+        eventLoop.exec();
+        if(!replyPtr->isFinished()){
+            replyPtr->abort();
+            replyPtr->deleteLater();
+            lastError=QStringLiteral("Request timed out after %1 ms").arg(timeout_);
+            return false;
+        }
+    }
+    replyPtr->deleteLater();
+    const bool hasVersion {replyPtr->hasRawHeader(policyVersionHeader)};
+    if(hasVersion){
+        updatePolicyVersion(replyPtr->rawHeader(policyVersionHeader).toULongLong());
+    }
+    outBody=replyPtr->readAll();
+    if(replyPtr->error()!=QNetworkReply::NoError){
+        lastError=outBody.isEmpty() ? replyPtr->errorString() : QString::fromUtf8(outBody);
+        return false;
+    }
+    return true;
+}
+
+void UAuthClient::updatePolicyVersion(quint64 policyVersion, bool isCurrent)
+{
+    //a lower version in a plain answer comes from a server that did not apply every change
+    //yet, the watcher answers after its server stayed there for the whole poll, which only
+    //happens when the database was rebuilt and its sequence started over
+    if(policyVersion==policyVersion_ || (policyVersion < policyVersion_ && !isCurrent)){
+        return;
+    }
+    //decisions of other versions are never reused, so they go all at once
+    policyVersion_=policyVersion;
+    decisions_.clear();
+    Q_EMIT policyChangedSignal(policyVersion_);
+}
+
+bool UAuthClient::findDecision(const QString &key, bool &outIsAllowed) const
+{
+    const auto it {decisions_.constFind(key)};
+    if(it==decisions_.constEnd() || it.value().policyVersion!=policyVersion_){
+        return false;
+    }
+    if(!isWatchHealthy_ && QDateTime::currentMSecsSinceEpoch() >= it.value().expiresAt){
+        return false;
+    }
+    outIsAllowed=it.value().isAllowed;
+    return true;
+}
+
+void UAuthClient::storeDecision(const QString &key, bool isAllowed, quint64 policyVersion, int maxAge)
+{
+    //an answer of a lagging server is older than what is already known
+    if(policyVersion!=policyVersion_){
+        return;
+    }
+    if(decisions_.size() >= maxEntries_){
+        decisions_.clear();
+    }
+    Decision decision {};
+    decision.isAllowed=isAllowed;
+    decision.policyVersion=policyVersion;
+    decision.expiresAt=QDateTime::currentMSecsSinceEpoch() + static_cast<qint64>(maxAge) * 1000;
+    decisions_.insert(key,decision);
+}
+
+void UAuthClient::startWatchRequest()
+{
+    if(!isWatching_ || watchReplyPtr_){
+        return;
+    }
+    QUrlQuery query {};
+    query.addQueryItem("after",QString::number(policyVersion_));
+    query.addQueryItem("timeout",QString::number(watchTimeout));
+    watchReplyPtr_=accessManager_.get(makeRequest("/api/v1/u-auth/authz/policy-version",query));
+    QObject::connect(watchReplyPtr_.data(),&QNetworkReply::finished,this,&UAuthClient::watchFinishedSlot);
+}
+
+QString UAuthClient::makeKey(const QString &userId, const QString &rolePermIdent)
+{
+    //only a canonical uuid names the same user in either case, anything else is kept as sent
+    static const QRegularExpression uuidRegex {"^([0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12})$",
+                                               QRegularExpression::CaseInsensitiveOption};
+    const QString keyUserId {uuidRegex.match(userId).hasMatch() ? userId.toLower() : userId};
+    return keyUserId + "\n" + rolePermIdent;
+}
+
+int UAuthClient::getMaxAge(const QNetworkReply *replyPtr)
+{
+    const QList<QByteArray> directives {replyPtr->rawHeader("Cache-Control").split(',')};
+    for(const QByteArray& directive: directives){
+        const QByteArray trimmed {directive.trimmed()};
+        if(trimmed.startsWith("max-age=")){
+            return qMax(trimmed.mid(8).toInt(),0);
+        }
+    }
+    return 0;
+}
+
+void UAuthClient::watchFinishedSlot()
+{
+    QNetworkReply* replyPtr {qobject_cast<QNetworkReply*>(sender())};
+    if(!replyPtr){
+        return;
+    }
+    replyPtr->deleteLater();
+    watchReplyPtr_.clear();
+    if(replyPtr->error()!=QNetworkReply::NoError){
+        //missed changes can not be told apart from none, so cached decisions fall back to max-age
+        isWatchHealthy_=false;
+        QTimer::singleShot(1000,this,&UAuthClient::startWatchRequest);
+        return;
+    }
+    const QJsonObject versionObject {QJsonDocument::fromJson(replyPtr->readAll()).object()};
+    if(!versionObject.contains("policy_version")){
+        isWatchHealthy_=false;
+        QTimer::singleShot(1000,this,&UAuthClient::startWatchRequest);
+        return;
+    }
+    updatePolicyVersion(static_cast<quint64>(versionObject.value("policy_version").toDouble()),true);
+    isWatchHealthy_=true;
+    startWatchRequest();
+}
+
+UAuthClient::UAuthClient(const QUrl &serverUrl, QObject *parent)
+    :QObject{parent},serverUrl_{serverUrl}
+{
+    sslEnable_=serverUrl_.scheme()=="https";
+}
+
+UAuthClient::~UAuthClient()
+{
+    stopWatching();
+}
+
+void UAuthClient::setRawHeader(const QByteArray &name, const QByteArray &value)
+{
+    rawHeaders_.insert(name,value);
+}
+
+void UAuthClient::setSslConfiguration(const QSslConfiguration &sslConfiguration)
+{
+    sslConfiguration_=sslConfiguration;
+    sslEnable_=true;
+}
+
+void UAuthClient::setTimeout(int timeout)
+{
+    timeout_=timeout;
+}
+
+void UAuthClient::setMaxEntries(int maxEntries)
+{
+    maxEntries_=qMax(maxEntries,1);
+}
+
+bool UAuthClient::check(const QString &userId, const QString &rolePermIdent, bool &outIsAllowed, QString &lastError)
+{
+    const QString key {makeKey(userId,rolePermIdent)};
+    if(findDecision(key,outIsAllowed)){
+        return true;
+    }
+    const QString path {QStringLiteral("/api/v1/u-auth/authz/%1/authorized-to/%2")
+                .arg(QString::fromLatin1(QUrl::toPercentEncoding(userId)),QString::fromLatin1(QUrl::toPercentEncoding(rolePermIdent)))};
+    QNetworkReply* replyPtr {accessManager_.get(makeRequest(path))};
+    QByteArray body {};
+    if(!waitForReply(replyPtr,body,lastError)){
+        return false;
+    }
+    const QByteArray answer {body.trimmed()};
+    if(answer!="true" && answer!="false"){
+        lastError=QStringLiteral("Unexpected answer: %1").arg(QString::fromUtf8(answer));
+        return false;
+    }
+    outIsAllowed=answer=="true";
+    //versions start at 0 on a database without changes, so only a missing header keeps it out
+    if(replyPtr->hasRawHeader(policyVersionHeader)){
+        storeDecision(key,outIsAllowed,replyPtr->rawHeader(policyVersionHeader).toULongLong(),getMaxAge(replyPtr));
+    }
+    return true;
+}
+
+bool UAuthClient::checkBatch(const QVector<Check> &checks, QVector<bool> &outIsAllowed, QString &lastError)
+{
+    outIsAllowed=QVector<bool>(checks.size(),false);
+    QVector<int> missedIndexes {};
+    for(int i=0;i<checks.size();++i){
+        bool isAllowed {false};
+        if(findDecision(makeKey(checks.at(i).userId,checks.at(i).rolePermIdent),isAllowed)){
+            outIsAllowed[i]=isAllowed;
+        }
+        else{
+            missedIndexes.push_back(i);
+        }
+    }
+    for(int start=0;start<missedIndexes.size();start+=maxBatchSize){
+        const int count {qMin(maxBatchSize,missedIndexes.size() - start)};
+        QJsonArray checksArray {};
+        for(int i=start;i<start + count;++i){
+            const Check& check {checks.at(missedIndexes.at(i))};
+            checksArray.push_back(QJsonObject {
+                                      {"user_id",check.userId},
+                                      {"role_permission",check.rolePermIdent}
+                                  });
+        }
+        QNetworkRequest request {makeRequest("/api/v1/u-auth/authz:batch")};
+        request.setHeader(QNetworkRequest::ContentTypeHeader,"application/json");
+        const QByteArray requestBody {QJsonDocument(QJsonObject {{"checks",checksArray}}).toJson(QJsonDocument::Compact)};
+        QNetworkReply* replyPtr {accessManager_.post(request,requestBody)};
+        QByteArray body {};
+        if(!waitForReply(replyPtr,body,lastError)){
+            return false;
+        }
+        const QJsonObject resultObject {QJsonDocument::fromJson(body).object()};
+        const QJsonArray resultsArray {resultObject.value("results").toArray()};
+        if(resultsArray.size()!=count){
+            lastError=QStringLiteral("Unexpected batch answer: %1").arg(QString::fromUtf8(body));
+            return false;
+        }
+        const bool hasVersion {resultObject.contains("policy_version")};
+        const quint64 policyVersion {static_cast<quint64>(resultObject.value("policy_version").toDouble())};
+        const int maxAge {getMaxAge(replyPtr)};
+        for(int i=0;i<count;++i){
+            const int checkIndex {missedIndexes.at(start + i)};
+            const QJsonValue resultValue {resultsArray.at(i)};
+            outIsAllowed[checkIndex]=resultValue.toBool(false);
+            //unknown ones are answered with null and not cached
+            if(resultValue.isBool() && hasVersion){
+                const Check& check {checks.at(checkIndex)};
+                storeDecision(makeKey(check.userId,check.rolePermIdent),resultValue.toBool(),policyVersion,maxAge);
+            }
+        }
+    }
+    return true;
+}
+
+quint64 UAuthClient::policyVersion() const
+{
+    return policyVersion_;
+}
+
+void UAuthClient::startWatching()
+{
+    isWatching_=true;
+    startWatchRequest();
+}
+
+void UAuthClient::stopWatching()
+{
+    isWatching_=false;
+    isWatchHealthy_=false;
+    if(watchReplyPtr_){
+        QNetworkReply* replyPtr {watchReplyPtr_.data()};
+        watchReplyPtr_.clear();
+        QObject::disconnect(replyPtr,nullptr,this,nullptr);
+        replyPtr->abort();
+        replyPtr->deleteLater();
+    }
+}
+
+void UAuthClient::clearCache()
+{
+    decisions_.clear();
+}
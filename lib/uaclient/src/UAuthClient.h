@@ -0,0 +1,103 @@
+#ifndef UAUTHCLIENT_H
+#define UAUTHCLIENT_H
+
+#include <QUrl>
+#include <QHash>
+#include <QVector>
+#include <QObject>
+#include <QString>
+#include <QPointer>
+#include <QByteArray>
+#include <QUrlQuery>
+#include <QNetworkRequest>
+#include <QSslConfiguration>
+#include <QNetworkAccessManager>
+
+class QNetworkReply;
+
+//Client of uaServer authorization checks for embedding into other services.
+//One QNetworkAccessManager lives as long as the client, so connections are
+//kept alive between calls. Decisions are cached locally together with the policy
+//version they were made at; once a newer version is seen in any response or by
+//the watcher, the whole cache is dropped. Versions are 'change_log' sequences of the
+//database, the same on every server in front of it, so answers of a server that is
+//behind are not cached; only the watcher may move the version back (rebuilt database).
+//Without a healthy watcher a decision is reused only for the 'max-age' of the
+//server Cache-Control header (UA_AUTHZ_CACHE_MAX_AGE); while the watcher is healthy
+//it is reused until the version changes, regardless of 'max-age'.
+//Like any QObject it is used from the thread it lives in; the watcher needs that
+//thread to run an event loop (blocking calls run one while they wait).
+class UAuthClient : public QObject
+{
+    Q_OBJECT
+public:
+    //kept an aggregate, so 'Check {userId,rolePermIdent}' works in C++11
+    struct Check{
+        QString userId;
+        //role/permission id or space separated names, as in 'authorized-to'
+        QString rolePermIdent;
+    };
+
+private:
+    struct Decision{
+        bool isAllowed {false};
+        quint64 policyVersion {0};
+        qint64 expiresAt {0};
+    };
+
+    QUrl serverUrl_ {};
+    QNetworkAccessManager accessManager_ {};
+    QHash<QByteArray,QByteArray> rawHeaders_ {};
+    QSslConfiguration sslConfiguration_ {};
+    bool sslEnable_ {false};
+    int timeout_ {10000};
+    int maxEntries_ {100000};
+    quint64 policyVersion_ {0};
+    bool isWatching_ {false};
+    bool isWatchHealthy_ {false};
+    QPointer<QNetworkReply> watchReplyPtr_ {};
+    QHash<QString,Decision> decisions_ {};
+
+    QNetworkRequest makeRequest(const QString& path,const QUrlQuery& query=QUrlQuery {}) const;
+    bool waitForReply(QNetworkReply* replyPtr,QByteArray& outBody,QString& lastError);
+    void updatePolicyVersion(quint64 policyVersion,bool isCurrent=false);
+    bool findDecision(const QString& key,bool& outIsAllowed) const;
+    void storeDecision(const QString& key,bool isAllowed,quint64 policyVersion,int maxAge);
+    void startWatchRequest();
+
+    static QString makeKey(const QString& userId,const QString& rolePermIdent);
+    static int getMaxAge(const QNetworkReply* replyPtr);
+
+private Q_SLOTS:
+    void watchFinishedSlot();
+
+public:
+    explicit UAuthClient(const QUrl& serverUrl,QObject* parent=nullptr);
+    ~UAuthClient();
+
+    //Header Sent With Every Request, E.g. 'X-Client-Cert-Dn' Behind A TLS Terminating Proxy
+    void setRawHeader(const QByteArray& name,const QByteArray& value);
+    void setSslConfiguration(const QSslConfiguration& sslConfiguration);
+    //Timeout Of One Blocking Call In ms
+    void setTimeout(int timeout);
+    //Decisions Kept Locally, The Cache Is Dropped When Full
+    void setMaxEntries(int maxEntries);
+
+    //Check One Decision, Served From Cache When Valid
+    bool check(const QString& userId,const QString& rolePermIdent,bool& outIsAllowed,QString& lastError);
+    //Check Many Decisions, Cache Misses Go To Server In 'authz:batch' Requests;
+    //Unknown Users Or Roles/Permissions And Invalid Checks Are Denied Without Caching
+    bool checkBatch(const QVector<Check>& checks,QVector<bool>& outIsAllowed,QString& lastError);
+
+    //Newest Policy Version Seen, 0 Before The First Response
+    quint64 policyVersion() const;
+    //Long Poll 'authz/policy-version' And Drop Cache On Every Change
+    void startWatching();
+    void stopWatching();
+    void clearCache();
+
+Q_SIGNALS:
+    void policyChangedSignal(quint64 policyVersion);
+};
+
+#endif // UAUTHCLIENT_H
@@ -0,0 +1,436 @@
+#ifndef SHAREDPOLICY_H
+#define SHAREDPOLICY_H
+
+//Header-only reader of the compiled policy uaServer publishes into a shared
+//memory segment (UA_AUTHZ_SHM_PATH, a file on tmpfs such as /dev/shm/uauth-policy).
+//Answers the same question as 'GET /users/<id>/authorized-to' without a syscall
+//once the segment is mapped. Depends on the C++11 standard library and the OS only.
+//
+//Segment layout, all offsets are from the segment start:
+//  SegmentHeader, padded to 64 bytes
+//  uint64 bitmaps, 'wordsPerUser' words per user row, bit N set if the user holds
+//  role/permission N directly or through the hierarchy
+//  IndexEntry[rolePermCount] sorted by id, 'value' is the role/permission number
+//  IndexEntry[rolePermCount] sorted by name, 'value' is the role/permission number
+//  IndexEntry[userCount] sorted by lowercase user id, 'value' is the user row,
+//  'flags' has FlagSuperuser for holders of 'UAuthAdmin'
+//  UTF-8 strings referenced by the index entries
+//Entries are sorted by unsigned bytewise comparison.
+//
+//The writer makes 'sequence' odd before touching the segment and even again after,
+//readers retry while it is odd or changed under them (seqlock). Every offset is
+//checked against the mapping, so a torn read yields a retry, never a fault.
+//
+//Outside the seqlock the writer refreshes 'heartbeat' (ms since epoch) about once a
+//second while the segment holds the current policy and sets StateUnavailable on
+//orderly shutdown. Readers answer 'Unavailable' in both cases and when the heartbeat
+//is older than their maximum age, so a stopped or stuck uaServer is never trusted.
+//
+//A reader that finds the segment not live, not yet created or of another capacity
+//opens the path again, at most once per 'ReopenInterval', and maps it anew when the
+//file was recreated or resized, so a restarted uaServer is picked up without
+//restarting the reader. The remap makes a reader unsafe to share: use one per thread.
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace uashm{
+
+const std::uint32_t SegmentMagic {0x55415348};
+const std::uint32_t SegmentFormatVersion {2};
+const std::uint32_t FlagSuperuser {1};
+const std::uint32_t StateAvailable {0};
+const std::uint32_t StateUnavailable {1};
+
+struct SegmentHeader
+{
+    std::uint32_t magic;
+    std::uint32_t formatVersion;
+    std::atomic<std::uint64_t> sequence;
+    std::uint64_t capacity;
+    std::uint64_t policyVersion;
+    std::uint32_t rolePermCount;
+    std::uint32_t userCount;
+    std::uint32_t wordsPerUser;
+    std::uint32_t bitmapOffset;
+    std::uint32_t idIndexOffset;
+    std::uint32_t nameIndexOffset;
+    std::uint32_t userIndexOffset;
+    std::uint32_t stringsOffset;
+    std::atomic<std::uint64_t> heartbeat;
+    std::atomic<std::uint32_t> state;
+};
+
+struct IndexEntry
+{
+    std::uint32_t stringOffset;
+    std::uint32_t stringSize;
+    std::uint32_t value;
+    std::uint32_t flags;
+};
+
+const std::uint32_t HeaderSize {128};
+//ms between attempts to open a segment that is not live again
+const std::uint64_t ReopenInterval {1000};
+static_assert(sizeof(SegmentHeader) <= HeaderSize,"SegmentHeader must fit its slot");
+
+//Milliseconds Since Epoch As Written To 'heartbeat'
+inline std::uint64_t currentHeartbeat()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+//Unsigned Bytewise Order Used For All Sorted Indexes
+inline int compareBytes(const char* lhs,std::size_t lhsSize,const char* rhs,std::size_t rhsSize)
+{
+    const int result {std::memcmp(lhs,rhs,lhsSize < rhsSize ? lhsSize : rhsSize)};
+    if(result!=0){
+        return result;
+    }
+    return lhsSize < rhsSize ? -1 : (lhsSize > rhsSize ? 1 : 0);
+}
+
+class SharedPolicyReader
+{
+public:
+    enum class Result{
+        Allowed,
+        Denied,
+        //segment missing, being rewritten too long, inconsistent, given up by uaServer or
+        //not refreshed within the maximum age, ask uaServer over http
+        Unavailable
+    };
+
+private:
+    std::string segmentPath_ {};
+    const unsigned char* data_ {nullptr};
+    std::size_t size_ {0};
+    //identity of the mapped file, a recreated segment differs in it
+#ifdef _WIN32
+    HANDLE mappingHandle_ {nullptr};
+    DWORD volumeSerial_ {0};
+    DWORD fileIndexHigh_ {0};
+    DWORD fileIndexLow_ {0};
+#else
+    dev_t device_ {0};
+    ino_t inode_ {0};
+#endif
+    int maxRetries_ {1000};
+    std::uint64_t maxAge_ {5000};
+    std::uint64_t lastReopen_ {0};
+
+    const SegmentHeader* header() const
+    {
+        return reinterpret_cast<const SegmentHeader*>(data_);
+    }
+
+    //Writer Is Alive And The Segment Holds Its Current Policy
+    bool isLive() const
+    {
+        if(header()->state.load(std::memory_order_acquire)!=StateAvailable){
+            return false;
+        }
+        const std::uint64_t heartbeat {header()->heartbeat.load(std::memory_order_relaxed)};
+        const std::uint64_t now {currentHeartbeat()};
+        //a heartbeat ahead of the clock is only accepted within the same bound
+        return heartbeat > now ? heartbeat - now <= maxAge_ : now - heartbeat <= maxAge_;
+    }
+
+    void unmap()
+    {
+#ifdef _WIN32
+        if(data_){
+            UnmapViewOfFile(data_);
+        }
+        if(mappingHandle_){
+            CloseHandle(mappingHandle_);
+        }
+        mappingHandle_=nullptr;
+#else
+        if(data_){
+            munmap(const_cast<unsigned char*>(data_),size_);
+        }
+#endif
+        data_=nullptr;
+        size_=0;
+    }
+
+    //Map Segment Unless The Same File Of The Same Size Is Mapped, The Old Mapping Stays If That Fails
+    void map()
+    {
+#ifdef _WIN32
+        HANDLE fileHandle {CreateFileA(segmentPath_.c_str(),GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                       nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr)};
+        if(fileHandle==INVALID_HANDLE_VALUE){
+            return;
+        }
+        BY_HANDLE_FILE_INFORMATION fileInfo {};
+        LARGE_INTEGER fileSize {};
+        if(GetFileInformationByHandle(fileHandle,&fileInfo) && GetFileSizeEx(fileHandle,&fileSize) && fileSize.QuadPart >= HeaderSize){
+            const bool isMapped {data_ && fileInfo.dwVolumeSerialNumber==volumeSerial_ && fileInfo.nFileIndexHigh==fileIndexHigh_
+                        && fileInfo.nFileIndexLow==fileIndexLow_ && static_cast<std::size_t>(fileSize.QuadPart)==size_};
+            HANDLE mappingHandle {isMapped ? nullptr : CreateFileMappingA(fileHandle,nullptr,PAGE_READONLY,0,0,nullptr)};
+            if(mappingHandle){
+                const unsigned char* data {static_cast<const unsigned char*>(MapViewOfFile(mappingHandle,FILE_MAP_READ,0,0,0))};
+                if(data){
+                    unmap();
+                    data_=data;
+                    size_=static_cast<std::size_t>(fileSize.QuadPart);
+                    mappingHandle_=mappingHandle;
+                    volumeSerial_=fileInfo.dwVolumeSerialNumber;
+                    fileIndexHigh_=fileInfo.nFileIndexHigh;
+                    fileIndexLow_=fileInfo.nFileIndexLow;
+                }
+                else{
+                    CloseHandle(mappingHandle);
+                }
+            }
+        }
+        CloseHandle(fileHandle);
+#else
+        const int fd {open(segmentPath_.c_str(),O_RDONLY)};
+        if(fd < 0){
+            return;
+        }
+        struct stat fileStat {};
+        if(fstat(fd,&fileStat)==0 && fileStat.st_size >= static_cast<off_t>(HeaderSize)){
+            const bool isMapped {data_ && fileStat.st_dev==device_ && fileStat.st_ino==inode_
+                        && static_cast<std::size_t>(fileStat.st_size)==size_};
+            void* mapped {isMapped ? MAP_FAILED : mmap(nullptr,static_cast<std::size_t>(fileStat.st_size),PROT_READ,MAP_SHARED,fd,0)};
+            if(mapped!=MAP_FAILED){
+                unmap();
+                data_=static_cast<const unsigned char*>(mapped);
+                size_=static_cast<std::size_t>(fileStat.st_size);
+                device_=fileStat.st_dev;
+                inode_=fileStat.st_ino;
+            }
+        }
+        //the mapping stays valid after the descriptor is closed
+        close(fd);
+#endif
+    }
+
+    //Live Mapping, Reopened When Missing, Stale Or Of Another Capacity
+    bool ensureLive()
+    {
+        if(data_ && isLive() && header()->capacity==size_){
+            return true;
+        }
+        const std::uint64_t now {currentHeartbeat()};
+        //a clock set back does not delay the next attempt
+        if(now >= lastReopen_ && now - lastReopen_ < ReopenInterval){
+            return data_ && isLive();
+        }
+        lastReopen_=now;
+        map();
+        return data_ && isLive();
+    }
+
+    bool isInBounds(std::uint64_t offset,std::uint64_t size) const
+    {
+        return offset <= size_ && size <= size_ - offset;
+    }
+
+    //Binary Search Of 'key' In Sorted Index, False If Absent Or Out Of Bounds
+    bool find(std::uint32_t indexOffset,std::uint32_t count,const std::string& key,IndexEntry& outEntry) const
+    {
+        if(!isInBounds(indexOffset,static_cast<std::uint64_t>(count) * sizeof(IndexEntry))){
+            return false;
+        }
+        const IndexEntry* entries {reinterpret_cast<const IndexEntry*>(data_ + indexOffset)};
+        std::uint32_t low {0};
+        std::uint32_t high {count};
+        while(low < high){
+            const std::uint32_t middle {low + (high - low) / 2};
+            const IndexEntry entry {entries[middle]};
+            if(!isInBounds(entry.stringOffset,entry.stringSize)){
+                return false;
+            }
+            const int result {compareBytes(reinterpret_cast<const char*>(data_ + entry.stringOffset),entry.stringSize,
+                                           key.data(),key.size())};
+            if(result==0){
+                outEntry=entry;
+                return true;
+            }
+            if(result < 0){
+                low=middle + 1;
+            }
+            else{
+                high=middle;
+            }
+        }
+        return false;
+    }
+
+    static bool isUuid(const std::string& ident)
+    {
+        if(ident.size()!=36){
+            return false;
+        }
+        for(std::size_t i=0;i<ident.size();++i){
+            const char c {ident[i]};
+            const bool isDash {i==8 || i==13 || i==18 || i==23};
+            if(isDash ? c!='-' : !((c>='0' && c<='9') || (c>='a' && c<='f'))){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //One Unsynchronized Pass Over Segment, Only Trusted If Sequence Did Not Move
+    Result check(const std::string& userId,const std::string& rolePermIdent) const
+    {
+        const SegmentHeader* segmentHeader {header()};
+        if(segmentHeader->magic!=SegmentMagic || segmentHeader->formatVersion!=SegmentFormatVersion
+                || segmentHeader->capacity!=size_){
+            return Result::Unavailable;
+        }
+        IndexEntry userEntry {};
+        if(!find(segmentHeader->userIndexOffset,segmentHeader->userCount,userId,userEntry)){
+            return Result::Denied;
+        }
+        if(userEntry.flags & FlagSuperuser){
+            return Result::Allowed;
+        }
+        const std::uint64_t wordsPerUser {segmentHeader->wordsPerUser};
+        const std::uint64_t rowOffset {segmentHeader->bitmapOffset + static_cast<std::uint64_t>(userEntry.value) * wordsPerUser * 8};
+        if(!isInBounds(rowOffset,wordsPerUser * 8)){
+            return Result::Unavailable;
+        }
+        const std::uint64_t* row {reinterpret_cast<const std::uint64_t*>(data_ + rowOffset)};
+        const auto isHeld=[&](std::uint32_t rolePermNo)->bool{
+            return rolePermNo / 64 < wordsPerUser && (row[rolePermNo / 64] >> (rolePermNo % 64) & 1)!=0;
+        };
+
+        if(isUuid(rolePermIdent)){
+            IndexEntry rolePermEntry {};
+            if(!find(segmentHeader->idIndexOffset,segmentHeader->rolePermCount,rolePermIdent,rolePermEntry)){
+                return Result::Denied;
+            }
+            return isHeld(rolePermEntry.value) ? Result::Allowed : Result::Denied;
+        }
+        //space separated names, all known ones must be held, unknown ones are skipped
+        bool isAnyKnown {false};
+        std::size_t start {0};
+        while(start <= rolePermIdent.size()){
+            std::size_t end {rolePermIdent.find(' ',start)};
+            if(end==std::string::npos){
+                end=rolePermIdent.size();
+            }
+            const std::string name {rolePermIdent.substr(start,end - start)};
+            IndexEntry rolePermEntry {};
+            if(find(segmentHeader->nameIndexOffset,segmentHeader->rolePermCount,name,rolePermEntry)){
+                if(!isHeld(rolePermEntry.value)){
+                    return Result::Denied;
+                }
+                isAnyKnown=true;
+            }
+            start=end + 1;
+        }
+        return isAnyKnown ? Result::Allowed : Result::Denied;
+    }
+
+public:
+    explicit SharedPolicyReader(const std::string& segmentPath)
+        :segmentPath_{segmentPath}
+    {
+        map();
+        lastReopen_=currentHeartbeat();
+    }
+
+    ~SharedPolicyReader()
+    {
+        unmap();
+    }
+
+    SharedPolicyReader(const SharedPolicyReader&)=delete;
+    SharedPolicyReader& operator=(const SharedPolicyReader&)=delete;
+
+    bool isOpen() const
+    {
+        return data_!=nullptr;
+    }
+
+    //Retries Before A Check Gives Up With 'Unavailable' While The Segment Is Rewritten
+    void setMaxRetries(int maxRetries)
+    {
+        maxRetries_=maxRetries;
+    }
+
+    //Oldest Heartbeat In ms Still Trusted, uaServer Refreshes It About Once A Second
+    void setMaxAge(std::uint64_t maxAge)
+    {
+        maxAge_=maxAge;
+    }
+
+    //Policy Version The Segment Was Compiled From, 0 If Unavailable
+    std::uint64_t policyVersion()
+    {
+        if(!ensureLive()){
+            return 0;
+        }
+        for(int i=0;i<maxRetries_;++i){
+            const std::uint64_t sequence {header()->sequence.load(std::memory_order_acquire)};
+            //0 is a segment nothing was published into yet
+            if(sequence==0){
+                return 0;
+            }
+            if(sequence & 1){
+                continue;
+            }
+            const std::uint64_t version {header()->policyVersion};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(header()->sequence.load(std::memory_order_relaxed)==sequence){
+                return version;
+            }
+        }
+        return 0;
+    }
+
+    //Same Answer As 'authorized-to': Id Or Space Separated Names, Superusers Hold Everything
+    Result isAuthorized(const std::string& userId,const std::string& rolePermIdent)
+    {
+        if(!ensureLive()){
+            return Result::Unavailable;
+        }
+        std::string lowerUserId {userId};
+        for(char& c: lowerUserId){
+            if(c>='A' && c<='Z'){
+                c=static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        for(int i=0;i<maxRetries_;++i){
+            const std::uint64_t sequence {header()->sequence.load(std::memory_order_acquire)};
+            if(sequence==0){
+                return Result::Unavailable;
+            }
+            if(sequence & 1){
+                continue;
+            }
+            const Result result {check(lowerUserId,rolePermIdent)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(header()->sequence.load(std::memory_order_relaxed)==sequence){
+                return result;
+            }
+        }
+        return Result::Unavailable;
+    }
+};
+
+}
+
+#endif // SHAREDPOLICY_H
@@ -0,0 +1,223 @@
+#include <QHash>
+#include <QUuid>
+#include <QtCore>
+#include <QString>
+#include <QVector>
+#include <QEventLoop>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+#include <QNetworkRequest>
+#include <QCommandLineParser>
+#include <QNetworkAccessManager>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include "../Version.h"
+#include "UAuthBinClient.h"
+
+//Same 'authorized-to' check over keep-alive http and over the binary protocol,
+//once one request at a time (latency) and once with 'pipeline' requests in flight
+//(throughput). Decisions come from the server caches after the first request,
+//so the difference is the protocol cost.
+
+struct BenchResult
+{
+    QString name {};
+    int requests {0};
+    int failed {0};
+    qint64 elapsedNs {0};
+    QVector<qint64> latenciesNs {};
+};
+
+void printResult(BenchResult& result)
+{
+    std::sort(result.latenciesNs.begin(),result.latenciesNs.end());
+    const auto percentile {[&](double part)->qint64{
+            if(result.latenciesNs.isEmpty()){
+                return 0;
+            }
+            const int index {qMin(static_cast<int>(part * result.latenciesNs.size()),result.latenciesNs.size() - 1)};
+            return result.latenciesNs.at(index) / 1000;
+        }
+    };
+    const double seconds {result.elapsedNs / 1e9};
+    std::cout<<result.name.leftJustified(24).toStdString()
+             <<" requests: "<<result.requests
+             <<" failed: "<<result.failed
+             <<" req/s: "<<static_cast<qint64>(seconds > 0 ? result.requests / seconds : 0)
+             <<" p50: "<<percentile(0.5)<<" us"
+             <<" p99: "<<percentile(0.99)<<" us"<<std::endl;
+}
+
+BenchResult benchHttp(const QUrl& url,int requests,int pipeline)
+{
+    BenchResult result {};
+    result.name=QStringLiteral("http pipeline=%1").arg(pipeline);
+    result.requests=requests;
+    result.latenciesNs.reserve(requests);
+    QNetworkAccessManager accessManager {};
+    //no http pipelining, requests in flight are spread over up to 6 connections by QNetworkAccessManager
+    const QNetworkRequest request {url};
+
+    QEventLoop eventLoop {};
+    QElapsedTimer elapsedTimer {};
+    QHash<QNetworkReply*,qint64> startedAt {};
+    int sent {0};
+    int finished {0};
+    std::function<void()> sendNext {};
+    sendNext=[&](){
+        QNetworkReply* replyPtr {accessManager.get(request)};
+        startedAt.insert(replyPtr,elapsedTimer.nsecsElapsed());
+        ++sent;
+        QObject::connect(replyPtr,&QNetworkReply::finished,[&,replyPtr](){
+            result.latenciesNs.push_back(elapsedTimer.nsecsElapsed() - startedAt.take(replyPtr));
+            if(replyPtr->error()!=QNetworkReply::NoError){
+                ++result.failed;
+            }
+            replyPtr->deleteLater();
+            if(++finished==requests){
+                eventLoop.quit();
+                return;
+            }
+            if(sent < requests){
+                sendNext();
+            }
+        });
+    };
+    elapsedTimer.start();
+    for(int i=0;i<qMin(pipeline,requests);++i){
+        sendNext();
+    }
+    eventLoop.exec();
+    result.elapsedNs=elapsedTimer.nsecsElapsed();
+    return result;
+}
+
+BenchResult benchBinary(UAuthBinClient& binClient,const QUuid& userId,const QString& rolePermIdent,int requests,int pipeline)
+{
+    BenchResult result {};
+    result.name=QStringLiteral("binary pipeline=%1").arg(pipeline);
+    result.requests=requests;
+    result.latenciesNs.reserve(requests);
+    QElapsedTimer elapsedTimer {};
+    elapsedTimer.start();
+    if(pipeline <= 1){
+        for(int i=0;i<requests;++i){
+            const qint64 startedAt {elapsedTimer.nsecsElapsed()};
+            UAuthBinClient::Result checkResult {UAuthBinClient::Result::Unavailable};
+            QString lastError {};
+            if(!binClient.check(userId,rolePermIdent,checkResult,lastError)){
+                ++result.failed;
+            }
+            result.latenciesNs.push_back(elapsedTimer.nsecsElapsed() - startedAt);
+        }
+        result.elapsedNs=elapsedTimer.nsecsElapsed();
+        return result;
+    }
+    QHash<quint32,qint64> startedAt {};
+    int sent {0};
+    const auto sendNext {[&](){
+            const qint64 sentAt {elapsedTimer.nsecsElapsed()};
+            const quint32 requestId {binClient.sendCheck(userId,rolePermIdent)};
+            ++sent;
+            if(requestId==0){
+                ++result.failed;
+                return;
+            }
+            startedAt.insert(requestId,sentAt);
+        }
+    };
+    const auto onReply {[&](quint32 requestId){
+            result.latenciesNs.push_back(elapsedTimer.nsecsElapsed() - startedAt.take(requestId));
+            if(sent < requests){
+                sendNext();
+            }
+        }
+    };
+    const QMetaObject::Connection finishedConnection {QObject::connect(&binClient,&UAuthBinClient::checkFinishedSignal,
+                                                                       [&](quint32 requestId,UAuthBinClient::Result){
+        onReply(requestId);
+    })};
+    const QMetaObject::Connection failedConnection {QObject::connect(&binClient,&UAuthBinClient::checkFailedSignal,
+                                                                     [&](quint32 requestId,const QString&){
+        ++result.failed;
+        onReply(requestId);
+    })};
+    for(int i=0;i<qMin(pipeline,requests);++i){
+        sendNext();
+    }
+    QString lastError {};
+    if(!binClient.waitForChecks(lastError)){
+        std::cerr<<lastError.toStdString()<<std::endl;
+    }
+    result.elapsedNs=elapsedTimer.nsecsElapsed();
+    QObject::disconnect(finishedConnection);
+    QObject::disconnect(failedConnection);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QString appVersion {APP_VERSION};
+    app.setApplicationVersion(appVersion);
+
+    QCommandLineParser parser {};
+    parser.addVersionOption();
+    parser.addHelpOption();
+    parser.addOptions({
+        {"host","uaServer host, default 127.0.0.1","string","127.0.0.1"},
+        {"http-port","Http port (UA_PORT), default 8030","number","8030"},
+        {"bin-port","Binary authz port (UA_AUTHZ_BIN_PORT), default 8031","number","8031"},
+        {"user","User id to check","string"},
+        {"role-permission","Role/permission id or space separated names to check","string"},
+        {"requests","Requests per run, default 10000","number","10000"},
+        {"pipeline","Requests in flight for throughput runs, default 32","number","32"}
+    });
+    if(!parser.parse(app.arguments())){
+        std::cerr<<parser.errorText().toStdString()<<std::endl;
+        return 1;
+    }
+    parser.process(app);
+    if(!parser.isSet("user") || !parser.isSet("role-permission")){
+        std::cerr<<"Options 'user' and 'role-permission' are required"<<std::endl;
+        return 1;
+    }
+    const QString hostName {parser.value("host")};
+    const QUuid userId {parser.value("user")};
+    const QString rolePermIdent {parser.value("role-permission")};
+    const int requests {qMax(parser.value("requests").toInt(),1)};
+    const int pipeline {qMax(parser.value("pipeline").toInt(),1)};
+
+    QUrl url {};
+    url.setScheme("http");
+    url.setHost(hostName);
+    url.setPort(parser.value("http-port").toInt());
+    url.setPath(QStringLiteral("/api/v1/u-auth/authz/%1/authorized-to/%2")
+                .arg(userId.toString(QUuid::WithoutBraces),QString::fromLatin1(QUrl::toPercentEncoding(rolePermIdent))),QUrl::StrictMode);
+
+    UAuthBinClient binClient {};
+    QString lastError {};
+    if(!binClient.connectToServer(hostName,static_cast<quint16>(parser.value("bin-port").toUInt()),lastError)){
+        std::cerr<<lastError.toStdString()<<std::endl;
+        return 1;
+    }
+    if(QUuid(rolePermIdent).isNull() && !binClient.intern(rolePermIdent,lastError)){
+        std::cerr<<lastError.toStdString()<<std::endl;
+        return 1;
+    }
+
+    //warm up server caches and connections, not reported
+    benchHttp(url,qMin(requests,100),1);
+    benchBinary(binClient,userId,rolePermIdent,qMin(requests,100),1);
+
+    QVector<BenchResult> results {};
+    results.push_back(benchHttp(url,requests,1));
+    results.push_back(benchBinary(binClient,userId,rolePermIdent,requests,1));
+    results.push_back(benchHttp(url,requests,pipeline));
+    results.push_back(benchBinary(binClient,userId,rolePermIdent,requests,pipeline));
+    for(BenchResult& result: results){
+        printResult(result);
+    }
+    return 0;
+}
@@ -1,8 +1,155 @@
 #include "Bootloader.h"
 #include "http/HttpServer.h"
+#include "http/SocketHandoff.h"
 #include "ucontrol/Controller.h"
+#include <QTimer>
 #include <QSettings>
 
+bool Bootloader::listen(const QMultiHash<QString, qintptr> &inheritedSockets, QString &lastError)
+{
+    const QString serverAddress  {appSettingsPtr_->value("UA_HOST").toString()};
+    const qint32 serverPort {appSettingsPtr_->value("UA_PORT").toInt()};
+    {//http
+        const QList<qintptr> socketDescriptors {inheritedSockets.values("http")};
+        //more than 1 spreads accepting over that many threads with SO_REUSEPORT
+        const int listenerCount {appSettingsPtr_->value("UA_HTTP_LISTENERS",1).toInt()};
+        if(socketDescriptors.size() > 1){
+            if(!httpServerPtr_->listenReusePort(socketDescriptors.toVector(),lastError)){
+                return false;
+            }
+        }
+        else if(socketDescriptors.size()==1){
+            if(!httpServerPtr_->setSocketDescriptor(socketDescriptors.first())){
+                lastError=httpServerPtr_->errorString();
+                return false;
+            }
+            qInfo("HttpServer inherited at: %s:%d",qPrintable(httpServerPtr_->serverAddress().toString()),httpServerPtr_->serverPort());
+        }
+        else if(listenerCount > 1){
+            if(!httpServerPtr_->listenReusePort(QHostAddress(serverAddress),serverPort,listenerCount,lastError)){
+                return false;
+            }
+        }
+        else{
+            const bool isListenOk {httpServerPtr_->listen(QHostAddress(serverAddress),serverPort)};
+            if(!isListenOk){
+                lastError=httpServerPtr_->errorString();
+                return false;
+            }
+            qInfo("HttpServer started at: %s:%d",qPrintable(httpServerPtr_->serverAddress().toString()),httpServerPtr_->serverPort());
+        }
+    }
+    {//binary authorization protocol, 0 or unset leaves it off unless inherited
+        const qint32 authzBinPort {appSettingsPtr_->value("UA_AUTHZ_BIN_PORT",0).toInt()};
+        if(inheritedSockets.contains("authz-bin")){
+            if(!httpServerPtr_->listenAuthzBin(inheritedSockets.value("authz-bin"),lastError)){
+                return false;
+            }
+        }
+        else if(authzBinPort > 0){
+            if(!httpServerPtr_->listenAuthzBin(QHostAddress(serverAddress),authzBinPort,lastError)){
+                return false;
+            }
+        }
+    }
+    {//unix domain socket
+        const QString unixSocketPath {appSettingsPtr_->value("UA_UNIX_SOCKET").toString()};
+        if(inheritedSockets.contains("unix")){
+            if(!httpServerPtr_->listenLocal(inheritedSockets.value("unix"),lastError)){
+                return false;
+            }
+        }
+        else if(!unixSocketPath.isEmpty()){
+            if(!httpServerPtr_->listenLocal(unixSocketPath,appSettingsPtr_->value("UA_UNIX_SOCKET_MODE","660").toString(),lastError)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void Bootloader::startHandoff()
+{
+    const QString handoffPath {appSettingsPtr_->value("UA_HANDOFF_SOCKET").toString()};
+    if(handoffPath.isEmpty()){
+        return;
+    }
+    socketHandoffPtr_.reset(new SocketHandoff);
+    QString lastError {};
+    if(!socketHandoffPtr_->listen(handoffPath,lastError)){
+        //serving goes on, only the next restart binds anew
+        const QString logMsg {QStringLiteral("Handoff socket not served, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+        socketHandoffPtr_.reset();
+        return;
+    }
+    socketHandoffPtr_->setSockets(httpServerPtr_->listenSockets());
+    QObject::connect(socketHandoffPtr_.get(),&SocketHandoff::handedOverSignal,this,&Bootloader::handedOverSlot);
+}
+
+void Bootloader::takeoverSlot(bool isIntegrityOk)
+{
+    //the running process serves until this one can answer
+    if(!isIntegrityOk){
+        return;
+    }
+    QObject::disconnect(takeoverConnection_);
+    const QString handoffPath {appSettingsPtr_->value("UA_HANDOFF_SOCKET").toString()};
+    QMultiHash<QString,qintptr> inheritedSockets {};
+    QString lastError {};
+    if(!SocketHandoff::requestSockets(handoffPath,inheritedSockets,lastError)){
+        //the running process is gone meanwhile or failed, binding is all that is left
+        const QString logMsg {QStringLiteral("Listening sockets not taken over, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+        inheritedSockets.clear();
+    }
+    lastError.clear();
+    if(!listen(inheritedSockets,lastError)){
+        Q_EMIT finishedSignal(false,lastError);
+        return;
+    }
+    startHandoff();
+}
+
+void Bootloader::handedOverSlot()
+{
+    //a shutdown signal from here on only forces the exit
+    isShuttingDown_=true;
+    //the next process accepts from the very same queues, this one only finishes its connections
+    socketHandoffPtr_->release();
+    httpServerPtr_->stopListening(true);
+    httpServerPtr_->drain(appSettingsPtr_->value("UA_DRAIN_TIMEOUT",30).toInt());
+}
+
+void Bootloader::drainedSlot(bool isComplete)
+{
+    if(!isComplete){
+        Q_EMIT finishedSignal(false,"Drain timed out, connections left were cut");
+        return;
+    }
+    Q_EMIT finishedSignal(true,QString {});
+}
+
+void Bootloader::shutdownSlot(int signalNumber)
+{
+    if(isShuttingDown_){
+        Q_EMIT finishedSignal(false,QStringLiteral("Shutdown forced by signal %1").arg(signalNumber));
+        return;
+    }
+    isShuttingDown_=true;
+    QObject::disconnect(takeoverConnection_);
+    //probes see 'not ready' while still served, so load balancers stop sending first
+    const int shutdownDelay {qMax(appSettingsPtr_->value("UA_SHUTDOWN_DELAY",0).toInt(),0)};
+    qInfo("Shutdown by signal %d, accepting stops in %d s",signalNumber,shutdownDelay);
+    httpServerPtr_->setReady(false);
+    QTimer::singleShot(shutdownDelay * 1000,this,[this](){
+        //nothing is handed over any more, the handoff socket file goes with it
+        socketHandoffPtr_.reset();
+        httpServerPtr_->stopListening(false);
+        httpServerPtr_->drain(appSettingsPtr_->value("UA_DRAIN_TIMEOUT",30).toInt());
+    });
+}
+
 Bootloader::Bootloader(QSharedPointer<QSettings> appSettingsPtr, QObject *parent)
     :QObject{parent},appSettingsPtr_{appSettingsPtr}
 {
@@ -14,14 +161,24 @@ void Bootloader::run()
     controllerPtr_.reset(new Controller(appSettingsPtr_));
     QObject::connect(controllerPtr_.get(),&Controller::integritySignal,
                      httpServerPtr_.get(),&HttpServer::integritySlot);
-    const QString serverAddress  {appSettingsPtr_->value("UA_HOST").toString()};
-    const qint32 serverPort {appSettingsPtr_->value("UA_PORT").toInt()};
-    const bool isListenOk {httpServerPtr_->listen(QHostAddress(serverAddress),serverPort)};
-    if(!isListenOk){
-        Q_EMIT finishedSignal(false, httpServerPtr_->errorString());
+    QObject::connect(httpServerPtr_.get(),&HttpServer::drainedSignal,this,&Bootloader::drainedSlot);
+
+    QMultiHash<QString,qintptr> inheritedSockets {};
+    if(!SocketHandoff::takeSystemdSockets(inheritedSockets)){
+        const QString handoffPath {appSettingsPtr_->value("UA_HANDOFF_SOCKET").toString()};
+        if(!handoffPath.isEmpty() && SocketHandoff::isServing(handoffPath)){
+            //queued after HttpServer::integritySlot, so caches are loaded before the first request
+            takeoverConnection_=QObject::connect(controllerPtr_.get(),&Controller::integritySignal,this,&Bootloader::takeoverSlot);
+            qInfo("Running process found at %s, sockets taken over once integrity is ok",qPrintable(handoffPath));
+            controllerPtr_->start();
+            return;
+        }
+    }
+    QString lastError {};
+    if(!listen(inheritedSockets,lastError)){
+        Q_EMIT finishedSignal(false,lastError);
         return;
     }
-    qInfo("HttpServer started at: %s:%d",qPrintable(httpServerPtr_->serverAddress().toString()),httpServerPtr_->serverPort());
+    startHandoff();
     controllerPtr_->start();
 }
-
@@ -3,11 +3,13 @@
 
 #include <QString>
 #include <QObject>
+#include <QMultiHash>
 #include <QSharedPointer>
 
 class QSettings;
 class HttpServer;
 class Controller;
+class SocketHandoff;
 class Bootloader:public QObject
 {
     Q_OBJECT
@@ -15,12 +17,29 @@ private:
     QSharedPointer<QSettings> appSettingsPtr_   {nullptr};
     QSharedPointer<HttpServer> httpServerPtr_   {nullptr};
     QSharedPointer<Controller> controllerPtr_   {nullptr};
+    QSharedPointer<SocketHandoff> socketHandoffPtr_ {nullptr};
+    QMetaObject::Connection takeoverConnection_ {};
+    bool isShuttingDown_ {false};
+
+    //Listen On Inherited Sockets, Bind The Configured Ones That Were Not
+    bool listen(const QMultiHash<QString,qintptr>& inheritedSockets,QString& lastError);
+    //Serve UA_HANDOFF_SOCKET For The Next Process
+    void startHandoff();
+
+private Q_SLOTS:
+    void takeoverSlot(bool isIntegrityOk);
+    void handedOverSlot();
+    void drainedSlot(bool isComplete);
 
 public:
     explicit Bootloader(QSharedPointer<QSettings> appSettingsPtr,QObject* parent=nullptr);
     ~Bootloader()=default;
     void run();
 
+public Q_SLOTS:
+    //Not Ready, Stop Accepting After UA_SHUTDOWN_DELAY, Drain; A Second Call Exits At Once
+    void shutdownSlot(int signalNumber);
+
 Q_SIGNALS:
     void finishedSignal(bool isSuccess, const QString& lastError);
 };
@@ -0,0 +1,75 @@
+#include "SignalWatcher.h"
+
+#include <QSocketNotifier>
+
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#endif
+
+namespace{
+//[0] is written by the handler, [1] read by the notifier
+int signalSockets[2] {-1,-1};
+}
+
+void SignalWatcher::handleSignal(int signalNumber)
+{
+#ifdef Q_OS_UNIX
+    //async-signal-safe only
+    const char signalData {static_cast<char>(signalNumber)};
+    const ssize_t written {::write(signalSockets[0],&signalData,sizeof(signalData))};
+    Q_UNUSED(written)
+#else
+    Q_UNUSED(signalNumber)
+#endif
+}
+
+void SignalWatcher::activatedSlot()
+{
+#ifdef Q_OS_UNIX
+    notifierPtr_->setEnabled(false);
+    char signalData {0};
+    if(::read(signalSockets[1],&signalData,sizeof(signalData))==sizeof(signalData)){
+        Q_EMIT terminateSignal(static_cast<int>(signalData));
+    }
+    notifierPtr_->setEnabled(true);
+#endif
+}
+
+SignalWatcher::SignalWatcher(QObject *parent)
+    :QObject{parent}
+{
+#ifdef Q_OS_UNIX
+    if(::socketpair(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0,signalSockets)!=0){
+        qWarning("Signal socket pair not created, SIGTERM ends the process at once");
+        return;
+    }
+    notifierPtr_.reset(new QSocketNotifier{signalSockets[1],QSocketNotifier::Read});
+    QObject::connect(notifierPtr_.get(),&QSocketNotifier::activated,this,&SignalWatcher::activatedSlot);
+
+    struct sigaction action {};
+    action.sa_handler=&SignalWatcher::handleSignal;
+    sigemptyset(&action.sa_mask);
+    //interrupted system calls of other threads are resumed
+    action.sa_flags=SA_RESTART;
+    ::sigaction(SIGTERM,&action,nullptr);
+    ::sigaction(SIGINT,&action,nullptr);
+#endif
+}
+
+SignalWatcher::~SignalWatcher()
+{
+#ifdef Q_OS_UNIX
+    if(!notifierPtr_){
+        return;
+    }
+    ::signal(SIGTERM,SIG_DFL);
+    ::signal(SIGINT,SIG_DFL);
+    notifierPtr_.reset();
+    ::close(signalSockets[0]);
+    ::close(signalSockets[1]);
+    signalSockets[0]=-1;
+    signalSockets[1]=-1;
+#endif
+}
@@ -0,0 +1,31 @@
+#ifndef SIGNALWATCHER_H
+#define SIGNALWATCHER_H
+
+#include <QObject>
+#include <QSharedPointer>
+
+class QSocketNotifier;
+
+//Turns SIGTERM and SIGINT into 'terminateSignal' in the main thread. The handler
+//only writes the signal number into a socket pair, the rest runs from the event
+//loop (self-pipe trick). Unix only, elsewhere nothing is watched.
+class SignalWatcher : public QObject
+{
+    Q_OBJECT
+private:
+    QSharedPointer<QSocketNotifier> notifierPtr_ {nullptr};
+
+    static void handleSignal(int signalNumber);
+
+private Q_SLOTS:
+    void activatedSlot();
+
+public:
+    explicit SignalWatcher(QObject* parent=nullptr);
+    ~SignalWatcher();
+
+Q_SIGNALS:
+    void terminateSignal(int signalNumber);
+};
+
+#endif // SIGNALWATCHER_H
@@ -0,0 +1,42 @@
+#include "AssignmentIndex.h"
+
+#include <algorithm>
+
+QStringList AssignmentIndex::usersOf(const QStringList &rolePermIds, const QString &afterUserId, int limit, int &outTotal) const
+{
+    QVector<QString> allUserIds {};
+    for(const QString& rolePermId: rolePermIds){
+        const auto it {userIds.find(rolePermId.toLower())};
+        if(it!=userIds.end()){
+            allUserIds+=it.value();
+        }
+    }
+    std::sort(allUserIds.begin(),allUserIds.end());
+    allUserIds.erase(std::unique(allUserIds.begin(),allUserIds.end()),allUserIds.end());
+    outTotal=allUserIds.size();
+
+    QStringList pageUserIds {};
+    auto it {afterUserId.isEmpty() ? allUserIds.cbegin()
+                                   : std::upper_bound(allUserIds.cbegin(),allUserIds.cend(),afterUserId.toLower())};
+    for(;it!=allUserIds.cend() && pageUserIds.size() < limit;++it){
+        pageUserIds.push_back(*it);
+    }
+    return pageUserIds;
+}
+
+void AssignmentIndex::applyChange(const QString &operation, const QString &rolePermId, const QString &userId)
+{
+    QVector<QString>& rolePermUserIds {userIds[rolePermId.toLower()]};
+    const QString lowerUserId {userId.toLower()};
+    const auto it {std::lower_bound(rolePermUserIds.begin(),rolePermUserIds.end(),lowerUserId)};
+    const bool isAssigned {it!=rolePermUserIds.end() && *it==lowerUserId};
+    if(operation=="delete" && isAssigned){
+        rolePermUserIds.erase(it);
+    }
+    else if(operation!="delete" && !isAssigned){
+        rolePermUserIds.insert(it,lowerUserId);
+    }
+    if(rolePermUserIds.isEmpty()){
+        userIds.remove(rolePermId.toLower());
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef ASSIGNMENTINDEX_H
+#define ASSIGNMENTINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QStringList>
+
+//Immutable in-memory reverse index of 'users_roles_permissions': role/permission id
+//to the ids of users it is assigned to directly. User ids are kept sorted, so pages
+//can be cut with a keyset cursor (the last user id of the previous page).
+struct AssignmentIndex
+{
+    quint64 version {0};
+    //ms since epoch when loading started, every change committed before it is included
+    qint64 loadedAt {0};
+    QHash<QString,QVector<QString>> userIds {};
+
+    //Users Assigned To Any Of 'rolePermIds', Sorted And Without Duplicates, Starting After 'afterUserId'
+    QStringList usersOf(const QStringList& rolePermIds,const QString& afterUserId,int limit,int& outTotal) const;
+    //Apply Logged 'insert' Or 'delete' Of Assignment, Before The Index Is Shared; Repeating One Is Harmless
+    void applyChange(const QString& operation,const QString& rolePermId,const QString& userId);
+};
+
+#endif // ASSIGNMENTINDEX_H
@@ -0,0 +1,249 @@
+#include "AuthzBinClient.h"
+#include "PolicyCache.h"
+#include "DecisionCache.h"
+#include "../cache/VersionStore.h"
+#include "../http/ConnectionTracker.h"
+#include "../postgres/SQL_Handler.h"
+
+#include <QSettings>
+#include <QTcpSocket>
+#include <QStringList>
+
+#ifdef Q_OS_WINDOWS
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace UAuthBinProtocol;
+
+void AuthzBinClient::handleReadyRead(QTcpSocket *socket)
+{
+    buffer_.append(socket->readAll());
+    QByteArray replies {};
+    int offset {0};
+    while(buffer_.size() - offset >= 4){
+        const quint32 frameSize {qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(buffer_.constData() + offset))};
+        //a frame that can not be delimited leaves nothing to resynchronize on
+        if(frameSize < static_cast<quint32>(FrameHeaderSize) || frameSize > MaxFrameSize){
+            qWarning("Binary authz frame of size %u rejected, closing connection",frameSize);
+            socket->disconnectFromHost();
+            buffer_.clear();
+            return;
+        }
+        if(static_cast<quint32>(buffer_.size() - offset - 4) < frameSize){
+            break; // Partial read
+        }
+        replies.append(handleFrame(buffer_.constData() + offset + 4,static_cast<int>(frameSize)));
+        offset+=4 + static_cast<int>(frameSize);
+    }
+    buffer_.remove(0,offset);
+    if(!replies.isEmpty()){
+        socket->write(replies);
+    }
+}
+
+QByteArray AuthzBinClient::handleFrame(const char *data, int size)
+{
+    Reader reader {data,size};
+    const MessageType type {static_cast<MessageType>(reader.readUInt8())};
+    const quint32 requestId {reader.readUInt32()};
+    switch(type){
+    case MessageType::Check:
+        {
+            const QUuid userId {reader.readUuid()};
+            QString rolePermIdent {};
+            QString lastError {};
+            if(!readIdent(reader,rolePermIdent,lastError) || !reader.atEnd()){
+                return makeErrorReply(requestId,lastError.isEmpty() ? QString {"Malformed check"} : lastError);
+            }
+            //taken before the check, so the decision reflects at least this version
+            const quint64 policyVersion {versionStorePtr_->policyVersion()};
+            Writer writer {MessageType::CheckReply,requestId};
+            writer.writeUInt64(policyVersion);
+            writer.writeUInt8(static_cast<quint8>(check(userId,rolePermIdent)));
+            return writer.frame();
+        }
+    case MessageType::Batch:
+        {
+            const int count {reader.readUInt16()};
+            if(count==0 || count > MaxBatchSize){
+                return makeErrorReply(requestId,QStringLiteral("Batch must have 1..%1 checks").arg(MaxBatchSize));
+            }
+            QVector<QUuid> userIds {};
+            QStringList rolePermIdents {};
+            userIds.reserve(count);
+            rolePermIdents.reserve(count);
+            for(int i=0;i<count;++i){
+                userIds.push_back(reader.readUuid());
+                QString rolePermIdent {};
+                QString lastError {};
+                if(!readIdent(reader,rolePermIdent,lastError)){
+                    return makeErrorReply(requestId,QStringLiteral("checks[%1]: %2").arg(i).arg(lastError.isEmpty() ? QString {"Malformed check"} : lastError));
+                }
+                rolePermIdents.push_back(rolePermIdent);
+            }
+            if(!reader.atEnd()){
+                return makeErrorReply(requestId,"Malformed batch");
+            }
+            const quint64 policyVersion {versionStorePtr_->policyVersion()};
+            Writer writer {MessageType::BatchReply,requestId};
+            writer.writeUInt64(policyVersion);
+            writer.writeUInt16(static_cast<quint16>(count));
+            for(int i=0;i<count;++i){
+                writer.writeUInt8(static_cast<quint8>(check(userIds.at(i),rolePermIdents.at(i))));
+            }
+            return writer.frame();
+        }
+    case MessageType::Intern:
+        {
+            const QString rolePermIdent {reader.readString()};
+            if(!reader.isOk() || !reader.atEnd() || rolePermIdent.isEmpty()){
+                return makeErrorReply(requestId,"Malformed intern");
+            }
+            quint32 internedId {internedIds_.value(rolePermIdent,0)};
+            if(internedId==0){
+                if(internedIdents_.size() >= maxInterned_){
+                    return makeErrorReply(requestId,QStringLiteral("More than %1 interned idents").arg(maxInterned_));
+                }
+                internedIdents_.push_back(rolePermIdent);
+                internedId=static_cast<quint32>(internedIdents_.size());
+                internedIds_.insert(rolePermIdent,internedId);
+            }
+            Writer writer {MessageType::InternReply,requestId};
+            writer.writeUInt32(internedId);
+            return writer.frame();
+        }
+    case MessageType::Version:
+        {
+            if(!reader.isOk() || !reader.atEnd()){
+                return makeErrorReply(requestId,"Malformed version");
+            }
+            Writer writer {MessageType::VersionReply,requestId};
+            writer.writeUInt64(versionStorePtr_->policyVersion());
+            return writer.frame();
+        }
+    default:
+        return makeErrorReply(requestId,QStringLiteral("Unknown message type: %1").arg(static_cast<int>(type)));
+    }
+}
+
+bool AuthzBinClient::readIdent(Reader &reader, QString &outRolePermIdent, QString &lastError)
+{
+    const IdentKind identKind {static_cast<IdentKind>(reader.readUInt8())};
+    switch(identKind){
+    case IdentKind::Uuid:
+        outRolePermIdent=reader.readUuid().toString(QUuid::WithoutBraces);
+        break;
+    case IdentKind::Interned:
+        {
+            const quint32 internedId {reader.readUInt32()};
+            if(internedId==0 || internedId > static_cast<quint32>(internedIdents_.size())){
+                lastError=QStringLiteral("Unknown interned id: %1").arg(internedId);
+                return false;
+            }
+            outRolePermIdent=internedIdents_.at(static_cast<int>(internedId) - 1);
+        }
+        break;
+    case IdentKind::Names:
+        outRolePermIdent=reader.readString();
+        break;
+    default:
+        lastError=QStringLiteral("Unknown ident kind: %1").arg(static_cast<int>(identKind));
+        return false;
+    }
+    return reader.isOk() && !outRolePermIdent.isEmpty();
+}
+
+Result AuthzBinClient::check(const QUuid &userId, const QString &rolePermIdent)
+{
+    if(isIntegrityOkPtr_->loadAcquire()==0){
+        return Result::Unavailable;
+    }
+    QString lastError {};
+    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(userId.toString(QUuid::WithoutBraces),rolePermIdent,lastError)};
+    switch(sqlStatus){
+    case SQL_Status::Success:
+        return Result::Allowed;
+    case SQL_Status::Unauthorized:
+        return Result::Denied;
+    case SQL_Status::BadRequest:
+        //database errors end up here, the caller may retry over http
+        return Result::Unavailable;
+    default:
+        return Result::NotFound;
+    }
+}
+
+QByteArray AuthzBinClient::makeErrorReply(quint32 requestId, const QString &lastError)
+{
+    Writer writer {MessageType::ErrorReply,requestId};
+    QByteArray utf8 {lastError.toUtf8()};
+    if(utf8.size() > MaxStringSize){
+        //cut before a continuation byte never splits a character
+        int size {MaxStringSize};
+        while(size > 0 && (static_cast<quint8>(utf8.at(size)) & 0xC0)==0x80){
+            --size;
+        }
+        utf8.truncate(size);
+    }
+    writer.writeString(QString::fromUtf8(utf8));
+    return writer.frame();
+}
+
+void AuthzBinClient::run()
+{
+    sqlHandlerPtr_.reset(new SQL_Handler{appSettingsPtr_});
+    sqlHandlerPtr_->setDecisionCache(decisionCachePtr_);
+    sqlHandlerPtr_->setPolicyCache(policyCachePtr_);
+    QTcpSocket* socket {new QTcpSocket};
+    if(!socket->setSocketDescriptor(socketDescriptor_)){
+        //the socket never owned the descriptor, no 'disconnected' would ever end this thread
+        const QString logMsg {QStringLiteral("Authz connection not served, error: %1").arg(socket->errorString())};
+        qWarning(qPrintable(logMsg));
+        delete socket;
+#ifdef Q_OS_WINDOWS
+        ::closesocket(static_cast<SOCKET>(socketDescriptor_));
+#else
+        ::close(static_cast<int>(socketDescriptor_));
+#endif
+        connectionTrackerPtr_->connectionFinished();
+        return;
+    }
+    //replies are small and latency bound
+    socket->setSocketOption(QAbstractSocket::LowDelayOption,1);
+
+    QObject::connect(socket,&QTcpSocket::readyRead,[this,socket](){
+        handleReadyRead(socket);
+    });
+    QObject::connect(socket,&QTcpSocket::disconnected,[this,socket](){
+        socket->deleteLater();
+        QThread::quit();
+    });
+    //queued into this thread, so replies of frames already read are written first;
+    //a client reconnects to whichever process accepts then
+    QObject::connect(connectionTrackerPtr_.data(),&ConnectionTracker::drainSignal,socket,[socket](){
+        socket->disconnectFromHost();
+    });
+    if(connectionTrackerPtr_->isDraining()){
+        socket->disconnectFromHost();
+    }
+    QThread::exec();
+    connectionTrackerPtr_->connectionFinished();
+}
+
+AuthzBinClient::AuthzBinClient(qintptr socketDescriptor, QSharedPointer<QAtomicInt> isIntegrityOkPtr, QSharedPointer<QSettings> appSettingsPtr,
+                               QSharedPointer<VersionStore> versionStorePtr, QSharedPointer<PolicyCache> policyCachePtr,
+                               QSharedPointer<DecisionCache> decisionCachePtr, QSharedPointer<ConnectionTracker> connectionTrackerPtr,
+                               QObject *parent)
+    :QThread{parent},socketDescriptor_{socketDescriptor},isIntegrityOkPtr_{isIntegrityOkPtr},appSettingsPtr_{appSettingsPtr},
+     versionStorePtr_{versionStorePtr},policyCachePtr_{policyCachePtr},decisionCachePtr_{decisionCachePtr},
+     connectionTrackerPtr_{connectionTrackerPtr}
+{
+}
+
+AuthzBinClient::~AuthzBinClient()
+{
+    QThread::quit();
+    QThread::wait();
+}
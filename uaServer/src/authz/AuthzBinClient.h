@@ -0,0 +1,63 @@
+#ifndef AUTHZBINCLIENT_H
+#define AUTHZBINCLIENT_H
+
+#include <QHash>
+#include <QThread>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QSharedPointer>
+
+#include "UAuthBinProtocol.h"
+
+class QSettings;
+class QTcpSocket;
+class SQL_Handler;
+class VersionStore;
+class PolicyCache;
+class DecisionCache;
+class ConnectionTracker;
+
+//One connection of the binary authorization protocol. Frames are cut from the
+//read buffer as soon as they are complete and answered in order; replies of
+//pipelined requests are written back with one socket write.
+//Checks go through SQL_Handler::getAuthzCheck like 'authorized-to', so they are
+//answered from the shared decision and policy caches and reach database only on a miss.
+class AuthzBinClient : public QThread
+{
+    Q_OBJECT
+private:
+    qintptr socketDescriptor_;
+    //interned idents are per connection, the number bounds what one client can pin
+    const int maxInterned_ {65536};
+    QByteArray buffer_ {};
+    QVector<QString> internedIdents_ {};
+    QHash<QString,quint32> internedIds_ {};
+    QSharedPointer<QAtomicInt> isIntegrityOkPtr_ {nullptr};
+    QSharedPointer<QSettings> appSettingsPtr_  {nullptr};
+    QSharedPointer<SQL_Handler> sqlHandlerPtr_ {nullptr};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
+    QSharedPointer<DecisionCache> decisionCachePtr_ {nullptr};
+    QSharedPointer<ConnectionTracker> connectionTrackerPtr_ {nullptr};
+
+    void handleReadyRead(QTcpSocket* socket);
+    QByteArray handleFrame(const char* data,int size);
+    bool readIdent(UAuthBinProtocol::Reader& reader,QString& outRolePermIdent,QString& lastError);
+    UAuthBinProtocol::Result check(const QUuid& userId,const QString& rolePermIdent);
+
+    static QByteArray makeErrorReply(quint32 requestId,const QString& lastError);
+
+protected:
+    virtual void run()override;
+
+public:
+    AuthzBinClient(qintptr socketDescriptor,QSharedPointer<QAtomicInt> isIntegrityOkPtr,QSharedPointer<QSettings> appSettingsPtr,
+                   QSharedPointer<VersionStore> versionStorePtr,QSharedPointer<PolicyCache> policyCachePtr,
+                   QSharedPointer<DecisionCache> decisionCachePtr,QSharedPointer<ConnectionTracker> connectionTrackerPtr,
+                   QObject* parent=nullptr);
+    ~AuthzBinClient();
+};
+
+#endif // AUTHZBINCLIENT_H
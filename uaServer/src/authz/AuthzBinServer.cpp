@@ -0,0 +1,27 @@
+#include "AuthzBinServer.h"
+#include "AuthzBinClient.h"
+#include "../http/ConnectionTracker.h"
+
+#include <QSettings>
+
+void AuthzBinServer::incomingConnection(qintptr socketDescriptor)
+{
+    connectionTrackerPtr_->connectionStarted();
+    AuthzBinClient* authzBinClientPtr {new AuthzBinClient(socketDescriptor,isIntegrityOkPtr_,appSettingsPtr_,versionStorePtr_,policyCachePtr_,decisionCachePtr_,
+                                                          connectionTrackerPtr_)};
+    QObject::connect(authzBinClientPtr,&QThread::finished,authzBinClientPtr,&AuthzBinClient::deleteLater);
+    authzBinClientPtr->start();
+}
+
+AuthzBinServer::AuthzBinServer(QSharedPointer<QSettings> appSettingsPtr, QSharedPointer<VersionStore> versionStorePtr,
+                               QSharedPointer<PolicyCache> policyCachePtr, QSharedPointer<DecisionCache> decisionCachePtr,
+                               QSharedPointer<ConnectionTracker> connectionTrackerPtr, QObject *parent)
+    :QTcpServer{parent},appSettingsPtr_{appSettingsPtr},versionStorePtr_{versionStorePtr},policyCachePtr_{policyCachePtr},
+     decisionCachePtr_{decisionCachePtr},connectionTrackerPtr_{connectionTrackerPtr}
+{
+}
+
+void AuthzBinServer::setIntegrityOk(bool isIntegrityOk)
+{
+    isIntegrityOkPtr_->storeRelease(isIntegrityOk ? 1 : 0);
+}
@@ -0,0 +1,41 @@
+#ifndef AUTHZBINSERVER_H
+#define AUTHZBINSERVER_H
+
+#include <QTcpServer>
+#include <QAtomicInt>
+#include <QSharedPointer>
+
+class QSettings;
+class VersionStore;
+class PolicyCache;
+class DecisionCache;
+class ConnectionTracker;
+
+//Optional listener of the binary authorization protocol (UA_AUTHZ_BIN_PORT),
+//see lib/uaclient/src/UAuthBinProtocol.h. Every connection gets an AuthzBinClient
+//thread like HttpClient, but connections are meant to be long-lived, so the
+//integrity state is shared with them instead of copied.
+class AuthzBinServer : public QTcpServer
+{
+    Q_OBJECT
+private:
+    QSharedPointer<QAtomicInt> isIntegrityOkPtr_ {new QAtomicInt {0}};
+    QSharedPointer<QSettings> appSettingsPtr_ {nullptr};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
+    QSharedPointer<DecisionCache> decisionCachePtr_ {nullptr};
+    QSharedPointer<ConnectionTracker> connectionTrackerPtr_ {nullptr};
+
+protected:
+    virtual void incomingConnection(qintptr socketDescriptor)override;
+
+public:
+    AuthzBinServer(QSharedPointer<QSettings> appSettingsPtr,QSharedPointer<VersionStore> versionStorePtr,
+                   QSharedPointer<PolicyCache> policyCachePtr,QSharedPointer<DecisionCache> decisionCachePtr,
+                   QSharedPointer<ConnectionTracker> connectionTrackerPtr,QObject* parent=nullptr);
+    ~AuthzBinServer()=default;
+
+    void setIntegrityOk(bool isIntegrityOk);
+};
+
+#endif // AUTHZBINSERVER_H
@@ -0,0 +1,127 @@
+#include "DecisionCache.h"
+#include "../cache/VersionStore.h"
+
+#include <QStringList>
+#include <QMutexLocker>
+
+DecisionCache::Shard &DecisionCache::shardOf(const QString &key)
+{
+    return *shards_.at(static_cast<int>(qHash(key) % static_cast<uint>(shards_.size())));
+}
+
+QString DecisionCache::makeKey(const QString &userId, const QString &rolePermIdent)
+{
+    //'a b' and 'b a' ask the same, so idents are sorted
+    QStringList idents {rolePermIdent.split(" ",QString::SkipEmptyParts)};
+    idents.sort();
+    return userId.toLower() + "\n" + idents.join(" ");
+}
+
+DecisionCache::DecisionCache(QSharedPointer<VersionStore> versionStorePtr, int capacity, int shardCount)
+    :versionStorePtr_{versionStorePtr}
+{
+    if(capacity <= 0 || shardCount <= 0){
+        return;
+    }
+    shardCapacity_=qMax(1,capacity / shardCount);
+    for(int i=0;i<shardCount;++i){
+        shards_.push_back(QSharedPointer<Shard>{new Shard});
+    }
+}
+
+bool DecisionCache::isEnabled() const
+{
+    return !shards_.isEmpty();
+}
+
+DecisionCache::Stamp DecisionCache::stamp(const QString &userId) const
+{
+    Stamp stamp {};
+    stamp.generation=qMax(versionStorePtr_->tableVersion("roles_permissions"),
+                          versionStorePtr_->tableVersion("roles_permissions_relationship"));
+    stamp.userVersion=versionStorePtr_->entityVersion("users_roles_permissions",userId);
+    return stamp;
+}
+
+bool DecisionCache::lookup(const QString &userId, const QString &rolePermIdent, const Stamp &stamp, bool &outIsAllowed)
+{
+    if(!isEnabled()){
+        return false;
+    }
+    const QString key {makeKey(userId,rolePermIdent)};
+    Shard& shard {shardOf(key)};
+    QMutexLocker locker {&shard.mutex};
+    const auto it {shard.index.find(key)};
+    if(it==shard.index.end()){
+        misses_.fetchAndAddRelaxed(1);
+        return false;
+    }
+    const auto entryIt {it.value()};
+    if(entryIt->stamp.generation!=stamp.generation || entryIt->stamp.userVersion!=stamp.userVersion){
+        shard.entries.erase(entryIt);
+        shard.index.erase(it);
+        stales_.fetchAndAddRelaxed(1);
+        misses_.fetchAndAddRelaxed(1);
+        return false;
+    }
+    //move to front, the back is evicted first
+    shard.entries.splice(shard.entries.begin(),shard.entries,entryIt);
+    outIsAllowed=entryIt->isAllowed;
+    hits_.fetchAndAddRelaxed(1);
+    return true;
+}
+
+void DecisionCache::insert(const QString &userId, const QString &rolePermIdent, const Stamp &stamp, bool isAllowed)
+{
+    if(!isEnabled()){
+        return;
+    }
+    const QString key {makeKey(userId,rolePermIdent)};
+    Shard& shard {shardOf(key)};
+    QMutexLocker locker {&shard.mutex};
+    const auto it {shard.index.find(key)};
+    if(it!=shard.index.end()){
+        //a concurrent miss may have stored a decision of a newer version already
+        if(it.value()->stamp.generation > stamp.generation || it.value()->stamp.userVersion > stamp.userVersion){
+            return;
+        }
+        shard.entries.erase(it.value());
+        shard.index.erase(it);
+    }
+    Entry entry {};
+    entry.key=key;
+    entry.stamp=stamp;
+    entry.isAllowed=isAllowed;
+    shard.entries.push_front(entry);
+    shard.index.insert(key,shard.entries.begin());
+    while(shard.index.size() > shardCapacity_){
+        shard.index.remove(shard.entries.back().key);
+        shard.entries.pop_back();
+        evictions_.fetchAndAddRelaxed(1);
+    }
+}
+
+QByteArray DecisionCache::metrics() const
+{
+    int size {0};
+    for(const QSharedPointer<Shard>& shardPtr: shards_){
+        QMutexLocker locker {&shardPtr->mutex};
+        size+=shardPtr->index.size();
+    }
+    const auto counter {[](const QByteArray& name,const QByteArray& help,quint64 value){
+            return "# HELP " + name + " " + help + "\n# TYPE " + name + " counter\n" + name + " " + QByteArray::number(value) + "\n";
+        }
+    };
+    QByteArray outData {};
+    outData+=counter("uauth_authz_decision_cache_hits_total","Authorization decisions answered from cache.",hits_.loadAcquire());
+    outData+=counter("uauth_authz_decision_cache_misses_total","Authorization decisions computed in database.",misses_.loadAcquire());
+    outData+=counter("uauth_authz_decision_cache_stale_total","Cached decisions dropped by a newer policy or assignment version.",stales_.loadAcquire());
+    outData+=counter("uauth_authz_decision_cache_evictions_total","Cached decisions evicted by capacity.",evictions_.loadAcquire());
+    outData+="# HELP uauth_authz_decision_cache_entries Cached authorization decisions.\n"
+             "# TYPE uauth_authz_decision_cache_entries gauge\n"
+             "uauth_authz_decision_cache_entries " + QByteArray::number(size) + "\n";
+    outData+="# HELP uauth_authz_decision_cache_capacity Maximum cached authorization decisions.\n"
+             "# TYPE uauth_authz_decision_cache_capacity gauge\n"
+             "uauth_authz_decision_cache_capacity " + QByteArray::number(shardCapacity_ * shards_.size()) + "\n";
+    return outData;
+}
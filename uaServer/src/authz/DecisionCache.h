@@ -0,0 +1,67 @@
+#ifndef DECISIONCACHE_H
+#define DECISIONCACHE_H
+
+#include <list>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+
+class VersionStore;
+
+//Bounded LRU of authorization decisions keyed by (user, roles/permissions), split
+//into shards with own locks so request threads rarely contend. Every entry keeps
+//the policy generation (roles/permissions and hierarchy version) and the user's
+//assignments version it was computed at; a lookup with newer versions is a miss,
+//so a policy write drops all entries and an assignment write drops one user's.
+class DecisionCache
+{
+public:
+    struct Stamp{
+        quint64 generation {0};
+        quint64 userVersion {0};
+    };
+
+private:
+    struct Entry{
+        QString key {};
+        Stamp stamp {};
+        bool isAllowed {false};
+    };
+    struct Shard{
+        QMutex mutex;
+        std::list<Entry> entries {};
+        QHash<QString,std::list<Entry>::iterator> index {};
+    };
+
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QVector<QSharedPointer<Shard>> shards_ {};
+    int shardCapacity_ {0};
+
+    QAtomicInteger<quint64> hits_ {0};
+    QAtomicInteger<quint64> misses_ {0};
+    QAtomicInteger<quint64> stales_ {0};
+    QAtomicInteger<quint64> evictions_ {0};
+
+    Shard& shardOf(const QString& key);
+    static QString makeKey(const QString& userId,const QString& rolePermIdent);
+
+public:
+    //'capacity' Is Total Number Of Entries, 0 Disables Cache
+    DecisionCache(QSharedPointer<VersionStore> versionStorePtr,int capacity,int shardCount=16);
+    ~DecisionCache()=default;
+
+    bool isEnabled() const;
+    //Versions To Check Against, Taken Before Computing A Decision To Insert
+    Stamp stamp(const QString& userId) const;
+    bool lookup(const QString& userId,const QString& rolePermIdent,const Stamp& stamp,bool& outIsAllowed);
+    void insert(const QString& userId,const QString& rolePermIdent,const Stamp& stamp,bool isAllowed);
+
+    //Counters And Size In Prometheus Text Format
+    QByteArray metrics() const;
+};
+
+#endif // DECISIONCACHE_H
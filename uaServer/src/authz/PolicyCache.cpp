@@ -0,0 +1,191 @@
+#include "PolicyCache.h"
+#include "../cache/VersionStore.h"
+#include "../postgres/SQL_Handler.h"
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QMutexLocker>
+
+quint64 PolicyCache::currentVersion() const
+{
+    return qMax(versionStorePtr_->tableVersion("roles_permissions"),
+                versionStorePtr_->tableVersion("roles_permissions_relationship"));
+}
+
+PolicyCache::PolicyCache(QSharedPointer<VersionStore> versionStorePtr)
+    :versionStorePtr_{versionStorePtr}
+{
+}
+
+QSharedPointer<const PolicySnapshot> PolicyCache::snapshot(SQL_Handler &sqlHandler, QString &lastError)
+{
+    QMutexLocker locker {&mutex_};
+    //version is read before loading, a write landing meanwhile leaves the
+    //snapshot tagged as outdated and the next call loads it again
+    const quint64 version {currentVersion()};
+    if(snapshotPtr_ && snapshotPtr_->version==version){
+        return snapshotPtr_;
+    }
+    QSharedPointer<PolicySnapshot> newSnapshotPtr {new PolicySnapshot};
+    newSnapshotPtr->version=version;
+    newSnapshotPtr->loadedAt=QDateTime::currentMSecsSinceEpoch();
+    if(sqlHandler.getPolicySnapshot(*newSnapshotPtr,lastError)!=SQL_Status::Success){
+        return nullptr;
+    }
+    snapshotPtr_=newSnapshotPtr;
+    return snapshotPtr_;
+}
+
+QSharedPointer<const AssignmentIndex> PolicyCache::assignmentIndex(SQL_Handler &sqlHandler, QString &lastError)
+{
+    QMutexLocker locker {&assignmentMutex_};
+    const quint64 version {versionStorePtr_->tableVersion("users_roles_permissions")};
+    if(assignmentIndexPtr_ && assignmentIndexPtr_->version==version){
+        return assignmentIndexPtr_;
+    }
+    QSharedPointer<AssignmentIndex> newAssignmentIndexPtr {new AssignmentIndex};
+    newAssignmentIndexPtr->version=version;
+    newAssignmentIndexPtr->loadedAt=QDateTime::currentMSecsSinceEpoch();
+    if(sqlHandler.getAssignmentIndex(*newAssignmentIndexPtr,lastError)!=SQL_Status::Success){
+        return nullptr;
+    }
+    assignmentIndexPtr_=newAssignmentIndexPtr;
+    return assignmentIndexPtr_;
+}
+
+bool PolicyCache::installSnapshot(QSharedPointer<PolicySnapshot> snapshotPtr, QString &lastError)
+{
+    QMutexLocker locker {&mutex_};
+    if(snapshotPtr_){
+        lastError="Snapshot already loaded";
+        return false;
+    }
+    //roles and hierarchy are small, a changed snapshot is loaded again rather than replayed
+    const quint64 version {currentVersion()};
+    if(snapshotPtr->version!=version){
+        lastError=QStringLiteral("Snapshot version: %1, database: %2").arg(snapshotPtr->version).arg(version);
+        return false;
+    }
+    snapshotPtr_=snapshotPtr;
+    return true;
+}
+
+bool PolicyCache::installAssignmentIndex(QSharedPointer<AssignmentIndex> assignmentIndexPtr, SQL_Handler &sqlHandler, QString &lastError)
+{
+    QMutexLocker locker {&assignmentMutex_};
+    if(assignmentIndexPtr_){
+        lastError="Assignment index already loaded";
+        return false;
+    }
+    const quint64 version {versionStorePtr_->tableVersion("users_roles_permissions")};
+    if(assignmentIndexPtr->version > version){
+        lastError=QStringLiteral("Assignment index version: %1 ahead of database: %2").arg(assignmentIndexPtr->version).arg(version);
+        return false;
+    }
+    if(assignmentIndexPtr->version < version){
+        //the index may hold some of these already, replaying them in order ends at the state of 'version'
+        const int maxReplay {10000};
+        QJsonArray rowObjects {};
+        bool isReset {false};
+        if(sqlHandler.getChangeLogRows(static_cast<qint64>(assignmentIndexPtr->version),static_cast<qint64>(version),
+                                       maxReplay,rowObjects,isReset,lastError)!=SQL_Status::Success){
+            return false;
+        }
+        if(isReset){
+            lastError=QStringLiteral("Change log after assignment index version: %1 trimmed or too long").arg(assignmentIndexPtr->version);
+            return false;
+        }
+        for(const QJsonValue& rowValue: rowObjects){
+            const QJsonObject rowObject {rowValue.toObject()};
+            if(rowObject.value("table_name").toString()!="users_roles_permissions"){
+                continue;
+            }
+            const QString operation {rowObject.value("operation").toString()};
+            if(operation=="truncate"){
+                assignmentIndexPtr->userIds.clear();
+                continue;
+            }
+            //updates of the link table are logged as a delete and an insert
+            const QJsonObject dataObject {rowObject.value("row_data").toObject()};
+            assignmentIndexPtr->applyChange(operation,dataObject.value("role_permission_id").toString(),dataObject.value("user_id").toString());
+        }
+        assignmentIndexPtr->version=version;
+    }
+    assignmentIndexPtr_=assignmentIndexPtr;
+    return true;
+}
+
+void PolicyCache::loaded(QSharedPointer<const PolicySnapshot> &outSnapshotPtr, QSharedPointer<const AssignmentIndex> &outAssignmentIndexPtr)
+{
+    {
+        QMutexLocker locker {&mutex_};
+        outSnapshotPtr=snapshotPtr_;
+    }
+    {
+        QMutexLocker locker {&assignmentMutex_};
+        outAssignmentIndexPtr=assignmentIndexPtr_;
+    }
+}
+
+QSharedPointer<const QSet<QString>> PolicyCache::superuserIds(SQL_Handler &sqlHandler, QString &lastError)
+{
+    QMutexLocker locker {&superuserMutex_};
+    //a version past the set is a change it did not see: a write bumped before the listener
+    //applied it, a table-wide change or a listener restart
+    const quint64 version {qMax(currentVersion(),versionStorePtr_->tableVersion("users_roles_permissions"))};
+    if(superuserIdsPtr_ && version <= superuserSequence_){
+        return superuserIdsPtr_;
+    }
+    QSet<QString> rolePermIds {};
+    QHash<QString,int> heldCounts {};
+    quint64 generation {0};
+    if(sqlHandler.getUAuthAdminHolders(rolePermIds,heldCounts,generation,lastError)!=SQL_Status::Success){
+        return nullptr;
+    }
+    QSharedPointer<QSet<QString>> newSuperuserIdsPtr {new QSet<QString>};
+    for(auto it=heldCounts.cbegin();it!=heldCounts.cend();++it){
+        newSuperuserIdsPtr->insert(it.key());
+    }
+    superuserRolePermIds_=rolePermIds;
+    superuserHeldCounts_=heldCounts;
+    superuserIdsPtr_=newSuperuserIdsPtr;
+    superuserSequence_=qMax(generation,version);
+    return superuserIdsPtr_;
+}
+
+void PolicyCache::applyChange(quint64 sequence, const QString &tableName, const QString &operation, const QJsonObject &rowObject)
+{
+    QMutexLocker locker {&superuserMutex_};
+    if(!superuserIdsPtr_ || sequence <= superuserSequence_){
+        return;
+    }
+    if(tableName=="roles_permissions" || tableName=="roles_permissions_relationship" || operation=="truncate"){
+        //which roles make a superuser may have changed, the next call reads the set again
+        superuserIdsPtr_.reset();
+        return;
+    }
+    superuserSequence_=sequence;
+    if(tableName!="users_roles_permissions"
+            || !superuserRolePermIds_.contains(rowObject.value("role_permission_id").toString())){
+        return;
+    }
+    const QString userId {rowObject.value("user_id").toString().toLower()};
+    const int heldCount {superuserHeldCounts_.value(userId) + (operation=="delete" ? -1 : 1)};
+    if(heldCount > 0){
+        superuserHeldCounts_.insert(userId,heldCount);
+    }
+    else{
+        superuserHeldCounts_.remove(userId);
+    }
+    //readers keep the set they got, a changed one is a copy
+    if((heldCount > 0)!=superuserIdsPtr_->contains(userId)){
+        QSharedPointer<QSet<QString>> newSuperuserIdsPtr {new QSet<QString>(*superuserIdsPtr_)};
+        if(heldCount > 0){
+            newSuperuserIdsPtr->insert(userId);
+        }
+        else{
+            newSuperuserIdsPtr->remove(userId);
+        }
+        superuserIdsPtr_=newSuperuserIdsPtr;
+    }
+}
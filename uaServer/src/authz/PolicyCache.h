@@ -0,0 +1,65 @@
+#ifndef POLICYCACHE_H
+#define POLICYCACHE_H
+
+#include <QSet>
+#include <QHash>
+#include <QPair>
+#include <QMutex>
+#include <QString>
+#include <QJsonObject>
+#include <QSharedPointer>
+
+#include "PolicySnapshot.h"
+#include "AssignmentIndex.h"
+
+class SQL_Handler;
+class VersionStore;
+
+//Holds the current PolicySnapshot, AssignmentIndex and the superuser set for all
+//request threads.
+//Snapshot and index are rebuilt lazily once the version of their tables in VersionStore
+//moves on; a reload is done by one thread while the others wait and reuse its result.
+//The superuser set follows assignment changes one by one as SQL_Listener applies them
+//and is only read again after roles or hierarchy changed or a change it did not see.
+class PolicyCache
+{
+private:
+    QMutex mutex_;
+    QMutex assignmentMutex_;
+    QMutex superuserMutex_;
+    QSharedPointer<const PolicySnapshot> snapshotPtr_ {nullptr};
+    QSharedPointer<const AssignmentIndex> assignmentIndexPtr_ {nullptr};
+    QSharedPointer<const QSet<QString>> superuserIdsPtr_ {nullptr};
+    //'UAuthAdmin' and roles/permissions above it, and how many of them each superuser holds
+    QSet<QString> superuserRolePermIds_ {};
+    QHash<QString,int> superuserHeldCounts_ {};
+    //last 'change_log' sequence reflected in the superuser set
+    quint64 superuserSequence_ {0};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+
+    quint64 currentVersion() const;
+
+public:
+    explicit PolicyCache(QSharedPointer<VersionStore> versionStorePtr);
+    ~PolicyCache()=default;
+
+    //Get Snapshot Of Current Version, Loads It With 'sqlHandler' When Outdated
+    QSharedPointer<const PolicySnapshot> snapshot(SQL_Handler& sqlHandler,QString& lastError);
+    //Get Assignment Index Of Current Version, Loads It With 'sqlHandler' When Outdated
+    QSharedPointer<const AssignmentIndex> assignmentIndex(SQL_Handler& sqlHandler,QString& lastError);
+    //Get Ids Of Users Holding 'UAuthAdmin' Directly Or Through Any Role Above It
+    QSharedPointer<const QSet<QString>> superuserIds(SQL_Handler& sqlHandler,QString& lastError);
+    //Apply 'change_log' Row To Superuser Set, Called By SQL_Listener Before Versions Move
+    void applyChange(quint64 sequence,const QString& tableName,const QString& operation,const QJsonObject& rowObject);
+
+    //Adopt Snapshot Read From File, Only While None Is Loaded And Roles And Hierarchy Did Not
+    //Change Since Its Version; Call Once The Listener Set The Versions
+    bool installSnapshot(QSharedPointer<PolicySnapshot> snapshotPtr,QString& lastError);
+    //Adopt Assignment Index Read From File, Only While None Is Loaded; Assignments Logged After
+    //Its Version Are Replayed From 'change_log', It Is Refused When The Log No Longer Has Them
+    bool installAssignmentIndex(QSharedPointer<AssignmentIndex> assignmentIndexPtr,SQL_Handler& sqlHandler,QString& lastError);
+    //Get Currently Held Snapshot And Index Without Loading, Either May Be Null Or Outdated
+    void loaded(QSharedPointer<const PolicySnapshot>& outSnapshotPtr,QSharedPointer<const AssignmentIndex>& outAssignmentIndexPtr);
+};
+
+#endif // POLICYCACHE_H
@@ -0,0 +1,330 @@
+#include "PolicyPublisher.h"
+#include "PolicyCache.h"
+#include "../cache/VersionStore.h"
+#include "../postgres/SQL_Handler.h"
+#include "SharedPolicy.h"
+
+#include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QSettings>
+#include <algorithm>
+#include <limits>
+
+#ifdef Q_OS_WINDOWS
+#include <io.h>
+#include <windows.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <sys/file.h>
+#endif
+
+namespace{
+struct IndexKey{
+    QByteArray key {};
+    quint32 value {0};
+    quint32 flags {0};
+};
+
+void sortIndexKeys(QVector<IndexKey>& indexKeys)
+{
+    std::sort(indexKeys.begin(),indexKeys.end(),[](const IndexKey& lhs,const IndexKey& rhs){
+        return uashm::compareBytes(lhs.key.constData(),static_cast<std::size_t>(lhs.key.size()),
+                                   rhs.key.constData(),static_cast<std::size_t>(rhs.key.size())) < 0;
+    });
+}
+}
+
+bool PolicyPublisher::lockSegment()
+{
+    //released with the descriptor, also when the process dies
+#ifdef Q_OS_WINDOWS
+    HANDLE fileHandle {reinterpret_cast<HANDLE>(_get_osfhandle(segmentFile_.handle()))};
+    OVERLAPPED overlapped {};
+    return LockFileEx(fileHandle,LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,0,1,0,&overlapped);
+#else
+    return flock(segmentFile_.handle(),LOCK_EX | LOCK_NB)==0;
+#endif
+}
+
+bool PolicyPublisher::openSegment(QString &lastError)
+{
+    if(!segmentFile_.open(QIODevice::ReadWrite)){
+        lastError=segmentFile_.errorString();
+        return false;
+    }
+    //a process this one takes over from publishes until it stops, two writers would
+    //interleave their seqlock updates and readers could pass a torn segment as whole
+    bool isWaiting {false};
+    while(!lockSegment()){
+        if(isInterruptionRequested()){
+            lastError="Stopped while another process holds the segment";
+            return false;
+        }
+        if(!isWaiting){
+            qInfo("Policy segment '%s' is held by another process, waiting",qPrintable(segmentFile_.fileName()));
+            isWaiting=true;
+        }
+        msleep(200);
+    }
+    //an existing segment is reused, readers mapped it already and keep reading the same pages;
+    //it is never shrunk, readers touching a cut off tail would fault instead of remapping
+    if(segmentFile_.size() > segmentSize_){
+        segmentSize_=segmentFile_.size();
+    }
+    if(segmentFile_.size()!=segmentSize_ && !segmentFile_.resize(segmentSize_)){
+        lastError=segmentFile_.errorString();
+        return false;
+    }
+    segmentData_=segmentFile_.map(0,segmentSize_);
+    if(!segmentData_){
+        lastError=segmentFile_.errorString();
+        return false;
+    }
+    return true;
+}
+
+QByteArray PolicyPublisher::compile(SQL_Handler &sqlHandler, quint64 policyVersion, QString &lastError)
+{
+    const QSharedPointer<const PolicySnapshot> snapshotPtr {policyCachePtr_->snapshot(sqlHandler,lastError)};
+    if(!snapshotPtr){
+        return QByteArray {};
+    }
+    const QSharedPointer<const AssignmentIndex> assignmentIndexPtr {policyCachePtr_->assignmentIndex(sqlHandler,lastError)};
+    if(!assignmentIndexPtr){
+        return QByteArray {};
+    }
+    const QSharedPointer<const QSet<QString>> superuserIdsPtr {policyCachePtr_->superuserIds(sqlHandler,lastError)};
+    if(!superuserIdsPtr){
+        return QByteArray {};
+    }
+
+    const QStringList& orderedIds {snapshotPtr->orderedIds};
+    const int rolePermCount {orderedIds.size()};
+    const int wordsPerUser {(rolePermCount + 63) / 64};
+    QHash<QString,int> rolePermNos {};
+    for(int i=0;i<rolePermCount;++i){
+        rolePermNos.insert(orderedIds.at(i),i);
+    }
+
+    //descendants of every role/permission including itself; a walk stops at nodes
+    //already closed and takes over their bits, cycles are walked but not re-entered
+    QVector<QVector<quint64>> closures(rolePermCount);
+    for(int i=0;i<rolePermCount;++i){
+        QVector<quint64> closure(wordsPerUser,0);
+        QVector<int> queue {i};
+        closure[i / 64]|=quint64 {1} << (i % 64);
+        for(int head=0;head<queue.size();++head){
+            const int rolePermNo {queue.at(head)};
+            if(rolePermNo!=i && !closures.at(rolePermNo).isEmpty()){
+                const QVector<quint64>& closedBits {closures.at(rolePermNo)};
+                for(int w=0;w<wordsPerUser;++w){
+                    closure[w]|=closedBits.at(w);
+                }
+                continue;
+            }
+            for(const QString& childId: snapshotPtr->childIds.value(orderedIds.at(rolePermNo))){
+                const int childNo {rolePermNos.value(childId,-1)};
+                if(childNo < 0 || (closure.at(childNo / 64) >> (childNo % 64) & 1)!=0){
+                    continue;
+                }
+                closure[childNo / 64]|=quint64 {1} << (childNo % 64);
+                queue.push_back(childNo);
+            }
+        }
+        closures[i]=closure;
+    }
+
+    QHash<QString,QVector<int>> userRolePermNos {};
+    for(auto it=assignmentIndexPtr->userIds.constBegin();it!=assignmentIndexPtr->userIds.constEnd();++it){
+        const int rolePermNo {rolePermNos.value(it.key(),-1)};
+        if(rolePermNo < 0){
+            continue;
+        }
+        for(const QString& userId: it.value()){
+            userRolePermNos[userId.toLower()].push_back(rolePermNo);
+        }
+    }
+    const int userCount {userRolePermNos.size()};
+
+    QByteArray strings {};
+    const auto makeIndex=[&](QVector<IndexKey>& indexKeys)->QVector<uashm::IndexEntry>{
+        sortIndexKeys(indexKeys);
+        QVector<uashm::IndexEntry> entries {};
+        entries.reserve(indexKeys.size());
+        for(const IndexKey& indexKey: indexKeys){
+            uashm::IndexEntry entry {};
+            //offsets are relative to the strings area until it is placed
+            entry.stringOffset=static_cast<quint32>(strings.size());
+            entry.stringSize=static_cast<quint32>(indexKey.key.size());
+            entry.value=indexKey.value;
+            entry.flags=indexKey.flags;
+            strings.append(indexKey.key);
+            entries.push_back(entry);
+        }
+        return entries;
+    };
+
+    QVector<IndexKey> idKeys {};
+    QVector<IndexKey> nameKeys {};
+    for(int i=0;i<rolePermCount;++i){
+        IndexKey idKey {};
+        idKey.key=orderedIds.at(i).toUtf8();
+        idKey.value=static_cast<quint32>(i);
+        idKeys.push_back(idKey);
+        IndexKey nameKey {};
+        nameKey.key=snapshotPtr->rolePerms.value(orderedIds.at(i)).name.toUtf8();
+        nameKey.value=static_cast<quint32>(i);
+        nameKeys.push_back(nameKey);
+    }
+    QVector<quint64> bitmaps {};
+    bitmaps.reserve(userCount * wordsPerUser);
+    QVector<IndexKey> userKeys {};
+    for(auto it=userRolePermNos.constBegin();it!=userRolePermNos.constEnd();++it){
+        IndexKey userKey {};
+        userKey.key=it.key().toUtf8();
+        userKey.value=static_cast<quint32>(userKeys.size());
+        userKey.flags=superuserIdsPtr->contains(it.key()) ? uashm::FlagSuperuser : 0;
+        userKeys.push_back(userKey);
+        QVector<quint64> row(wordsPerUser,0);
+        for(const int rolePermNo: it.value()){
+            const QVector<quint64>& closure {closures.at(rolePermNo)};
+            for(int w=0;w<wordsPerUser;++w){
+                row[w]|=closure.at(w);
+            }
+        }
+        bitmaps.append(row);
+    }
+    const QVector<uashm::IndexEntry> idEntries {makeIndex(idKeys)};
+    const QVector<uashm::IndexEntry> nameEntries {makeIndex(nameKeys)};
+    const QVector<uashm::IndexEntry> userEntries {makeIndex(userKeys)};
+
+    const quint64 bitmapOffset {uashm::HeaderSize};
+    const quint64 idIndexOffset {bitmapOffset + static_cast<quint64>(bitmaps.size()) * 8};
+    const quint64 nameIndexOffset {idIndexOffset + static_cast<quint64>(idEntries.size()) * sizeof(uashm::IndexEntry)};
+    const quint64 userIndexOffset {nameIndexOffset + static_cast<quint64>(nameEntries.size()) * sizeof(uashm::IndexEntry)};
+    const quint64 stringsOffset {userIndexOffset + static_cast<quint64>(userEntries.size()) * sizeof(uashm::IndexEntry)};
+    const quint64 imageSize {stringsOffset + static_cast<quint64>(strings.size())};
+    if(imageSize > static_cast<quint64>(segmentSize_) || imageSize > static_cast<quint64>(std::numeric_limits<int>::max())){
+        lastError=QStringLiteral("Compiled policy needs %1 bytes, raise UA_AUTHZ_SHM_SIZE").arg(imageSize);
+        return QByteArray {};
+    }
+
+    QByteArray image(static_cast<int>(imageSize),'\0');
+    {//header, 'sequence' is left to publish()
+        uashm::SegmentHeader* header {reinterpret_cast<uashm::SegmentHeader*>(image.data())};
+        header->magic=uashm::SegmentMagic;
+        header->formatVersion=uashm::SegmentFormatVersion;
+        header->capacity=static_cast<quint64>(segmentSize_);
+        header->policyVersion=policyVersion;
+        header->rolePermCount=static_cast<quint32>(rolePermCount);
+        header->userCount=static_cast<quint32>(userCount);
+        header->wordsPerUser=static_cast<quint32>(wordsPerUser);
+        header->bitmapOffset=static_cast<quint32>(bitmapOffset);
+        header->idIndexOffset=static_cast<quint32>(idIndexOffset);
+        header->nameIndexOffset=static_cast<quint32>(nameIndexOffset);
+        header->userIndexOffset=static_cast<quint32>(userIndexOffset);
+        header->stringsOffset=static_cast<quint32>(stringsOffset);
+    }
+    const auto placeIndex=[&](quint64 offset,const QVector<uashm::IndexEntry>& entries){
+        uashm::IndexEntry* placed {reinterpret_cast<uashm::IndexEntry*>(image.data() + offset)};
+        for(int i=0;i<entries.size();++i){
+            placed[i]=entries.at(i);
+            placed[i].stringOffset+=static_cast<quint32>(stringsOffset);
+        }
+    };
+    std::copy(bitmaps.constBegin(),bitmaps.constEnd(),reinterpret_cast<quint64*>(image.data() + bitmapOffset));
+    placeIndex(idIndexOffset,idEntries);
+    placeIndex(nameIndexOffset,nameEntries);
+    placeIndex(userIndexOffset,userEntries);
+    std::copy(strings.constBegin(),strings.constEnd(),image.data() + stringsOffset);
+    return image;
+}
+
+bool PolicyPublisher::publish(SQL_Handler &sqlHandler, quint64 policyVersion, QString &lastError)
+{
+    const QByteArray image {compile(sqlHandler,policyVersion,lastError)};
+    if(image.isEmpty()){
+        return false;
+    }
+    const uashm::SegmentHeader* imageHeader {reinterpret_cast<const uashm::SegmentHeader*>(image.constData())};
+    uashm::SegmentHeader* segmentHeader {reinterpret_cast<uashm::SegmentHeader*>(segmentData_)};
+    //odd sequence tells readers the segment is being rewritten, a leftover odd value
+    //of a crashed writer is taken over as is
+    const quint64 sequence {segmentHeader->sequence.load(std::memory_order_relaxed) | 1};
+    segmentHeader->sequence.store(sequence,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    segmentHeader->magic=imageHeader->magic;
+    segmentHeader->formatVersion=imageHeader->formatVersion;
+    segmentHeader->capacity=imageHeader->capacity;
+    segmentHeader->policyVersion=imageHeader->policyVersion;
+    segmentHeader->rolePermCount=imageHeader->rolePermCount;
+    segmentHeader->userCount=imageHeader->userCount;
+    segmentHeader->wordsPerUser=imageHeader->wordsPerUser;
+    segmentHeader->bitmapOffset=imageHeader->bitmapOffset;
+    segmentHeader->idIndexOffset=imageHeader->idIndexOffset;
+    segmentHeader->nameIndexOffset=imageHeader->nameIndexOffset;
+    segmentHeader->userIndexOffset=imageHeader->userIndexOffset;
+    segmentHeader->stringsOffset=imageHeader->stringsOffset;
+    std::copy(image.constBegin() + uashm::HeaderSize,image.constEnd(),reinterpret_cast<char*>(segmentData_) + uashm::HeaderSize);
+
+    segmentHeader->sequence.store(sequence + 1,std::memory_order_release);
+    segmentHeader->heartbeat.store(uashm::currentHeartbeat(),std::memory_order_relaxed);
+    segmentHeader->state.store(uashm::StateAvailable,std::memory_order_release);
+    return true;
+}
+
+void PolicyPublisher::run()
+{
+    QString lastError {};
+    if(!openSegment(lastError)){
+        const QString logMsg {QStringLiteral("Policy segment '%1' not opened, error: %2").arg(segmentFile_.fileName(),lastError)};
+        qWarning(qPrintable(logMsg));
+        return;
+    }
+    uashm::SegmentHeader* segmentHeader {reinterpret_cast<uashm::SegmentHeader*>(segmentData_)};
+    SQL_Handler sqlHandler {appSettingsPtr_};
+    quint64 publishedVersion {0};
+    bool isFailing {false};
+    while(!isInterruptionRequested()){
+        const quint64 policyVersion {versionStorePtr_->policyVersion()};
+        if(policyVersion!=publishedVersion){
+            lastError.clear();
+            if(publish(sqlHandler,policyVersion,lastError)){
+                publishedVersion=policyVersion;
+                isFailing=false;
+            }
+            else if(!isFailing){
+                //logged once per outage, the attempt is repeated every second
+                const QString logMsg {QStringLiteral("Policy segment not published, error: %1").arg(lastError)};
+                qWarning(qPrintable(logMsg));
+                isFailing=true;
+            }
+        }
+        else{
+            //not refreshed while publishing fails, readers stop trusting the segment after their maximum age
+            segmentHeader->heartbeat.store(uashm::currentHeartbeat(),std::memory_order_relaxed);
+        }
+        //returns on the next bump, the timeout bounds shutdown, retry delay and heartbeat interval
+        versionStorePtr_->waitForPolicyVersion(policyVersion + 1,1000);
+    }
+    //readers go to http at once instead of waiting out the heartbeat
+    segmentHeader->state.store(uashm::StateUnavailable,std::memory_order_release);
+}
+
+PolicyPublisher::PolicyPublisher(const QString &segmentPath, qint64 segmentSize, QSharedPointer<QSettings> appSettingsPtr,
+                                 QSharedPointer<VersionStore> versionStorePtr, QSharedPointer<PolicyCache> policyCachePtr, QObject *parent)
+    :QThread{parent},appSettingsPtr_{appSettingsPtr},versionStorePtr_{versionStorePtr},policyCachePtr_{policyCachePtr},
+     segmentFile_{segmentPath},segmentSize_{segmentSize}
+{
+}
+
+PolicyPublisher::~PolicyPublisher()
+{
+    requestInterruption();
+    wait();
+    if(segmentData_){
+        segmentFile_.unmap(segmentData_);
+    }
+}
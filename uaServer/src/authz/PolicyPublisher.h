@@ -0,0 +1,47 @@
+#ifndef POLICYPUBLISHER_H
+#define POLICYPUBLISHER_H
+
+#include <QFile>
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QSharedPointer>
+
+class QSettings;
+class SQL_Handler;
+class PolicyCache;
+class VersionStore;
+
+//Compiles PolicyCache content into the shared memory segment read by
+//lib/uashm/src/SharedPolicy.h, see there for the layout.
+//Runs in its own thread, wakes up on every policy version bump, so co-located
+//processes see a change about as soon as request threads do. Between bumps it
+//refreshes the segment heartbeat, on stop it marks the segment unavailable.
+class PolicyPublisher : public QThread
+{
+    Q_OBJECT
+private:
+    QSharedPointer<QSettings> appSettingsPtr_ {nullptr};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
+    QFile segmentFile_ {};
+    uchar* segmentData_ {nullptr};
+    qint64 segmentSize_ {0};
+
+    //Exclusive Lock On Segment File, Held Until It Is Closed, False If Another Process Holds It
+    bool lockSegment();
+    //Open, Wait For The Lock, Then Size And Map Segment
+    bool openSegment(QString& lastError);
+    bool publish(SQL_Handler& sqlHandler,quint64 policyVersion,QString& lastError);
+    QByteArray compile(SQL_Handler& sqlHandler,quint64 policyVersion,QString& lastError);
+
+protected:
+    virtual void run()override;
+
+public:
+    PolicyPublisher(const QString& segmentPath,qint64 segmentSize,QSharedPointer<QSettings> appSettingsPtr,
+                    QSharedPointer<VersionStore> versionStorePtr,QSharedPointer<PolicyCache> policyCachePtr,QObject* parent=nullptr);
+    ~PolicyPublisher();
+};
+
+#endif // POLICYPUBLISHER_H
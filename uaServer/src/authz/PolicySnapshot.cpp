@@ -0,0 +1,275 @@
+#include "PolicySnapshot.h"
+
+#include <QSet>
+#include <QPair>
+#include <QStack>
+#include <QQueue>
+#include <QJsonObject>
+
+QJsonArray PolicySnapshot::expand(const QStringList &rootIds, int maxDepth, bool withDepth, bool withPath) const
+{
+    QJsonArray rolePermObjects {};
+    QHash<QString,int> depths {};
+    QHash<QString,QString> parentIds {};
+    QQueue<QString> queue {};
+    for(const QString& rootId: rootIds){
+        const QString id {rootId.toLower()};
+        if(rolePerms.contains(id) && !depths.contains(id)){
+            depths.insert(id,0);
+            queue.enqueue(id);
+        }
+    }
+    //first visit is the shortest path, so depth and path are minimal
+    while(!queue.isEmpty()){
+        const QString id {queue.dequeue()};
+        const int depth {depths.value(id)};
+        const RolePerm rolePerm {rolePerms.value(id)};
+        QJsonObject rolePermObject {
+            {"id",rolePerm.id},
+            {"name",rolePerm.name},
+            {"type",rolePerm.type}
+        };
+        if(withDepth){
+            rolePermObject.insert("depth",depth);
+        }
+        if(withPath){
+            QStringList pathNames {};
+            for(QString pathId {id};!pathId.isEmpty();pathId=parentIds.value(pathId)){
+                pathNames.prepend(rolePerms.value(pathId).name);
+            }
+            rolePermObject.insert("path",QJsonArray::fromStringList(pathNames));
+        }
+        rolePermObjects.push_back(rolePermObject);
+
+        if(maxDepth >= 0 && depth >= maxDepth){
+            continue;
+        }
+        const QStringList ids {childIds.value(id)};
+        for(const QString& childId: ids){
+            if(depths.contains(childId) || !rolePerms.contains(childId)){
+                continue;
+            }
+            depths.insert(childId,depth + 1);
+            parentIds.insert(childId,id);
+            queue.enqueue(childId);
+        }
+    }
+    return rolePermObjects;
+}
+
+QStringList PolicySnapshot::ancestors(const QString &id) const
+{
+    QStringList ancestorIds {};
+    QSet<QString> visitedIds {};
+    QQueue<QString> queue {};
+    const QString rootId {id.toLower()};
+    if(!rolePerms.contains(rootId)){
+        return ancestorIds;
+    }
+    visitedIds.insert(rootId);
+    queue.enqueue(rootId);
+    while(!queue.isEmpty()){
+        const QString currentId {queue.dequeue()};
+        ancestorIds.push_back(currentId);
+        const QStringList ids {parentIds.value(currentId)};
+        for(const QString& parentId: ids){
+            if(visitedIds.contains(parentId)){
+                continue;
+            }
+            visitedIds.insert(parentId);
+            queue.enqueue(parentId);
+        }
+    }
+    return ancestorIds;
+}
+
+QStringList PolicySnapshot::idsByNames(const QStringList &names) const
+{
+    QStringList ids {};
+    for(const QString& name: names){
+        const auto it {nameIds.find(name)};
+        if(it!=nameIds.end()){
+            ids.push_back(it.value());
+        }
+    }
+    return ids;
+}
+
+QJsonObject PolicySnapshot::rolePermObject(const QString &id) const
+{
+    const auto it {rolePerms.find(id.toLower())};
+    if(it==rolePerms.end()){
+        return QJsonObject {};
+    }
+    return QJsonObject {
+        {"id",it->id},
+        {"name",it->name},
+        {"type",it->type.isEmpty() ? QJsonValue(QJsonValue::Null) : QJsonValue(it->type)},
+        {"description",it->description}
+    };
+}
+
+QJsonObject PolicySnapshot::rolePermDetailObject(const QString &id) const
+{
+    QJsonObject rolePermObject {this->rolePermObject(id)};
+    if(rolePermObject.isEmpty()){
+        return rolePermObject;
+    }
+    QJsonArray childObjects {};
+    const QStringList ids {childIds.value(id.toLower())};
+    for(const QString& childId: ids){
+        const QJsonObject childObject {this->rolePermObject(childId)};
+        if(!childObject.isEmpty()){
+            childObjects.push_back(childObject);
+        }
+    }
+    rolePermObject.insert("children",childObjects);
+    return rolePermObject;
+}
+
+QJsonArray PolicySnapshot::rolePermObjects(const QString &nameFilter, const QString &typeFilter, int limit, int offset) const
+{
+    QJsonArray rolePermObjects {};
+    const QStringList ids {typeFilter.isEmpty() ? orderedIds : typeIds.value(typeFilter)};
+    int skipCount {0};
+    for(const QString& id: ids){
+        if(rolePermObjects.size() >= limit){
+            break;
+        }
+        if(!nameFilter.isEmpty() && !rolePerms.value(id).name.contains(nameFilter,Qt::CaseInsensitive)){
+            continue;
+        }
+        if(skipCount < offset){
+            ++skipCount;
+            continue;
+        }
+        rolePermObjects.push_back(rolePermObject(id));
+    }
+    return rolePermObjects;
+}
+
+QHash<QString,int> PolicySnapshot::longestPaths(const QStringList &startIds, const QHash<QString, QStringList> &edges)
+{
+    //iterative post-order dfs, a node is finished once all its successors are,
+    //an edge back to a node still on the stack is a stored cycle and is skipped
+    QHash<QString,int> pathLengths {};
+    QSet<QString> activeIds {};
+    QStack<QPair<QString,int>> stack {};
+    for(const QString& startId: startIds){
+        if(pathLengths.contains(startId)){
+            continue;
+        }
+        stack.push(qMakePair(startId,0));
+        activeIds.insert(startId);
+        while(!stack.isEmpty()){
+            QPair<QString,int>& top {stack.top()};
+            const QStringList nextIds {edges.value(top.first)};
+            if(top.second < nextIds.size()){
+                const QString nextId {nextIds.at(top.second++)};
+                if(!pathLengths.contains(nextId) && !activeIds.contains(nextId)){
+                    activeIds.insert(nextId);
+                    stack.push(qMakePair(nextId,0));
+                }
+                continue;
+            }
+            int pathLength {0};
+            for(const QString& nextId: nextIds){
+                if(pathLengths.contains(nextId)){
+                    pathLength=qMax(pathLength,pathLengths.value(nextId) + 1);
+                }
+            }
+            pathLengths.insert(top.first,pathLength);
+            activeIds.remove(top.first);
+            stack.pop();
+        }
+    }
+    return pathLengths;
+}
+
+bool PolicySnapshot::isReachable(const QString &fromId, const QString &toId) const
+{
+    const QString targetId {toId.toLower()};
+    QSet<QString> visitedIds {fromId.toLower()};
+    QStack<QString> stack {};
+    stack.push(fromId.toLower());
+    while(!stack.isEmpty()){
+        const QString id {stack.pop()};
+        if(id==targetId){
+            return true;
+        }
+        const QStringList ids {childIds.value(id)};
+        for(const QString& childId: ids){
+            if(!visitedIds.contains(childId)){
+                visitedIds.insert(childId);
+                stack.push(childId);
+            }
+        }
+    }
+    return false;
+}
+
+int PolicySnapshot::depthBelow(const QString &id) const
+{
+    return longestPaths({id.toLower()},childIds).value(id.toLower());
+}
+
+int PolicySnapshot::depthAbove(const QString &id) const
+{
+    return longestPaths({id.toLower()},parentIds).value(id.toLower());
+}
+
+QJsonObject PolicySnapshot::hierarchyStats() const
+{
+    int edgeCount {0};
+    int parentCount {0};
+    int maxFanOut {0};
+    int maxFanIn {0};
+    QString maxFanOutId {};
+    QString maxFanInId {};
+    for(auto it=childIds.cbegin();it!=childIds.cend();++it){
+        edgeCount+=it->size();
+        ++parentCount;
+        if(it->size() > maxFanOut){
+            maxFanOut=it->size();
+            maxFanOutId=it.key();
+        }
+    }
+    for(auto it=parentIds.cbegin();it!=parentIds.cend();++it){
+        if(it->size() > maxFanIn){
+            maxFanIn=it->size();
+            maxFanInId=it.key();
+        }
+    }
+    QStringList rootIds {};
+    int leafCount {0};
+    for(const QString& id: orderedIds){
+        if(!parentIds.contains(id)){
+            rootIds.push_back(id);
+        }
+        if(!childIds.contains(id)){
+            ++leafCount;
+        }
+    }
+    const QHash<QString,int> pathLengths {longestPaths(rootIds,childIds)};
+    int maxDepth {0};
+    for(auto it=pathLengths.cbegin();it!=pathLengths.cend();++it){
+        maxDepth=qMax(maxDepth,it.value());
+    }
+    const auto nameOrNull {[&](const QString& id){
+            return id.isEmpty() ? QJsonValue(QJsonValue::Null) : QJsonValue(rolePerms.value(id).name);
+        }
+    };
+    return QJsonObject {
+        {"policy_version",static_cast<qint64>(version)},
+        {"nodes",orderedIds.size()},
+        {"edges",edgeCount},
+        {"roots",rootIds.size()},
+        {"leaves",leafCount},
+        {"max_depth",maxDepth},
+        {"avg_fan_out",parentCount > 0 ? static_cast<double>(edgeCount) / parentCount : 0.0},
+        {"max_fan_out",maxFanOut},
+        {"max_fan_out_name",nameOrNull(maxFanOutId)},
+        {"max_fan_in",maxFanIn},
+        {"max_fan_in_name",nameOrNull(maxFanInId)}
+    };
+}
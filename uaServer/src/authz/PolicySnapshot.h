@@ -0,0 +1,59 @@
+#ifndef POLICYSNAPSHOT_H
+#define POLICYSNAPSHOT_H
+
+#include <QHash>
+#include <QString>
+#include <QJsonArray>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QStringList>
+
+//Immutable in-memory copy of 'roles_permissions' and 'roles_permissions_relationship',
+//shared between request threads once built, so it must not be changed after loading.
+//Rows are indexed by id, name and type; 'orderedIds' keeps the table scan order.
+struct PolicySnapshot
+{
+    struct RolePerm{
+        QString id {};
+        QString name {};
+        QString type {};
+        QJsonValue description {QJsonValue::Null};
+    };
+
+    quint64 version {0};
+    //ms since epoch when loading started, every change committed before it is included
+    qint64 loadedAt {0};
+    QHash<QString,RolePerm> rolePerms {};
+    QStringList orderedIds {};
+    QHash<QString,QString> nameIds {};
+    QHash<QString,QStringList> typeIds {};
+    QHash<QString,QStringList> childIds {};
+    QHash<QString,QStringList> parentIds {};
+
+    //Transitive Closure Of 'rootIds' In Breadth-First Order, 'maxDepth' < 0 Means Unlimited
+    QJsonArray expand(const QStringList& rootIds,int maxDepth,bool withDepth,bool withPath) const;
+    //Ids Of Known Names, Unknown Names Are Skipped
+    QStringList idsByNames(const QStringList& names) const;
+    //Id Itself And Every Role It Is Reachable From, Holders Of Any Of Them Hold 'id'
+    QStringList ancestors(const QString& id) const;
+
+    //Row As Returned By 'SELECT * FROM roles_permissions', Empty If Unknown
+    QJsonObject rolePermObject(const QString& id) const;
+    //Row With 'children' Rows, As Returned By Detail Query, Empty If Unknown
+    QJsonObject rolePermDetailObject(const QString& id) const;
+    //Page Of Rows Filtered Like "name ILIKE '%nameFilter%' AND type='typeFilter'", Empty Filters Are Skipped
+    QJsonArray rolePermObjects(const QString& nameFilter,const QString& typeFilter,int limit,int offset) const;
+
+    //True If 'toId' Is 'fromId' Or One Of Its Descendants, O(V+E)
+    bool isReachable(const QString& fromId,const QString& toId) const;
+    //Edges On Longest Path Down To A Leaf / Up To A Root, Cycles Already Stored Are Cut
+    int depthBelow(const QString& id) const;
+    int depthAbove(const QString& id) const;
+    //Node/Edge Counts, Longest Path, Fan-Out And Fan-In
+    QJsonObject hierarchyStats() const;
+
+private:
+    static QHash<QString,int> longestPaths(const QStringList& startIds,const QHash<QString,QStringList>& edges);
+};
+
+#endif // POLICYSNAPSHOT_H
@@ -0,0 +1,240 @@
+#include "SnapshotFile.h"
+
+#include <QFile>
+#include <QHash>
+#include <QVector>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QCryptographicHash>
+
+namespace{
+//magic, format version, snapshot version, assignment index version, payload size, SHA-256
+const int headerSize {4 + 4 + 8 + 8 + 4 + 32};
+}
+
+bool SnapshotFile::isValidCsr(const QVector<quint32> &offsets, const QVector<quint32> &targets, int rowCount, int idCount)
+{
+    if(offsets.size()!=rowCount + 1 || offsets.first()!=0 || offsets.last()!=static_cast<quint32>(targets.size())){
+        return false;
+    }
+    for(int i=1;i<offsets.size();++i){
+        if(offsets.at(i) < offsets.at(i - 1)){
+            return false;
+        }
+    }
+    for(const quint32 target: targets){
+        if(target >= static_cast<quint32>(idCount)){
+            return false;
+        }
+    }
+    return true;
+}
+
+QByteArray SnapshotFile::makePayload(const PolicySnapshot &snapshot, const AssignmentIndex &assignmentIndex)
+{
+    QVector<QString> ids {};
+    QHash<QString,quint32> idIndexes {};
+    const auto intern=[&](const QString& id)->quint32{
+        const auto it {idIndexes.constFind(id)};
+        if(it!=idIndexes.constEnd()){
+            return it.value();
+        }
+        const quint32 index {static_cast<quint32>(ids.size())};
+        ids.push_back(id);
+        idIndexes.insert(id,index);
+        return index;
+    };
+
+    QVector<quint32> rolePermIndexes {};
+    QVector<QString> names {};
+    QVector<QString> types {};
+    QVector<QString> descriptions {};
+    QVector<quint32> childOffsets {0};
+    QVector<quint32> childIndexes {};
+    for(const QString& id: snapshot.orderedIds){
+        const PolicySnapshot::RolePerm rolePerm {snapshot.rolePerms.value(id)};
+        rolePermIndexes.push_back(intern(id));
+        names.push_back(rolePerm.name);
+        types.push_back(rolePerm.type);
+        //null string stands for NULL description, so an empty one is kept non-null
+        const QString description {rolePerm.description.toString()};
+        descriptions.push_back(rolePerm.description.isNull() ? QString {} : description.isNull() ? QString {""} : description);
+    }
+    for(const QString& id: snapshot.orderedIds){
+        for(const QString& childId: snapshot.childIds.value(id)){
+            childIndexes.push_back(intern(childId));
+        }
+        childOffsets.push_back(static_cast<quint32>(childIndexes.size()));
+    }
+
+    QVector<quint32> assignedIndexes {};
+    QVector<quint32> userOffsets {0};
+    QVector<quint32> userIndexes {};
+    for(auto it=assignmentIndex.userIds.constBegin();it!=assignmentIndex.userIds.constEnd();++it){
+        assignedIndexes.push_back(intern(it.key()));
+        for(const QString& userId: it.value()){
+            userIndexes.push_back(intern(userId));
+        }
+        userOffsets.push_back(static_cast<quint32>(userIndexes.size()));
+    }
+
+    QByteArray payload {};
+    QDataStream stream {&payload,QIODevice::WriteOnly};
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream<<ids<<rolePermIndexes<<names<<types<<descriptions<<childOffsets<<childIndexes
+          <<assignedIndexes<<userOffsets<<userIndexes;
+    return payload;
+}
+
+bool SnapshotFile::parsePayload(const QByteArray &payload, PolicySnapshot &outSnapshot, AssignmentIndex &outAssignmentIndex, QString &lastError)
+{
+    QVector<QString> ids {};
+    QVector<quint32> rolePermIndexes {};
+    QVector<QString> names {};
+    QVector<QString> types {};
+    QVector<QString> descriptions {};
+    QVector<quint32> childOffsets {};
+    QVector<quint32> childIndexes {};
+    QVector<quint32> assignedIndexes {};
+    QVector<quint32> userOffsets {};
+    QVector<quint32> userIndexes {};
+
+    QDataStream stream {payload};
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream>>ids>>rolePermIndexes>>names>>types>>descriptions>>childOffsets>>childIndexes
+          >>assignedIndexes>>userOffsets>>userIndexes;
+    if(stream.status()!=QDataStream::Ok || !stream.atEnd()){
+        lastError=QStringLiteral("Snapshot payload is truncated or malformed");
+        return false;
+    }
+
+    const int rolePermCount {rolePermIndexes.size()};
+    const bool isValid {names.size()==rolePermCount && types.size()==rolePermCount && descriptions.size()==rolePermCount
+                        && isValidCsr(childOffsets,childIndexes,rolePermCount,ids.size())
+                        && isValidCsr(userOffsets,userIndexes,assignedIndexes.size(),ids.size())
+                        && isValidCsr(QVector<quint32> {0,static_cast<quint32>(rolePermCount)},rolePermIndexes,1,ids.size())
+                        && isValidCsr(QVector<quint32> {0,static_cast<quint32>(assignedIndexes.size())},assignedIndexes,1,ids.size())};
+    if(!isValid){
+        lastError=QStringLiteral("Snapshot payload arrays are inconsistent");
+        return false;
+    }
+
+    {//rebuild roles/permissions and hierarchy
+        for(int i=0;i<rolePermCount;++i){
+            PolicySnapshot::RolePerm rolePerm {};
+            rolePerm.id=ids.at(static_cast<int>(rolePermIndexes.at(i)));
+            rolePerm.name=names.at(i);
+            rolePerm.type=types.at(i);
+            if(!descriptions.at(i).isNull()){
+                rolePerm.description=descriptions.at(i);
+            }
+            outSnapshot.rolePerms.insert(rolePerm.id,rolePerm);
+            outSnapshot.orderedIds.push_back(rolePerm.id);
+            outSnapshot.nameIds.insert(rolePerm.name,rolePerm.id);
+            outSnapshot.typeIds[rolePerm.type].push_back(rolePerm.id);
+        }
+        for(int i=0;i<rolePermCount;++i){
+            const QString parentId {outSnapshot.orderedIds.at(i)};
+            for(quint32 j=childOffsets.at(i);j<childOffsets.at(i + 1);++j){
+                const QString childId {ids.at(static_cast<int>(childIndexes.at(static_cast<int>(j))))};
+                outSnapshot.childIds[parentId].push_back(childId);
+                outSnapshot.parentIds[childId].push_back(parentId);
+            }
+        }
+    }
+    {//rebuild assignments, user ids were written sorted
+        for(int i=0;i<assignedIndexes.size();++i){
+            QVector<QString>& userIds {outAssignmentIndex.userIds[ids.at(static_cast<int>(assignedIndexes.at(i)))]};
+            userIds.reserve(static_cast<int>(userOffsets.at(i + 1) - userOffsets.at(i)));
+            for(quint32 j=userOffsets.at(i);j<userOffsets.at(i + 1);++j){
+                userIds.push_back(ids.at(static_cast<int>(userIndexes.at(static_cast<int>(j)))));
+            }
+        }
+    }
+    return true;
+}
+
+bool SnapshotFile::write(const QString &filePath, const PolicySnapshot &snapshot, const AssignmentIndex &assignmentIndex, QString &lastError)
+{
+    const QByteArray payload {makePayload(snapshot,assignmentIndex)};
+    const QByteArray checksum {QCryptographicHash::hash(payload,QCryptographicHash::Sha256)};
+
+    QSaveFile file {filePath};
+    if(!file.open(QIODevice::WriteOnly)){
+        lastError=file.errorString();
+        return false;
+    }
+    {//write header and payload
+        QDataStream stream {&file};
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream<<magic_<<formatVersion_<<snapshot.version<<assignmentIndex.version<<static_cast<quint32>(payload.size());
+        stream.writeRawData(checksum.constData(),checksum.size());
+        stream.writeRawData(payload.constData(),payload.size());
+        if(stream.status()!=QDataStream::Ok){
+            lastError=file.errorString();
+            file.cancelWriting();
+            return false;
+        }
+    }
+    //renamed over the previous file only now, readers never see a partial file
+    if(!file.commit()){
+        lastError=file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotFile::read(const QString &filePath, PolicySnapshot &outSnapshot, AssignmentIndex &outAssignmentIndex, QString &lastError)
+{
+    QFile file {filePath};
+    if(!file.open(QIODevice::ReadOnly)){
+        lastError=file.errorString();
+        return false;
+    }
+    const qint64 fileSize {file.size()};
+    if(fileSize < headerSize){
+        lastError=QStringLiteral("Snapshot file '%1' is too short").arg(filePath);
+        return false;
+    }
+    uchar* fileData {file.map(0,fileSize)};
+    if(!fileData){
+        lastError=file.errorString();
+        return false;
+    }
+    bool isOk {false};
+    {//verify header and payload
+        const QByteArray header {QByteArray::fromRawData(reinterpret_cast<const char*>(fileData),headerSize)};
+        QDataStream stream {header};
+        stream.setVersion(QDataStream::Qt_5_0);
+        quint32 magic {0};
+        quint32 formatVersion {0};
+        quint64 snapshotVersion {0};
+        quint64 assignmentIndexVersion {0};
+        quint32 payloadSize {0};
+        stream>>magic>>formatVersion>>snapshotVersion>>assignmentIndexVersion>>payloadSize;
+        const QByteArray checksum {header.right(32)};
+        if(magic!=magic_ || formatVersion!=formatVersion_){
+            lastError=QStringLiteral("Snapshot file '%1' has unknown format").arg(filePath);
+            goto end;
+        }
+        if(static_cast<qint64>(payloadSize)!=fileSize - headerSize){
+            lastError=QStringLiteral("Snapshot file '%1' size mismatch").arg(filePath);
+            goto end;
+        }
+        //payload is parsed right from the mapping, no intermediate copy of the file
+        const QByteArray payload {QByteArray::fromRawData(reinterpret_cast<const char*>(fileData) + headerSize,static_cast<int>(payloadSize))};
+        if(QCryptographicHash::hash(payload,QCryptographicHash::Sha256)!=checksum){
+            lastError=QStringLiteral("Snapshot file '%1' checksum mismatch").arg(filePath);
+            goto end;
+        }
+        if(!parsePayload(payload,outSnapshot,outAssignmentIndex,lastError)){
+            goto end;
+        }
+        outSnapshot.version=snapshotVersion;
+        outAssignmentIndex.version=assignmentIndexVersion;
+        isOk=true;
+    }
+end:
+    file.unmap(fileData);
+    return isOk;
+}
@@ -0,0 +1,35 @@
+#ifndef SNAPSHOTFILE_H
+#define SNAPSHOTFILE_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+#include "PolicySnapshot.h"
+#include "AssignmentIndex.h"
+
+//On-disk copy of PolicySnapshot and AssignmentIndex for warm startup.
+//Layout: header (magic, format version, versions of both parts, payload size, SHA-256 of payload)
+//followed by the payload: interned id table, roles/permissions rows, hierarchy as
+//CSR arrays (offsets per role/permission, child id indexes) and direct assignments
+//as CSR arrays (offsets per role/permission, user id indexes).
+//Versions are 'change_log' sequences (see VersionStore): changes logged after them may
+//be missing from the file, PolicyCache replays them or refuses the part.
+class SnapshotFile
+{
+private:
+    static const quint32 magic_ {0x55415350};
+    static const quint32 formatVersion_ {2};
+
+    static bool isValidCsr(const QVector<quint32>& offsets,const QVector<quint32>& targets,int rowCount,int idCount);
+    static QByteArray makePayload(const PolicySnapshot& snapshot,const AssignmentIndex& assignmentIndex);
+    static bool parsePayload(const QByteArray& payload,PolicySnapshot& outSnapshot,AssignmentIndex& outAssignmentIndex,QString& lastError);
+
+public:
+    //Write Atomically, The Previous File Stays Intact On Failure
+    static bool write(const QString& filePath,const PolicySnapshot& snapshot,const AssignmentIndex& assignmentIndex,QString& lastError);
+    //Map And Verify File, Then Rebuild Snapshot And Index With Their Versions From It
+    static bool read(const QString& filePath,PolicySnapshot& outSnapshot,AssignmentIndex& outAssignmentIndex,QString& lastError);
+};
+
+#endif // SNAPSHOTFILE_H
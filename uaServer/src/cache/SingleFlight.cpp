@@ -0,0 +1,42 @@
+#include "SingleFlight.h"
+
+#include <QMutexLocker>
+
+SingleFlight::Result SingleFlight::run(const QString &key, const Handler &handler)
+{
+    QSharedPointer<Call> callPtr {nullptr};
+    {
+        QMutexLocker locker {&mutex_};
+        const auto it {calls_.find(key)};
+        if(it!=calls_.end()){
+            callPtr=it.value();
+            shared_.fetchAndAddRelaxed(1);
+            while(!callPtr->isFinished){
+                callPtr->finished.wait(&mutex_);
+            }
+            return callPtr->result;
+        }
+        callPtr.reset(new Call);
+        calls_.insert(key,callPtr);
+    }
+    executed_.fetchAndAddRelaxed(1);
+    const Result result {handler()};
+    {
+        QMutexLocker locker {&mutex_};
+        callPtr->result=result;
+        callPtr->isFinished=true;
+        calls_.remove(key);
+        callPtr->finished.wakeAll();
+    }
+    return result;
+}
+
+QByteArray SingleFlight::metrics() const
+{
+    return "# HELP uauth_singleflight_executed_total Coalesced reads executed against database.\n"
+           "# TYPE uauth_singleflight_executed_total counter\n"
+           "uauth_singleflight_executed_total " + QByteArray::number(executed_.loadAcquire()) + "\n"
+           "# HELP uauth_singleflight_shared_total Reads answered with the result of an identical in-flight read.\n"
+           "# TYPE uauth_singleflight_shared_total counter\n"
+           "uauth_singleflight_shared_total " + QByteArray::number(shared_.loadAcquire()) + "\n";
+}
@@ -0,0 +1,52 @@
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+#include <functional>
+
+#include "../postgres/SQL_Handler.h"
+
+//Coalesces identical concurrent reads: the first caller of a key runs the
+//handler, callers arriving with the same key while it runs wait and get a copy
+//of its result. Nothing is kept once the call completes, so this is not a cache;
+//keys must carry everything the result depends on (versions, authorization).
+class SingleFlight
+{
+public:
+    struct Result{
+        SQL_Status sqlStatus {SQL_Status::BadRequest};
+        QJsonObject object {};
+        QString lastError {};
+    };
+    using Handler=std::function<Result()>;
+
+private:
+    struct Call{
+        QWaitCondition finished;
+        bool isFinished {false};
+        Result result {};
+    };
+
+    QMutex mutex_;
+    QHash<QString,QSharedPointer<Call>> calls_ {};
+    QAtomicInteger<quint64> executed_ {0};
+    QAtomicInteger<quint64> shared_ {0};
+
+public:
+    SingleFlight()=default;
+    ~SingleFlight()=default;
+
+    Result run(const QString& key,const Handler& handler);
+
+    //Counters In Prometheus Text Format
+    QByteArray metrics() const;
+};
+
+#endif // SINGLEFLIGHT_H
@@ -0,0 +1,160 @@
+#include "VersionStore.h"
+
+#include <QList>
+#include <QElapsedTimer>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QCryptographicHash>
+
+quint64 VersionStore::tableVersion(const QString &tableName) const
+{
+    QReadLocker locker {&lock_};
+    return tableVersions_.value(tableName,baseVersion_);
+}
+
+quint64 VersionStore::entityVersion(const QString &tableName, const QString &entityId) const
+{
+    QReadLocker locker {&lock_};
+    const quint64 entityVersion {entityVersions_.value(tableName + ":" + entityId.toLower(),baseVersion_)};
+    return qMax(entityVersion,tableWideVersions_.value(tableName,baseVersion_));
+}
+
+quint64 VersionStore::getPolicyVersion() const
+{
+    const QStringList policyTableNames {"roles_permissions","roles_permissions_relationship","users_roles_permissions"};
+    quint64 version {0};
+    for(const QString& tableName: policyTableNames){
+        version=qMax(version,tableVersions_.value(tableName,baseVersion_));
+    }
+    return version;
+}
+
+quint64 VersionStore::policyVersion() const
+{
+    QReadLocker locker {&lock_};
+    return getPolicyVersion();
+}
+
+bool VersionStore::waitForPolicyVersion(quint64 minVersion, int timeout) const
+{
+    QElapsedTimer elapsedTimer {};
+    elapsedTimer.start();
+    QReadLocker locker {&lock_};
+    while(getPolicyVersion() < minVersion){
+        const qint64 remainingTime {timeout - elapsedTimer.elapsed()};
+        if(remainingTime <= 0){
+            return false;
+        }
+        versionChanged_.wait(&lock_,static_cast<unsigned long>(remainingTime));
+    }
+    return true;
+}
+
+quint64 VersionStore::generation() const
+{
+    QReadLocker locker {&lock_};
+    return generation_;
+}
+
+bool VersionStore::waitForGeneration(quint64 minGeneration, int timeout) const
+{
+    QElapsedTimer elapsedTimer {};
+    elapsedTimer.start();
+    QReadLocker locker {&lock_};
+    while(generation_ < minGeneration){
+        const qint64 remainingTime {timeout - elapsedTimer.elapsed()};
+        if(remainingTime <= 0){
+            return false;
+        }
+        versionChanged_.wait(&lock_,static_cast<unsigned long>(remainingTime));
+    }
+    return true;
+}
+
+void VersionStore::reset(quint64 generation, const QHash<QString, quint64> &tableVersions)
+{
+    QWriteLocker locker {&lock_};
+    //every version known so far stays a lower bound, so stamps taken before are never matched again by chance
+    QHash<QString,quint64> newTableVersions {};
+    for(auto it=tableVersions.cbegin();it!=tableVersions.cend();++it){
+        newTableVersions.insert(it.key(),qMax(it.value(),tableVersions_.value(it.key(),baseVersion_)));
+    }
+    for(auto it=tableVersions_.cbegin();it!=tableVersions_.cend();++it){
+        if(!newTableVersions.contains(it.key())){
+            newTableVersions.insert(it.key(),qMax(generation,it.value()));
+        }
+    }
+    quint64 baseVersion {qMax(baseVersion_,generation)};
+    for(const quint64 version: tableWideVersions_){
+        baseVersion=qMax(baseVersion,version);
+    }
+    for(const quint64 version: entityVersions_){
+        baseVersion=qMax(baseVersion,version);
+    }
+    baseVersion_=baseVersion;
+    generation_=qMax(generation_,generation);
+    tableVersions_=newTableVersions;
+    tableWideVersions_.clear();
+    entityVersions_.clear();
+    versionChanged_.wakeAll();
+}
+
+void VersionStore::advance(quint64 generation)
+{
+    QWriteLocker locker {&lock_};
+    if(generation > generation_){
+        generation_=generation;
+        versionChanged_.wakeAll();
+    }
+}
+
+void VersionStore::bumpTable(const QString &tableName, quint64 version)
+{
+    QWriteLocker locker {&lock_};
+    tableVersions_.insert(tableName,qMax(version,tableVersions_.value(tableName,baseVersion_)));
+    tableWideVersions_.insert(tableName,qMax(version,tableWideVersions_.value(tableName,baseVersion_)));
+    versionChanged_.wakeAll();
+}
+
+void VersionStore::bumpEntity(const QString &tableName, const QString &entityId, quint64 version)
+{
+    QWriteLocker locker {&lock_};
+    const QString entityKey {tableName + ":" + entityId.toLower()};
+    tableVersions_.insert(tableName,qMax(version,tableVersions_.value(tableName,baseVersion_)));
+    entityVersions_.insert(entityKey,qMax(version,entityVersions_.value(entityKey,baseVersion_)));
+    versionChanged_.wakeAll();
+}
+
+void VersionStore::setDatabaseId(const QString &databaseId)
+{
+    QWriteLocker locker {&lock_};
+    databaseId_=databaseId;
+}
+
+QByteArray VersionStore::makeETag(const QStringList &parts) const
+{
+    //parts may carry ids, hashing keeps the tag opaque and short; the database identity keeps
+    //tags of a database rebuilt from scratch, whose sequences start over, from matching
+    QReadLocker locker {&lock_};
+    const QByteArray data {databaseId_.toUtf8() + "|" + parts.join("|").toUtf8()};
+    const QByteArray hash {QCryptographicHash::hash(data,QCryptographicHash::Sha1).toHex().left(32)};
+    return "W/\"" + hash + "\"";
+}
+
+bool VersionStore::isETagMatch(const QByteArray &ifNoneMatch, const QByteArray &eTag)
+{
+    //'If-None-Match' uses weak comparison, so 'W/' prefixes are ignored,
+    //'*' is not honoured since it would answer before authorization
+    const auto opaqueTag {[](const QByteArray& tag){
+            const QByteArray trimmedTag {tag.trimmed()};
+            return trimmedTag.startsWith("W/") ? trimmedTag.mid(2) : trimmedTag;
+        }
+    };
+    const QList<QByteArray> tags {ifNoneMatch.split(',')};
+    for(const QByteArray& tag: tags){
+        if(opaqueTag(tag)==opaqueTag(eTag)){
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,66 @@
+#ifndef VERSIONSTORE_H
+#define VERSIONSTORE_H
+
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+#include <QWaitCondition>
+#include <QReadWriteLock>
+
+//In-memory versions of tables and single entities, used to build weak ETags, to stamp
+//caches and as 'X-UAuth-Policy-Version'. Versions are 'change_log' sequences (see uaTables),
+//so they mean the same on every uaServer instance and across restarts. SQL_Listener applies
+//the log in order and moves the generation, the last sequence whose changes are reflected
+//here; a table or entity that did not change since the listener started carries the
+//generation it started from. Versions never go down. ETags are seeded with the identity
+//of the database (see 'change_log_trim'), not of the process, so they match everywhere too.
+class VersionStore
+{
+private:
+    mutable QReadWriteLock lock_;
+    mutable QWaitCondition versionChanged_;
+    QString databaseId_ {};
+    quint64 baseVersion_ {0};
+    quint64 generation_ {0};
+    QHash<QString,quint64> tableVersions_ {};
+    QHash<QString,quint64> tableWideVersions_ {};
+    QHash<QString,quint64> entityVersions_ {};
+
+    quint64 getPolicyVersion() const;
+
+public:
+    VersionStore()=default;
+    ~VersionStore()=default;
+
+    //Version Changed By Any Write To Table
+    quint64 tableVersion(const QString& tableName) const;
+    //Version Changed By Writes To Entity Or By Table-Wide Writes
+    quint64 entityVersion(const QString& tableName,const QString& entityId) const;
+
+    //Generation Of Roles/Permissions, Hierarchy And Assignments
+    quint64 policyVersion() const;
+    //Wait Up To 'timeout' ms Until Policy Version Reaches 'minVersion'
+    bool waitForPolicyVersion(quint64 minVersion,int timeout) const;
+    //Last Change Log Sequence Applied
+    quint64 generation() const;
+    //Wait Up To 'timeout' ms Until Every Change Up To 'minGeneration' Is Applied
+    bool waitForGeneration(quint64 minGeneration,int timeout) const;
+
+    //Start Over At 'generation' With Last Change Of Each Table From 'tableVersions',
+    //Entities Are Treated As Changed At 'generation' (Listener Started, Changes In Between Unknown)
+    void reset(quint64 generation,const QHash<QString,quint64>& tableVersions);
+    //Every Change Up To 'generation' Is Applied
+    void advance(quint64 generation);
+    //Table-Wide Write (Bulk Operations), Invalidates Every Entity Of Table
+    void bumpTable(const QString& tableName,quint64 version);
+    //Single Entity Write
+    void bumpEntity(const QString& tableName,const QString& entityId,quint64 version);
+
+    //Identity Of The Database The Versions Come From, Set By SQL_Listener
+    void setDatabaseId(const QString& databaseId);
+    QByteArray makeETag(const QStringList& parts) const;
+    static bool isETagMatch(const QByteArray& ifNoneMatch,const QByteArray& eTag);
+};
+
+#endif // VERSIONSTORE_H
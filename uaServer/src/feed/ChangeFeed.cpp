@@ -0,0 +1,150 @@
+#include "ChangeFeed.h"
+
+#include <QJsonDocument>
+#include <QMutexLocker>
+
+QJsonObject ChangeFeed::makeEventObject(const QString &tableName, const QString &operation,
+                                        const QJsonObject &rowObject, const QJsonObject &oldObject)
+{
+    //truncate has no rows, subscribers resync the table
+    if(operation=="truncate"){
+        return QJsonObject {{"type","reset"},{"table",tableName}};
+    }
+    //links are logged as 'delete' and 'insert' only
+    if(tableName=="users_roles_permissions"){
+        return QJsonObject {
+            {"type",operation=="delete" ? "assignment_removed" : "assignment_added"},
+            {"user_id",rowObject.value("user_id")},
+            {"role_permission_id",rowObject.value("role_permission_id")}
+        };
+    }
+    if(tableName=="roles_permissions_relationship"){
+        return QJsonObject {
+            {"type",operation=="delete" ? "edge_removed" : "edge_added"},
+            {"parent_id",rowObject.value("parent_id")},
+            {"child_id",rowObject.value("child_id")}
+        };
+    }
+    if(tableName=="roles_permissions"){
+        if(operation=="insert" || operation=="delete"){
+            return QJsonObject {
+                {"type",operation=="insert" ? "role_permission_created" : "role_permission_deleted"},
+                {"id",rowObject.value("id")},
+                {"name",rowObject.value("name")}
+            };
+        }
+        if(rowObject.value("name")!=oldObject.value("name")){
+            return QJsonObject {
+                {"type","role_permission_renamed"},
+                {"id",rowObject.value("id")},
+                {"old_name",oldObject.value("name")},
+                {"name",rowObject.value("name")}
+            };
+        }
+        return QJsonObject {};
+    }
+    if(tableName=="users"){
+        if(operation=="delete"){
+            return QJsonObject {{"type","user_deleted"},{"user_id",rowObject.value("id")}};
+        }
+        if(operation=="update" && rowObject.value("is_blocked")!=oldObject.value("is_blocked")){
+            return QJsonObject {
+                {"type",rowObject.value("is_blocked").toBool() ? "user_blocked" : "user_unblocked"},
+                {"user_id",rowObject.value("id")}
+            };
+        }
+    }
+    return QJsonObject {};
+}
+
+ChangeFeed::Event ChangeFeed::makeEvent(qint64 sequence, QJsonObject eventObject)
+{
+    Event event {};
+    event.sequence=sequence;
+    eventObject.insert("seq",sequence);
+    event.data=QJsonDocument(eventObject).toJson(QJsonDocument::Compact);
+    return event;
+}
+
+ChangeFeed::ChangeFeed(int bufferSize, QObject *parent)
+    :QObject{parent},bufferSize_{qMax(bufferSize,1)}
+{
+}
+
+void ChangeFeed::publish(qint64 sequence, QJsonObject eventObject)
+{
+    const Event event {makeEvent(sequence,eventObject)};
+    {
+        QMutexLocker locker {&mutex_};
+        if(sequence <= sequence_){
+            return;
+        }
+        sequence_=sequence;
+        events_.enqueue(event);
+        while(events_.size() > bufferSize_){
+            coveredSequence_=events_.dequeue().sequence;
+        }
+    }
+    published_.fetchAndAddRelaxed(1);
+    Q_EMIT eventSignal(event.sequence,event.data);
+}
+
+void ChangeFeed::restart(qint64 sequence)
+{
+    QMutexLocker locker {&mutex_};
+    events_.clear();
+    sequence_=qMax(sequence_,sequence);
+    coveredSequence_=sequence_;
+}
+
+qint64 ChangeFeed::lastSequence() const
+{
+    QMutexLocker locker {&mutex_};
+    return sequence_;
+}
+
+bool ChangeFeed::eventsSince(qint64 sequence, QVector<Event> &outEvents, qint64 &outLastSequence) const
+{
+    QMutexLocker locker {&mutex_};
+    outLastSequence=sequence_;
+    //a newer sequence is known to another instance or a client of a rebuilt database, only the log tells
+    if(sequence < coveredSequence_ || sequence > sequence_){
+        return false;
+    }
+    for(const Event& event: events_){
+        if(event.sequence > sequence){
+            outEvents.push_back(event);
+        }
+    }
+    return true;
+}
+
+void ChangeFeed::countReset()
+{
+    resets_.fetchAndAddRelaxed(1);
+}
+
+void ChangeFeed::sessionStarted()
+{
+    sessions_.fetchAndAddRelaxed(1);
+}
+
+void ChangeFeed::sessionFinished()
+{
+    sessions_.fetchAndSubRelaxed(1);
+}
+
+QByteArray ChangeFeed::metrics() const
+{
+    QByteArray outData {};
+    outData+="# HELP uauth_changes_events_total Change events published to the change feed.\n"
+             "# TYPE uauth_changes_events_total counter\n"
+             "uauth_changes_events_total " + QByteArray::number(published_.loadAcquire()) + "\n";
+    outData+="# HELP uauth_changes_resets_total Change feed resumes refused, the log no longer had the events.\n"
+             "# TYPE uauth_changes_resets_total counter\n"
+             "uauth_changes_resets_total " + QByteArray::number(resets_.loadAcquire()) + "\n";
+    outData+="# HELP uauth_changes_sessions Open change feed sessions.\n"
+             "# TYPE uauth_changes_sessions gauge\n"
+             "uauth_changes_sessions " + QByteArray::number(sessions_.loadAcquire()) + "\n";
+    return outData;
+}
@@ -0,0 +1,70 @@
+#ifndef CHANGEFEED_H
+#define CHANGEFEED_H
+
+#include <QQueue>
+#include <QMutex>
+#include <QVector>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QAtomicInteger>
+
+//Numbered stream of row changes of users, roles/permissions, hierarchy edges and
+//assignments, made by SQL_Listener from 'change_log' rows (see uaTables) in their
+//order. An event is numbered with the 'seq' of its row, so numbers are the same on
+//every uaServer instance and across restarts and have gaps where a row is not
+//reported. The last events are buffered; a session resuming from before the buffer
+//reads the rest from 'change_log' (see ChangeFeedSession).
+//Events are published in the main thread, sessions read from their own threads.
+class ChangeFeed : public QObject
+{
+    Q_OBJECT
+public:
+    struct Event{
+        qint64 sequence {0};
+        QByteArray data {};
+    };
+
+private:
+    mutable QMutex mutex_;
+    //every event after it is buffered
+    qint64 coveredSequence_ {0};
+    qint64 sequence_ {0};
+    int bufferSize_ {10000};
+    QQueue<Event> events_ {};
+    QAtomicInteger<quint64> published_ {0};
+    QAtomicInteger<quint64> resets_ {0};
+    QAtomicInteger<int> sessions_ {0};
+
+public:
+    explicit ChangeFeed(int bufferSize,QObject* parent=nullptr);
+    ~ChangeFeed()=default;
+
+    //Event Of 'change_log' Row, Empty When The Change Is Not Reported
+    static QJsonObject makeEventObject(const QString& tableName,const QString& operation,
+                                       const QJsonObject& rowObject,const QJsonObject& oldObject);
+    static Event makeEvent(qint64 sequence,QJsonObject eventObject);
+
+    //Buffer Event Numbered 'sequence', Above Any Before, Then Emit It To Sessions
+    void publish(qint64 sequence,QJsonObject eventObject);
+    //Changes Up To 'sequence' Were Not Published Here (Listener Started Or Lost Its Tail)
+    void restart(qint64 sequence);
+    //Sequence Of Last Published Event
+    qint64 lastSequence() const;
+    //Buffered Events After 'sequence'; False If Some Are Not Buffered Or 'sequence'
+    //Is Ahead Of This Process, Then They Are Read From 'change_log'
+    bool eventsSince(qint64 sequence,QVector<Event>& outEvents,qint64& outLastSequence) const;
+    //Resume Refused, Client Has To Resync
+    void countReset();
+
+    void sessionStarted();
+    void sessionFinished();
+    //Counters In Prometheus Text Format
+    QByteArray metrics() const;
+
+Q_SIGNALS:
+    void eventSignal(qint64 sequence,const QByteArray& eventData);
+};
+
+#endif // CHANGEFEED_H
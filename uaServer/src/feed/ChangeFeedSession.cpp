@@ -0,0 +1,142 @@
+#include "ChangeFeedSession.h"
+#include "../postgres/SQL_Handler.h"
+
+#include <QVector>
+#include <QWebSocket>
+#include <QTcpSocket>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+void ChangeFeedSession::sendEvent(qint64 sequence, const QByteArray &eventData)
+{
+    if(!webSocketPtr_ || sequence <= lastSequence_){
+        return;
+    }
+    //frames go straight to the tcp socket, so its buffer is what the consumer has not taken yet
+    if(socketPtr_ && socketPtr_->bytesToWrite() > maxPending_){
+        webSocketPtr_->close(QWebSocketProtocol::CloseCodePolicyViolated,QStringLiteral("Consumer too slow, resume after seq %1").arg(lastSequence_));
+        webSocketPtr_.clear();
+        return;
+    }
+    webSocketPtr_->sendTextMessage(QString::fromUtf8(eventData));
+    lastSequence_=sequence;
+}
+
+void ChangeFeedSession::sendControl(const QString &type, qint64 sequence)
+{
+    const QJsonObject controlObject {
+        {"type",type},
+        {"seq",sequence}
+    };
+    webSocketPtr_->sendTextMessage(QString::fromUtf8(QJsonDocument(controlObject).toJson(QJsonDocument::Compact)));
+    lastSequence_=sequence;
+}
+
+bool ChangeFeedSession::replayLog(qint64 untilSequence)
+{
+    QString lastError {};
+    QJsonArray rowObjects {};
+    bool isReset {false};
+    const SQL_Status sqlStatus {sqlHandlerPtr_->getChangeLogRows(sinceSequence_,untilSequence,maxReplay_,rowObjects,isReset,lastError)};
+    if(sqlStatus!=SQL_Status::Success){
+        const QString logMsg {QStringLiteral("Change feed not resumed from change log, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+        return false;
+    }
+    if(isReset){
+        return false;
+    }
+    lastSequence_=sinceSequence_;
+    for(const QJsonValue& rowValue: rowObjects){
+        const QJsonObject rowObject {rowValue.toObject()};
+        const QJsonObject eventObject {ChangeFeed::makeEventObject(rowObject.value("table_name").toString(),rowObject.value("operation").toString(),
+                                                                   rowObject.value("row_data").toObject(),rowObject.value("old_data").toObject())};
+        if(!eventObject.isEmpty()){
+            const ChangeFeed::Event event {ChangeFeed::makeEvent(static_cast<qint64>(rowObject.value("seq").toDouble()),eventObject)};
+            sendEvent(event.sequence,event.data);
+        }
+    }
+    //rows without an event up to the feed are covered too, a newer 'since' stays where it is
+    lastSequence_=qMax(lastSequence_,untilSequence);
+    return true;
+}
+
+void ChangeFeedSession::newConnectionSlot()
+{
+    QWebSocket* webSocket {webSocketServer_.nextPendingConnection()};
+    if(!webSocket){
+        return;
+    }
+    webSocket->setParent(this);
+    webSocketPtr_=webSocket;
+
+    //subscribed before the buffer is read, so nothing falls between; repeats are dropped by sequence
+    QObject::connect(changeFeedPtr_.data(),&ChangeFeed::eventSignal,this,&ChangeFeedSession::eventSlot);
+    if(sinceSequence_ < 0){
+        sendControl("subscribed",changeFeedPtr_->lastSequence());
+        return;
+    }
+    QVector<ChangeFeed::Event> events {};
+    qint64 lastSequence {0};
+    if(changeFeedPtr_->eventsSince(sinceSequence_,events,lastSequence)){
+        lastSequence_=sinceSequence_;
+        for(const ChangeFeed::Event& event: events){
+            sendEvent(event.sequence,event.data);
+        }
+        return;
+    }
+    //not buffered here, the log has every row the feed published and what another instance did
+    if(!replayLog(lastSequence)){
+        changeFeedPtr_->countReset();
+        if(webSocketPtr_){
+            sendControl("reset",lastSequence);
+        }
+    }
+}
+
+void ChangeFeedSession::eventSlot(qint64 sequence, const QByteArray &eventData)
+{
+    sendEvent(sequence,eventData);
+}
+
+ChangeFeedSession::ChangeFeedSession(QSharedPointer<ChangeFeed> changeFeedPtr, QSharedPointer<SQL_Handler> sqlHandlerPtr,
+                                     qint64 sinceSequence, QObject *parent)
+    :QObject{parent},changeFeedPtr_{changeFeedPtr},sqlHandlerPtr_{sqlHandlerPtr},webSocketServer_{QString {},QWebSocketServer::NonSecureMode},
+     sinceSequence_{sinceSequence}
+{
+    QObject::connect(&webSocketServer_,&QWebSocketServer::newConnection,this,&ChangeFeedSession::newConnectionSlot);
+}
+
+ChangeFeedSession::~ChangeFeedSession()
+{
+    if(isStarted_){
+        changeFeedPtr_->sessionFinished();
+    }
+}
+
+void ChangeFeedSession::start(QTcpSocket *socket)
+{
+    //reparented to the web socket once the handshake succeeds, freed with the session otherwise
+    socket->setParent(this);
+    socketPtr_=socket;
+    QObject::connect(socket,&QTcpSocket::disconnected,this,&ChangeFeedSession::finishedSignal);
+    isStarted_=true;
+    changeFeedPtr_->sessionStarted();
+    webSocketServer_.handleConnection(socket);
+    //the upgrade request is already buffered, so nothing else would trigger the handshake
+    Q_EMIT socket->readyRead();
+}
+
+void ChangeFeedSession::close()
+{
+    if(webSocketPtr_){
+        webSocketPtr_->close(QWebSocketProtocol::CloseCodeGoingAway,QStringLiteral("Server going away, resume after seq %1").arg(lastSequence_));
+        webSocketPtr_.clear();
+        return;
+    }
+    //handshake not completed yet
+    if(socketPtr_){
+        socketPtr_->disconnectFromHost();
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef CHANGEFEEDSESSION_H
+#define CHANGEFEEDSESSION_H
+
+#include <QObject>
+#include <QPointer>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QWebSocketServer>
+
+#include "ChangeFeed.h"
+
+class QTcpSocket;
+class QWebSocket;
+class SQL_Handler;
+
+//One WebSocket subscriber of ChangeFeed, lives in the thread of the connection
+//it was upgraded from. Every message is one JSON event with its 'seq', the 'seq' of
+//its 'change_log' row; a session started with a sequence gets the events after it
+//first, from the buffer or from the log, so a sequence of any instance resumes on
+//any other and after a restart. Control messages:
+//  {"type":"subscribed","seq":N}  no sequence was given, events after N follow
+//  {"type":"reset","seq":N}       given sequence can not be resumed (trimmed, too old or of another
+//                                 database), resync then resume after N
+//A 'reset' event in the stream itself (a truncate, a bulk change too long to replay,
+//or the listener reconnected and may have missed rows) asks for the same resync.
+//A consumer that lets more than 'maxPending' bytes pile up is closed and resumes later.
+class ChangeFeedSession : public QObject
+{
+    Q_OBJECT
+private:
+    QSharedPointer<ChangeFeed> changeFeedPtr_ {nullptr};
+    QSharedPointer<SQL_Handler> sqlHandlerPtr_ {nullptr};
+    //a longer way back is a resync
+    const int maxReplay_ {10000};
+    QWebSocketServer webSocketServer_;
+    QPointer<QTcpSocket> socketPtr_ {nullptr};
+    QPointer<QWebSocket> webSocketPtr_ {nullptr};
+    qint64 sinceSequence_ {-1};
+    qint64 lastSequence_ {0};
+    qint64 maxPending_ {16 * 1024 * 1024};
+    bool isStarted_ {false};
+
+    void sendEvent(qint64 sequence,const QByteArray& eventData);
+    void sendControl(const QString& type,qint64 sequence);
+    //Events After 'sinceSequence_' Up To 'untilSequence' From 'change_log', False When It Can Not
+    bool replayLog(qint64 untilSequence);
+
+private Q_SLOTS:
+    void newConnectionSlot();
+    void eventSlot(qint64 sequence,const QByteArray& eventData);
+
+public:
+    //'sinceSequence' Below 0 Means Live Events Only
+    ChangeFeedSession(QSharedPointer<ChangeFeed> changeFeedPtr,QSharedPointer<SQL_Handler> sqlHandlerPtr,
+                      qint64 sinceSequence,QObject* parent=nullptr);
+    ~ChangeFeedSession();
+
+    //Complete WebSocket Handshake On 'socket', Its Upgrade Request Must Still Be Unread;
+    //Session Takes Ownership Of 'socket'
+    void start(QTcpSocket* socket);
+
+public Q_SLOTS:
+    //Close With 'going away' And Last Sequence Sent In The Reason, The Subscriber Resumes
+    //After It On Any Instance
+    void close();
+
+Q_SIGNALS:
+    void finishedSignal();
+};
+
+#endif // CHANGEFEEDSESSION_H
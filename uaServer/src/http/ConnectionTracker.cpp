@@ -0,0 +1,71 @@
+#include "ConnectionTracker.h"
+
+void ConnectionTracker::checkDrained()
+{
+    if(isDraining_.loadAcquire()==0 || connections_.loadAcquire()!=0){
+        return;
+    }
+    if(isDrained_.testAndSetOrdered(0,1)){
+        Q_EMIT drainedSignal();
+    }
+}
+
+ConnectionTracker::ConnectionTracker(QObject *parent)
+    :QObject{parent}
+{
+}
+
+void ConnectionTracker::connectionStarted()
+{
+    connections_.fetchAndAddOrdered(1);
+}
+
+void ConnectionTracker::connectionFinished()
+{
+    connections_.fetchAndAddOrdered(-1);
+    checkDrained();
+}
+
+int ConnectionTracker::connections() const
+{
+    return connections_.loadAcquire();
+}
+
+bool ConnectionTracker::isDraining() const
+{
+    return isDraining_.loadAcquire()!=0;
+}
+
+void ConnectionTracker::drain()
+{
+    if(!isDraining_.testAndSetOrdered(0,1)){
+        return;
+    }
+    Q_EMIT drainSignal();
+    checkDrained();
+}
+
+void ConnectionTracker::setReady(bool isReady)
+{
+    isReady_.storeRelease(isReady ? 1 : 0);
+}
+
+bool ConnectionTracker::isReady() const
+{
+    return isReady_.loadAcquire()!=0 && !isDraining();
+}
+
+QByteArray ConnectionTracker::metrics() const
+{
+    QByteArray outData {};
+    outData+="# HELP uauth_connections Open http, web socket and binary authz connections.\n"
+             "# TYPE uauth_connections gauge\n"
+             "uauth_connections " + QByteArray::number(connections()) + "\n";
+    outData+="# HELP uauth_draining 1 while connections are drained before exit.\n"
+             "# TYPE uauth_draining gauge\n"
+             "uauth_draining " + QByteArray::number(isDraining() ? 1 : 0) + "\n";
+    outData+="# HELP uauth_ready 1 while '/health/ready' reports ready, integrity aside.\n"
+             "# TYPE uauth_ready gauge\n"
+             "uauth_ready " + QByteArray::number(isReady() ? 1 : 0) + "\n";
+    return outData;
+}
@@ -0,0 +1,45 @@
+#ifndef CONNECTIONTRACKER_H
+#define CONNECTIONTRACKER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+
+//Counts connection threads (http, web socket, binary authz) and tells them to
+//drain: once it is draining, an idle connection is closed at once, a busy one
+//right after its response, so no request is cut. 'drainedSignal' comes when
+//the last connection thread is gone, from that thread. Also holds the readiness
+//reported by '/health/ready', which a shutdown turns off before draining.
+class ConnectionTracker : public QObject
+{
+    Q_OBJECT
+private:
+    QAtomicInt connections_ {0};
+    QAtomicInt isDraining_ {0};
+    QAtomicInt isDrained_ {0};
+    QAtomicInt isReady_ {1};
+
+    void checkDrained();
+
+public:
+    explicit ConnectionTracker(QObject* parent=nullptr);
+    ~ConnectionTracker()=default;
+
+    //Counted Before Thread Starts, So A Drain Can Not Miss It
+    void connectionStarted();
+    void connectionFinished();
+    int connections() const;
+    bool isDraining() const;
+    void drain();
+    //Readiness Reported To Probes, Accepting Goes On Regardless
+    void setReady(bool isReady);
+    bool isReady() const;
+    //Prometheus Text Of Open Connections And Drain State
+    QByteArray metrics() const;
+
+Q_SIGNALS:
+    void drainSignal();
+    void drainedSignal();
+};
+
+#endif // CONNECTIONTRACKER_H
@@ -0,0 +1,96 @@
+#include "HttpAcceptor.h"
+#include "HttpServer.h"
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+void HttpAcceptor::incomingConnection(qintptr socketDescriptor)
+{
+    accepted_.fetchAndAddRelaxed(1);
+    httpServerPtr_->handleConnection(socketDescriptor);
+}
+
+HttpAcceptor::HttpAcceptor(HttpServer *httpServerPtr, QObject *parent)
+    :QTcpServer{parent},httpServerPtr_{httpServerPtr}
+{
+    QObject::connect(this,&QTcpServer::acceptError,[this](QAbstractSocket::SocketError){
+        //QTcpServer pauses accepting on a non temporary error, the group resumes it
+        Q_EMIT failedSignal(QTcpServer::errorString());
+    });
+}
+
+qintptr HttpAcceptor::makeReusePortSocket(const QHostAddress &address, quint16 port, QString &lastError)
+{
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+    //'Any' of Qt is dual stack, so it is bound as IPv6 without IPV6_V6ONLY
+    const bool isIpv4 {address.protocol()==QAbstractSocket::IPv4Protocol};
+    const int listenDescriptor {::socket(isIpv4 ? AF_INET : AF_INET6,SOCK_STREAM | SOCK_CLOEXEC,0)};
+    if(listenDescriptor < 0){
+        lastError=QStringLiteral("Listener socket not created, error: %1").arg(std::strerror(errno));
+        return -1;
+    }
+    const int enable {1};
+    const int disable {0};
+    ::setsockopt(listenDescriptor,SOL_SOCKET,SO_REUSEADDR,&enable,sizeof(enable));
+    if(::setsockopt(listenDescriptor,SOL_SOCKET,SO_REUSEPORT,&enable,sizeof(enable)) < 0){
+        lastError=QStringLiteral("SO_REUSEPORT not set, error: %1").arg(std::strerror(errno));
+        ::close(listenDescriptor);
+        return -1;
+    }
+    sockaddr_storage storage {};
+    socklen_t storageSize {0};
+    if(isIpv4){
+        sockaddr_in* addressPtr {reinterpret_cast<sockaddr_in*>(&storage)};
+        addressPtr->sin_family=AF_INET;
+        addressPtr->sin_port=htons(port);
+        addressPtr->sin_addr.s_addr=htonl(address.toIPv4Address());
+        storageSize=sizeof(sockaddr_in);
+    }
+    else{
+        sockaddr_in6* addressPtr {reinterpret_cast<sockaddr_in6*>(&storage)};
+        addressPtr->sin6_family=AF_INET6;
+        addressPtr->sin6_port=htons(port);
+        if(address.protocol()==QAbstractSocket::IPv6Protocol){
+            const Q_IPV6ADDR ipv6Address {address.toIPv6Address()};
+            std::memcpy(&addressPtr->sin6_addr,&ipv6Address,sizeof(ipv6Address));
+        }
+        else{
+            addressPtr->sin6_addr=in6addr_any;
+            ::setsockopt(listenDescriptor,IPPROTO_IPV6,IPV6_V6ONLY,&disable,sizeof(disable));
+        }
+        storageSize=sizeof(sockaddr_in6);
+    }
+    if(::bind(listenDescriptor,reinterpret_cast<sockaddr*>(&storage),storageSize) < 0 || ::listen(listenDescriptor,SOMAXCONN) < 0){
+        lastError=QStringLiteral("Listener not bound to %1:%2, error: %3").arg(address.toString()).arg(port).arg(std::strerror(errno));
+        ::close(listenDescriptor);
+        return -1;
+    }
+    return listenDescriptor;
+#else
+    Q_UNUSED(address)
+    Q_UNUSED(port)
+    lastError="SO_REUSEPORT is not supported on this platform";
+    return -1;
+#endif
+}
+
+quint64 HttpAcceptor::accepted() const
+{
+    return accepted_.loadAcquire();
+}
+
+quint64 HttpAcceptor::restarts() const
+{
+    return restarts_.loadAcquire();
+}
+
+void HttpAcceptor::resumeSlot()
+{
+    restarts_.fetchAndAddRelaxed(1);
+    QTcpServer::resumeAccepting();
+}
@@ -0,0 +1,41 @@
+#ifndef HTTPACCEPTOR_H
+#define HTTPACCEPTOR_H
+
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QAtomicInteger>
+
+class HttpServer;
+
+//One of UA_HTTP_LISTENERS accept loops of HttpListenerGroup. It runs in its own
+//thread on its own SO_REUSEPORT socket, so the kernel spreads new connections over
+//the loops; accepted descriptors are served by HttpServer like any other.
+class HttpAcceptor : public QTcpServer
+{
+    Q_OBJECT
+private:
+    HttpServer* httpServerPtr_ {nullptr};
+    QAtomicInteger<quint64> accepted_ {0};
+    QAtomicInteger<quint64> restarts_ {0};
+
+protected:
+    virtual void incomingConnection(qintptr socketDescriptor)override;
+
+public:
+    explicit HttpAcceptor(HttpServer* httpServerPtr,QObject* parent=nullptr);
+    ~HttpAcceptor()=default;
+
+    //Bound And Listening Socket With SO_REUSEPORT Set, -1 On Failure
+    static qintptr makeReusePortSocket(const QHostAddress& address,quint16 port,QString& lastError);
+    quint64 accepted() const;
+    quint64 restarts() const;
+
+public Q_SLOTS:
+    //Runs In The Acceptor Thread
+    void resumeSlot();
+
+Q_SIGNALS:
+    void failedSignal(const QString& lastError);
+};
+
+#endif // HTTPACCEPTOR_H
@@ -5,17 +5,37 @@
 #include "HttpResponse.h"
 #include "HttpResponder.h"
 #include "HttpRouterRule.h"
+#include "HttpListenerGroup.h"
+#include "ConnectionTracker.h"
+#include "../authz/PolicyCache.h"
+#include "../authz/DecisionCache.h"
+#include "../cache/SingleFlight.h"
+#include "../cache/VersionStore.h"
+#include "../feed/ChangeFeed.h"
+#include "../feed/ChangeFeedSession.h"
+#include "../postgres/PG_Handler.h"
 #include "../postgres/SQL_Handler.h"
 #include "../crypto/CryptoGenerator.h"
 #include "3rdparty/http-parser/http_parser.h"
 
 #include <QDebug>
+#include <QLocale>
+#include <QDateTime>
 #include <QSettings>
 #include <QUrlQuery>
+#include <QTimer>
 #include <QTcpSocket>
 #include <QByteArray>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QRegularExpression>
+
+#ifdef Q_OS_WINDOWS
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
 
 void HttpClient::addUserRules(const HttpRequest &request, QAbstractSocket *socket)
 {
@@ -81,14 +101,45 @@ void HttpClient::addUserRules(const HttpRequest &request, QAbstractSocket *socke
 
                 const QString requesterId {getRequesterId(request)};
                 const QString userId {match.captured(1)};
-                {
+                const quint64 userVersion {versionStorePtr_->entityVersion("users",userId)};
+                const QByteArray eTag {getETag(request,requesterId,{QString::number(userVersion)})};
+                if(sendNotModified(eTag,request,socket)){
+                    return true;
+                }
+                {//authorize once, the read itself is then shared by every requester allowed to do it
                     QString lastError {};
-                    QJsonObject outUserObject {};
-                    const SQL_Status sqlStatus {sqlHandlerPtr_->getUserObject(userId,requesterId,outUserObject,lastError)};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,"user:read",lastError)};
+                    if(sqlStatus==SQL_Status::Unauthorized){
+                        sendResponse(HttpResponse(HttpResponse::StatusCode::Unauthorized),request,socket);
+                        return true;
+                    }
+                    if(sqlStatus!=SQL_Status::Success){
+                        HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                }
+                {
+                    //the check inside getUserObject is answered by the decision cached just above
+                    const QString flightKey {QStringLiteral("GET users/%1|%2").arg(userId.toLower(),QString::number(userVersion))};
+                    const SingleFlight::Result result {singleFlightPtr_->run(flightKey,[&]()->SingleFlight::Result{
+                            SingleFlight::Result flightResult {};
+                            flightResult.sqlStatus=sqlHandlerPtr_->getUserObject(userId,requesterId,flightResult.object,flightResult.lastError);
+                            return flightResult;
+                        })
+                    };
+                    const QString lastError {result.lastError};
+                    const QJsonObject outUserObject {result.object};
+                    const SQL_Status sqlStatus {result.sqlStatus};
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outUserObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::eTagHeader(),eTag);
+                                const QByteArray lastModified {toHttpDate(outUserObject.value("updated_at").toString())};
+                                if(!lastModified.isEmpty()){
+                                    response.setHeader(HttpLiterals::lastModifiedHeader(),lastModified);
+                                }
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -138,6 +189,7 @@ void HttpClient::addUserRules(const HttpRequest &request, QAbstractSocket *socke
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                syncWrite({{"users",userId}});
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outUserObject).toJson(),HttpResponse::StatusCode::Ok);
                                 sendResponse(response,request,socket);
                             }
@@ -187,6 +239,7 @@ void HttpClient::addUserRules(const HttpRequest &request, QAbstractSocket *socke
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                syncWrite({{"users",outUserObject.value("id").toString()}});
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outUserObject).toJson(),HttpResponse::StatusCode::Created);
                                 sendResponse(response,request,socket);
                             }
@@ -239,6 +292,7 @@ void HttpClient::addUserRules(const HttpRequest &request, QAbstractSocket *socke
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                syncWrite({{"users",userId},{"users_roles_permissions",userId}});
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QByteArray{},HttpResponse::StatusCode::NoContent);
                                 sendResponse(response,request,socket);
                             }
@@ -269,6 +323,68 @@ void HttpClient::addUserRules(const HttpRequest &request, QAbstractSocket *socke
         });
         router_.addRule<ViewHandler>(rule);
     }
+    {// '/api/v1/u-auth/users:bulk' rule for POST
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/users:bulk",HttpRequest::Method::POST,
+                                               [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+
+                const QString requesterId {getRequesterId(request)};
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                const bool isCsvContent {request.value("Content-Type").startsWith(HttpLiterals::contentTypeCsv())};
+                const QString format {queryMap.value("format",isCsvContent ? "csv" : "ndjson")};
+                {//authorize
+                    QString lastError{};
+                    const QString rolePermIdent {"user:create user:update"};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,rolePermIdent,lastError)};
+                    if(sqlStatus!=SQL_Status::Success){
+                        HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                }
+                {
+                    QString lastError {};
+                    QJsonObject outReportObject {};
+                    const SQL_Status sqlStatus {pgHandlerPtr_->importUsers(format,request.body(),outReportObject,lastError)};
+                    switch(sqlStatus){
+                        case SQL_Status::Success:
+                            {
+                                syncWrite({{"users",QString {}}});
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outReportObject).toJson(),HttpResponse::StatusCode::Ok);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::BadRequest:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Unauthorized:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Conflict:
+                        case SQL_Status::NotFound:
+                        case SQL_Status::UnprocessableEntity:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::NotFound);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                    }
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
 }
 
 void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *socket)
@@ -286,6 +402,10 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
 
                 const QString requesterId {getRequesterId(request)};
                 const QMap<QString,QString> queryMap {getQueryMap(request)};
+                const QByteArray eTag {getETag(request,requesterId,{QString::number(versionStorePtr_->tableVersion("roles_permissions"))})};
+                if(sendNotModified(eTag,request,socket)){
+                    return true;
+                }
                 {
                     QString lastError {};
                     QJsonObject outRolePermsObject {};
@@ -294,6 +414,7 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
                         case SQL_Status::Success:
                             {
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermsObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::eTagHeader(),eTag);
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -394,7 +515,9 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions",rolePermId}})};
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -443,7 +566,9 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions",outRolePermObject.value("id").toString()}})};
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Created);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -496,7 +621,9 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions",outRolePermObject.value("id").toString()}})};
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Created);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -548,7 +675,9 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions",rolePermId},{"users_roles_permissions",QString {}}})};
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QByteArray{},HttpResponse::StatusCode::NoContent);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -583,6 +712,66 @@ void HttpClient::addRolePermRules(const HttpRequest &request, QAbstractSocket *s
         });
         router_.addRule<ViewHandler>(rule);
     }
+    {// '/api/v1/u-auth/roles-permissions:bulk' rule for POST
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/roles-permissions:bulk",HttpRequest::Method::POST,
+                                               [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+
+                const QString requesterId {getRequesterId(request)};
+                {//authorize
+                    QString lastError{};
+                    const QString rolePermIdent {"role_permission:create role_permission:update"};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,rolePermIdent,lastError)};
+                    if(sqlStatus!=SQL_Status::Success){
+                        HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                }
+                {
+                    QString lastError {};
+                    QJsonObject outReportObject {};
+                    const SQL_Status sqlStatus {pgHandlerPtr_->importHierarchy(request.body(),outReportObject,lastError)};
+                    switch(sqlStatus){
+                        case SQL_Status::Success:
+                            {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions",QString {}},{"roles_permissions_relationship",QString {}}})};
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outReportObject).toJson(),HttpResponse::StatusCode::Created);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::BadRequest:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Unauthorized:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Conflict:
+                        case SQL_Status::NotFound:
+                        case SQL_Status::UnprocessableEntity:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::NotFound);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                    }
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
 }
 
 void HttpClient::addParentChildRules(const HttpRequest &request, QAbstractSocket *socket)
@@ -606,7 +795,9 @@ void HttpClient::addParentChildRules(const HttpRequest &request, QAbstractSocket
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions_relationship",QString {}}})};
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -623,8 +814,18 @@ void HttpClient::addParentChildRules(const HttpRequest &request, QAbstractSocket
                             }
                             break;
                         case SQL_Status::Conflict:
-                        case SQL_Status::NotFound:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::Conflict);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
                         case SQL_Status::UnprocessableEntity:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::UnprocessableEntity);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::NotFound:
                             {
                                 HttpResponse response(HttpResponse::StatusCode::NotFound);
                                 sendResponse(response,request,socket);
@@ -656,7 +857,9 @@ void HttpClient::addParentChildRules(const HttpRequest &request, QAbstractSocket
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"roles_permissions_relationship",QString {}}})};
                                 HttpResponse response(HttpResponse::StatusCode::NoContent);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -686,6 +889,45 @@ void HttpClient::addParentChildRules(const HttpRequest &request, QAbstractSocket
         });
         router_.addRule<ViewHandler>(rule);
     }
+    {// '/api/v1/u-auth/hierarchy/stats' rule for GET
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/hierarchy/stats",HttpRequest::Method::GET,
+                                               [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+                const QString requesterId {getRequesterId(request)};
+                {
+                    QString lastError {};
+                    QJsonObject outStatsObject {};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getHierarchyStatsObject(requesterId,outStatsObject,lastError)};
+                    switch(sqlStatus){
+                        case SQL_Status::Success:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outStatsObject).toJson(),HttpResponse::StatusCode::Ok);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Unauthorized:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        default:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                    }
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
 }
 
 void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocket *socket)
@@ -703,6 +945,10 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
                 const QString requesterId {getRequesterId(request)};
                 const QString userId {match.captured(1)};
                 const QMap<QString,QString> queryMap {getQueryMap(request)};
+                const QByteArray eTag {getETag(request,requesterId,{QString::number(versionStorePtr_->entityVersion("users_roles_permissions",userId)),QString::number(versionStorePtr_->tableVersion("roles_permissions"))})};
+                if(sendNotModified(eTag,request,socket)){
+                    return true;
+                }
                 {
                     QString lastError {};
                     QJsonObject outRolePermsObject {};
@@ -711,6 +957,7 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
                         case SQL_Status::Success:
                             {
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermsObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::eTagHeader(),eTag);
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -740,10 +987,10 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
         });
         router_.addRule<ViewHandler>(rule);
     }
-    {// '/api/v1/u-auth/roles-permissions/<arg>/associated-users' rule for GET
-        auto handler {[&](const QString& rolePermId){}};
+    {// '/api/v1/u-auth/users/<arg>/effective-permissions' rule for GET
+        auto handler {[&](const QString& userId){}};
         using ViewHandler=decltype (handler);
-        auto rule=new HttpRouterRule("/api/v1/u-auth/roles-permissions/<arg>/associated-users",HttpRequest::Method::GET,
+        auto rule=new HttpRouterRule("/api/v1/u-auth/users/<arg>/effective-permissions",HttpRequest::Method::GET,
                                                [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
                 if(!isIntegrityOk_){
                     sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
@@ -751,16 +998,54 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
                 }
 
                 const QString requesterId {getRequesterId(request)};
-                const QString rolePermId {match.captured(1)};
+                const QString userId {match.captured(1)};
                 const QMap<QString,QString> queryMap {getQueryMap(request)};
+                const QStringList includes {queryMap.value("include").split(",",QString::SkipEmptyParts)};
+                bool isMaxDepthOk {true};
+                const int maxDepth {queryMap.contains("max_depth") ? queryMap.value("max_depth").toInt(&isMaxDepthOk) : -1};
+                if(!isMaxDepthOk || maxDepth < -1){
+                    HttpResponse response(HttpLiterals::contentTypeText(),
+                                          QStringLiteral("Parameter 'max_depth' incorrect value: %1").arg(queryMap.value("max_depth")).toUtf8(),
+                                          HttpResponse::StatusCode::BadRequest);
+                    sendResponse(response,request,socket);
+                    return true;
+                }
+                const QByteArray eTag {getETag(request,requesterId,{QString::number(versionStorePtr_->entityVersion("users",userId)),
+                                                                    QString::number(versionStorePtr_->entityVersion("users_roles_permissions",userId))})};
+                if(sendNotModified(eTag,request,socket)){
+                    return true;
+                }
+                {//authorize
+                    QString lastError{};
+                    const QString rolePermIdent {"user:read role_permission:read"};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,rolePermIdent,lastError)};
+                    if(sqlStatus!=SQL_Status::Success){
+                        HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                }
                 {
                     QString lastError {};
-                    QJsonObject outUsersObject {};
-                    const SQL_Status sqlStatus {sqlHandlerPtr_->getRolePermUsersObject(rolePermId,queryMap,requesterId,outUsersObject,lastError)};
+                    QStringList assignedIds {};
+                    SQL_Status sqlStatus {sqlHandlerPtr_->getUserAssignedIds(userId,assignedIds,lastError)};
+                    QSharedPointer<const PolicySnapshot> snapshotPtr {nullptr};
+                    if(sqlStatus==SQL_Status::Success){
+                        snapshotPtr=policyCachePtr_->snapshot(*sqlHandlerPtr_,lastError);
+                        sqlStatus=snapshotPtr ? SQL_Status::Success : SQL_Status::BadRequest;
+                    }
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
-                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outUsersObject).toJson(),HttpResponse::StatusCode::Ok);
+                                const QJsonArray rolePermObjects {snapshotPtr->expand(assignedIds,maxDepth,includes.contains("depth"),includes.contains("path"))};
+                                const QJsonObject outRolePermsObject {
+                                    {"user_id",userId},
+                                    {"policy_version",static_cast<qint64>(snapshotPtr->version)},
+                                    {"total",rolePermObjects.size()},
+                                    {"items",rolePermObjects}
+                                };
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermsObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::eTagHeader(),eTag);
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -790,10 +1075,10 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
         });
         router_.addRule<ViewHandler>(rule);
     }
-    {// '/api/v1/u-auth/roles-permissions/<arg>/detail' rule for GET
+    {// '/api/v1/u-auth/roles-permissions/<arg>/associated-users' rule for GET
         auto handler {[&](const QString& rolePermId){}};
         using ViewHandler=decltype (handler);
-        auto rule=new HttpRouterRule("/api/v1/u-auth/roles-permissions/<arg>/detail",HttpRequest::Method::GET,
+        auto rule=new HttpRouterRule("/api/v1/u-auth/roles-permissions/<arg>/associated-users",HttpRequest::Method::GET,
                                                [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
                 if(!isIntegrityOk_){
                     sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
@@ -802,14 +1087,92 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
 
                 const QString requesterId {getRequesterId(request)};
                 const QString rolePermId {match.captured(1)};
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                if(queryMap.value("transitive")=="true"){
+                    //users holding role/permission directly or through any ancestor role,
+                    //resolved on the cached hierarchy and assignment index
+                    {//authorize
+                        QString lastError{};
+                        const QString rolePermIdent {"user:read"};
+                        const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,rolePermIdent,lastError)};
+                        if(sqlStatus!=SQL_Status::Success){
+                            HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                            sendResponse(response,request,socket);
+                            return true;
+                        }
+                    }
+                    bool isLimitOk {true};
+                    const int limit {queryMap.contains("limit") ? queryMap.value("limit").toInt(&isLimitOk) : 100};
+                    if(!isLimitOk || limit <= 0){
+                        HttpResponse response(HttpLiterals::contentTypeText(),
+                                              QStringLiteral("Parameter 'limit' incorrect value: %1").arg(queryMap.value("limit")).toUtf8(),
+                                              HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    //the cursor is the last user id of the previous page
+                    const QString cursor {queryMap.value("cursor").toLower()};
+                    const QRegularExpression re {"^([0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12})$"};
+                    if(queryMap.contains("cursor") && !re.match(cursor).hasMatch()){
+                        HttpResponse response(HttpLiterals::contentTypeText(),
+                                              QStringLiteral("Parameter 'cursor' incorrect value: %1").arg(queryMap.value("cursor")).toUtf8(),
+                                              HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    QString lastError {};
+                    const QSharedPointer<const PolicySnapshot> snapshotPtr {policyCachePtr_->snapshot(*sqlHandlerPtr_,lastError)};
+                    const QSharedPointer<const AssignmentIndex> assignmentIndexPtr {snapshotPtr ? policyCachePtr_->assignmentIndex(*sqlHandlerPtr_,lastError)
+                                                                                                : nullptr};
+                    if(!assignmentIndexPtr){
+                        HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    QStringList grantingIds {snapshotPtr->ancestors(rolePermId)};
+                    if(grantingIds.isEmpty()){
+                        HttpResponse response(HttpResponse::StatusCode::NotFound);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    //'UAuthAdmin' and every role above it grant everything, as in authorization checks
+                    for(const QString& adminId: snapshotPtr->idsByNames({"UAuthAdmin"})){
+                        grantingIds+=snapshotPtr->ancestors(adminId);
+                    }
+                    grantingIds.removeDuplicates();
+                    int total {0};
+                    //one extra id tells whether a next page exists
+                    QStringList pageUserIds {assignmentIndexPtr->usersOf(grantingIds,cursor,limit + 1,total)};
+                    const bool hasNextPage {pageUserIds.size() > limit};
+                    if(hasNextPage){
+                        pageUserIds.removeLast();
+                    }
+                    QJsonArray userObjects {};
+                    if(sqlHandlerPtr_->getUsersByIds(pageUserIds,userObjects,lastError)!=SQL_Status::Success){
+                        HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    const QJsonObject outUsersObject {
+                        {"limit",limit},
+                        {"count",userObjects.size()},
+                        {"total",total},
+                        {"next_cursor",hasNextPage ? QJsonValue(pageUserIds.last()) : QJsonValue(QJsonValue::Null)},
+                        {"granting_ids",QJsonArray::fromStringList(grantingIds)},
+                        {"items",userObjects}
+                    };
+                    HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outUsersObject).toJson(),HttpResponse::StatusCode::Ok);
+                    sendResponse(response,request,socket);
+                    return true;
+                }
                 {
                     QString lastError {};
-                    QJsonObject outRolePermObject {};
-                    const SQL_Status sqlStatus {sqlHandlerPtr_->getRolePermDetailObject(rolePermId,requesterId,outRolePermObject,lastError)};
+                    QJsonObject outUsersObject {};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getRolePermUsersObject(rolePermId,queryMap,requesterId,outUsersObject,lastError)};
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
-                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Ok);
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outUsersObject).toJson(),HttpResponse::StatusCode::Ok);
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -839,35 +1202,104 @@ void HttpClient::addUserRolePermRules(const HttpRequest &request, QAbstractSocke
         });
         router_.addRule<ViewHandler>(rule);
     }
-}
-
-void HttpClient::addAuthzRules(const HttpRequest &request, QAbstractSocket *socket)
-{
-    {// '/api/v1/u-auth/authz/<arg>/authorized-to/<arg>' rule for GET
-        auto handler {[&](const QString& userId,const QString& rolePermIdent){}};
+    {// '/api/v1/u-auth/roles-permissions/<arg>/detail' rule for GET
+        auto handler {[&](const QString& rolePermId){}};
         using ViewHandler=decltype (handler);
-        auto rule=new HttpRouterRule("/api/v1/u-auth/authz/<arg>/authorized-to/<arg>",HttpRequest::Method::GET,
-                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+        auto rule=new HttpRouterRule("/api/v1/u-auth/roles-permissions/<arg>/detail",HttpRequest::Method::GET,
+                                               [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
                 if(!isIntegrityOk_){
                     sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
                     return true;
                 }
 
-                const QString userId {match.captured(1)};
-                const QString rolePermIdent {match.captured(2)};
+                const QString requesterId {getRequesterId(request)};
+                const QString rolePermId {match.captured(1)};
+                const QByteArray eTag {getETag(request,requesterId,{QString::number(versionStorePtr_->tableVersion("roles_permissions")),QString::number(versionStorePtr_->tableVersion("roles_permissions_relationship"))})};
+                if(sendNotModified(eTag,request,socket)){
+                    return true;
+                }
                 {
                     QString lastError {};
-                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(userId,rolePermIdent,lastError)};
+                    QJsonObject outRolePermObject {};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getRolePermDetailObject(rolePermId,requesterId,outRolePermObject,lastError)};
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
-                                HttpResponse response {HttpLiterals::contentTypeJson(),"true",HttpResponse::StatusCode::Ok};
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::eTagHeader(),eTag);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::BadRequest:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Unauthorized:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Conflict:
+                        case SQL_Status::NotFound:
+                        case SQL_Status::UnprocessableEntity:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::NotFound);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                    }
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
+}
+
+void HttpClient::addAuthzRules(const HttpRequest &request, QAbstractSocket *socket)
+{
+    {// '/api/v1/u-auth/authz/<arg>/authorized-to/<arg>' rule for GET
+        auto handler {[&](const QString& userId,const QString& rolePermIdent){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/authz/<arg>/authorized-to/<arg>",HttpRequest::Method::GET,
+                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+
+                const QString userId {match.captured(1)};
+                const QString rolePermIdent {match.captured(2)};
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                if(!checkMinPolicyVersion(queryMap,request,socket)){
+                    return true;
+                }
+                //taken before the sql check, so the decision reflects at least this version
+                const quint64 policyVersion {versionStorePtr_->policyVersion()};
+                {
+                    const QString flightKey {QStringLiteral("GET authz/%1/authorized-to/%2|%3").arg(userId.toLower(),rolePermIdent).arg(policyVersion)};
+                    const SingleFlight::Result result {singleFlightPtr_->run(flightKey,[&]()->SingleFlight::Result{
+                            SingleFlight::Result flightResult {};
+                            flightResult.sqlStatus=sqlHandlerPtr_->getAuthzCheck(userId,rolePermIdent,flightResult.lastError);
+                            return flightResult;
+                        })
+                    };
+                    const QString lastError {result.lastError};
+                    const SQL_Status sqlStatus {result.sqlStatus};
+                    switch(sqlStatus){
+                        case SQL_Status::Success:
+                            {
+                                HttpResponse response {HttpLiterals::contentTypeJson(),"true",HttpResponse::StatusCode::Ok};
+                                setPolicyHeaders(response,policyVersion);
                                 sendResponse(response,request,socket);
                             }
                             break;
                         case SQL_Status::Unauthorized:
                             {
                                 HttpResponse response {HttpLiterals::contentTypeJson(),"false",HttpResponse::StatusCode::Ok};
+                                setPolicyHeaders(response,policyVersion);
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -908,19 +1340,37 @@ void HttpClient::addAuthzRules(const HttpRequest &request, QAbstractSocket *sock
                 }
 
                 const QMap<QString,QString> queryMap {getQueryMap(request)};
+                if(!checkMinPolicyVersion(queryMap,request,socket)){
+                    return true;
+                }
+                //taken before the sql check, so the decision reflects at least this version
+                const quint64 policyVersion {versionStorePtr_->policyVersion()};
                 {
-                    QString lastError {};
-                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(queryMap,lastError)};
+                    QStringList queryItems {};
+                    for(auto it=queryMap.cbegin();it!=queryMap.cend();++it){
+                        queryItems.push_back(it.key() + "=" + it.value());
+                    }
+                    const QString flightKey {QStringLiteral("GET authz?%1|%2").arg(queryItems.join("&")).arg(policyVersion)};
+                    const SingleFlight::Result result {singleFlightPtr_->run(flightKey,[&]()->SingleFlight::Result{
+                            SingleFlight::Result flightResult {};
+                            flightResult.sqlStatus=sqlHandlerPtr_->getAuthzCheck(queryMap,flightResult.lastError);
+                            return flightResult;
+                        })
+                    };
+                    const QString lastError {result.lastError};
+                    const SQL_Status sqlStatus {result.sqlStatus};
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
                                 HttpResponse response {HttpLiterals::contentTypeJson(),"true",HttpResponse::StatusCode::Ok};
+                                setPolicyHeaders(response,policyVersion);
                                 sendResponse(response,request,socket);
                             }
                             break;
                         case SQL_Status::Unauthorized:
                             {
                                 HttpResponse response {HttpLiterals::contentTypeJson(),"false",HttpResponse::StatusCode::Ok};
+                                setPolicyHeaders(response,policyVersion);
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -950,6 +1400,87 @@ void HttpClient::addAuthzRules(const HttpRequest &request, QAbstractSocket *sock
         });
         router_.addRule<ViewHandler>(rule);
     }
+    {// '/api/v1/u-auth/authz:batch' rule for POST
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/authz:batch",HttpRequest::Method::POST,
+                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                if(!checkMinPolicyVersion(queryMap,request,socket)){
+                    return true;
+                }
+                QJsonParseError parseError {};
+                const QJsonDocument inChecksDocument {QJsonDocument::fromJson(request.body(),&parseError)};
+                const QJsonArray checksArray {inChecksDocument.object().value("checks").toArray()};
+                if(!inChecksDocument.isObject() || checksArray.isEmpty() || checksArray.size() > 1000){
+                    const QString lastError {parseError.error!=QJsonParseError::NoError ? parseError.errorString()
+                                                                                       : QString {"Body must be object with 'checks' array of 1..1000 items"}};
+                    HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                    sendResponse(response,request,socket);
+                    return true;
+                }
+                //taken before the sql query, so every decision reflects at least this version
+                const quint64 policyVersion {versionStorePtr_->policyVersion()};
+                QJsonArray resultsArray {};
+                QString lastError {};
+                if(sqlHandlerPtr_->getAuthzBatch(checksArray,resultsArray,lastError)!=SQL_Status::Success){
+                    HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                    sendResponse(response,request,socket);
+                    return true;
+                }
+                const QJsonObject outResultObject {
+                    {"policy_version",static_cast<qint64>(policyVersion)},
+                    {"results",resultsArray}
+                };
+                HttpResponse response {HttpLiterals::contentTypeJson(),QJsonDocument(outResultObject).toJson(QJsonDocument::Compact),HttpResponse::StatusCode::Ok};
+                setPolicyHeaders(response,policyVersion);
+                sendResponse(response,request,socket);
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
+    {// '/api/v1/u-auth/authz/policy-version' rule for GET
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/authz/policy-version",HttpRequest::Method::GET,
+                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+
+                //long poll: with 'after' the answer is held until the version moves past it or 'timeout' ms pass
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                if(queryMap.contains("after")){
+                    bool isOk {false};
+                    const quint64 afterVersion {queryMap.value("after").toULongLong(&isOk)};
+                    if(!isOk){
+                        HttpResponse response(HttpLiterals::contentTypeText(),
+                                              QStringLiteral("Parameter 'after' incorrect value: %1").arg(queryMap.value("after")).toUtf8(),
+                                              HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    const int timeout {qBound(0,queryMap.value("timeout","30000").toInt(),60000)};
+                    versionStorePtr_->waitForPolicyVersion(afterVersion + 1,timeout);
+                }
+                const quint64 policyVersion {versionStorePtr_->policyVersion()};
+                const QJsonObject outVersionObject {
+                    {"policy_version",static_cast<qint64>(policyVersion)}
+                };
+                HttpResponse response {HttpLiterals::contentTypeJson(),QJsonDocument(outVersionObject).toJson(QJsonDocument::Compact),HttpResponse::StatusCode::Ok};
+                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
+                response.setHeader(HttpLiterals::cacheControlHeader(),"no-cache");
+                sendResponse(response,request,socket);
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
 }
 
 void HttpClient::addAuthzManageRules(const HttpRequest &request, QAbstractSocket *socket)
@@ -974,7 +1505,9 @@ void HttpClient::addAuthzManageRules(const HttpRequest &request, QAbstractSocket
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"users_roles_permissions",userId}})};
                                 HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outRolePermObject).toJson(),HttpResponse::StatusCode::Created);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -1025,7 +1558,9 @@ void HttpClient::addAuthzManageRules(const HttpRequest &request, QAbstractSocket
                     switch(sqlStatus){
                         case SQL_Status::Success:
                             {
+                                const quint64 policyVersion {syncWrite({{"users_roles_permissions",userId}})};
                                 HttpResponse response(HttpResponse::StatusCode::NoContent);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
                                 sendResponse(response,request,socket);
                             }
                             break;
@@ -1055,6 +1590,70 @@ void HttpClient::addAuthzManageRules(const HttpRequest &request, QAbstractSocket
         });
         router_.addRule<ViewHandler>(rule);
     }
+    {// '/api/v1/u-auth/authz/manage:bulk' rule for POST
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/authz/manage:bulk",HttpRequest::Method::POST,
+                                               [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+
+                const QString requesterId {getRequesterId(request)};
+                {
+                    QString lastError {};
+                    QJsonParseError parseError {};
+                    const QJsonDocument inOperationsDocument {QJsonDocument::fromJson(request.body(),&parseError)};
+                    if(!inOperationsDocument.isObject()){
+                        lastError=parseError.error==QJsonParseError::NoError ? QString {"Body is not json object"} : parseError.errorString();
+                        HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    QJsonObject outResultObject {};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->postAuthzManageBulk(requesterId,inOperationsDocument.object(),outResultObject,lastError)};
+                    switch(sqlStatus){
+                        case SQL_Status::Success:
+                            {
+                                //one table-wide bump for the whole batch
+                                const quint64 policyVersion {syncWrite({{"users_roles_permissions",QString {}}})};
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outResultObject).toJson(),HttpResponse::StatusCode::Ok);
+                                response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::BadRequest:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Unauthorized:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::UnprocessableEntity:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outResultObject).toJson(),HttpResponse::StatusCode::UnprocessableEntity);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Conflict:
+                        case SQL_Status::NotFound:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::NotFound);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                    }
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
 }
 
 void HttpClient::addCertificateRules(const HttpRequest &request, QAbstractSocket *socket)
@@ -1187,6 +1786,208 @@ void HttpClient::addCertificateRules(const HttpRequest &request, QAbstractSocket
     }
 }
 
+void HttpClient::addExportRules(const HttpRequest &request, QAbstractSocket *socket)
+{
+    {// '/api/v1/u-auth/export/<arg>' rule for GET
+        auto handler {[&](const QString& objectsName){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/export/<arg>",HttpRequest::Method::GET,
+                                               [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+                const QString requesterId {getRequesterId(request)};
+                const QString objectsName {match.captured(1)};
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                const QString format {queryMap.value("format","ndjson")};
+                const QMap<QString,QString> rolePermIdentMap {
+                    {"users","user:read"},
+                    {"roles-permissions","role_permission:read"},
+                    {"assignments","user:read role_permission:read"},
+                    {"hierarchy","role_permission:read"}
+                };
+                if(!rolePermIdentMap.contains(objectsName)){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::NotFound),request,socket);
+                    return true;
+                }
+                if(format!="ndjson" && format!="csv"){
+                    HttpResponse response(HttpLiterals::contentTypeText(),
+                                          QStringLiteral("Parameter 'format' incorrect value: %1").arg(format).toUtf8(),
+                                          HttpResponse::StatusCode::BadRequest);
+                    sendResponse(response,request,socket);
+                    return true;
+                }
+                {//authorize
+                    QString lastError{};
+                    const QString rolePermIdent {rolePermIdentMap.value(objectsName)};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,rolePermIdent,lastError)};
+                    if(sqlStatus!=SQL_Status::Success){
+                        HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                }
+                {//stream export
+                    //rows are buffered up to 'chunkSize' before a chunk is written,
+                    //the writer blocks while more than 'maxPendingSize' is still unsent
+                    const int chunkSize {64 * 1024};
+                    const qint64 maxPendingSize {1024 * 1024};
+                    const int writeTimeout {30000};
+
+                    QString lastError {};
+                    QByteArray buffer {};
+                    qint64 totalSize {0};
+                    bool isHeadersSent {false};
+                    HttpResponder responder {makeResponder(request,socket)};
+
+                    const auto writeChunk {[&](const QByteArray& chunk) -> bool {
+                            if(!isHeadersSent){
+                                const QByteArray contentType {format=="csv" ? HttpLiterals::contentTypeCsv() : HttpLiterals::contentTypeNdjson()};
+                                const QByteArray contentDisposition {QStringLiteral("attachment;filename=%1.%2").arg(objectsName,format).toUtf8()};
+                                responder.writeStatusLine(HttpResponder::StatusCode::Ok);
+                                responder.writeHeader(HttpLiterals::contentTypeHeader(),contentType);
+                                responder.writeHeader("Content-Disposition",contentDisposition);
+                                responder.writeChunkedHeaders(contentType);
+                                isHeadersSent=true;
+                            }
+                            responder.writeChunk(chunk);
+                            totalSize+=chunk.size();
+                            while(socket->bytesToWrite() > maxPendingSize){
+                                if(!socket->waitForBytesWritten(writeTimeout)){
+                                    return false;
+                                }
+                            }
+                            return socket->state()==QAbstractSocket::ConnectedState;
+                        }
+                    };
+                    const SQL_Status sqlStatus {pgHandlerPtr_->exportObjects(objectsName,format,[&](const char* data,int size){
+                            buffer.append(data,size);
+                            if(buffer.size() < chunkSize){
+                                return true;
+                            }
+                            const bool isChunkOk {writeChunk(buffer)};
+                            buffer.clear();
+                            return isChunkOk;
+                        },lastError)};
+
+                    if(sqlStatus!=SQL_Status::Success){
+                        if(isHeadersSent){
+                            //status line is already gone, dropping the connection before
+                            //the last chunk lets the client detect the truncated body
+                            qWarning(qPrintable(QStringLiteral("Export '%1' aborted, error: %2").arg(objectsName,lastError)));
+                            socket->abort();
+                            return true;
+                        }
+                        HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                        sendResponse(response,request,socket);
+                        return true;
+                    }
+                    if(!writeChunk(buffer)){
+                        socket->abort();
+                        return true;
+                    }
+                    responder.writeLastChunk();
+                    qDebug(qPrintable(QStringLiteral("[RESPONSE]; [EXPORT]: %1; [FORMAT]: %2; [SIZE]: %3").
+                                      arg(objectsName,format).arg(totalSize)));
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
+}
+
+void HttpClient::addChangesRules(const HttpRequest &request, QAbstractSocket *socket)
+{
+    {// '/api/v1/u-auth/changes' rule for GET, the same path with 'Upgrade: websocket' is the live feed
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/changes",HttpRequest::Method::GET,
+                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                if(!isIntegrityOk_){
+                    sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),request,socket);
+                    return true;
+                }
+                const QString requesterId {getRequesterId(request)};
+                const QMap<QString,QString> queryMap {getQueryMap(request)};
+                {
+                    QString lastError {};
+                    QJsonObject outChangesObject {};
+                    const SQL_Status sqlStatus {sqlHandlerPtr_->getChangesObject(queryMap,requesterId,outChangesObject,lastError)};
+                    switch(sqlStatus){
+                        case SQL_Status::Success:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeJson(),QJsonDocument(outChangesObject).toJson(),HttpResponse::StatusCode::Ok);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::BadRequest:
+                            {
+                                HttpResponse response(HttpLiterals::contentTypeText(),lastError.toUtf8(),HttpResponse::StatusCode::BadRequest);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Unauthorized:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::Unauthorized);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                        case SQL_Status::Conflict:
+                        case SQL_Status::NotFound:
+                        case SQL_Status::UnprocessableEntity:
+                            {
+                                HttpResponse response(HttpResponse::StatusCode::NotFound);
+                                sendResponse(response,request,socket);
+                            }
+                            break;
+                    }
+                }
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
+}
+
+void HttpClient::addMetricsRules(const HttpRequest &request, QAbstractSocket *socket)
+{
+    {// '/api/v1/u-auth/metrics' rule for GET
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/metrics",HttpRequest::Method::GET,
+                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                //counters only, so scrapers are served without a client certificate
+                QByteArray metricsData {decisionCachePtr_->metrics() + singleFlightPtr_->metrics() + changeFeedPtr_->metrics() +
+                            connectionTrackerPtr_->metrics()};
+                if(listenerGroupPtr_){
+                    metricsData+=listenerGroupPtr_->metrics();
+                }
+                HttpResponse response(QByteArrayLiteral("text/plain; version=0.0.4"),metricsData,HttpResponse::StatusCode::Ok);
+                sendResponse(response,request,socket);
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
+}
+
+void HttpClient::addHealthRules(const HttpRequest &request, QAbstractSocket *socket)
+{
+    {// '/api/v1/u-auth/health/ready' rule for GET
+        auto handler {[&](){}};
+        using ViewHandler=decltype (handler);
+        auto rule=new HttpRouterRule("/api/v1/u-auth/health/ready",HttpRequest::Method::GET,
+                                     [&] (QRegularExpressionMatch &match,const HttpRequest &request,QAbstractSocket *socket) {
+                //for load balancers and probes, so without a client certificate; false from a shutdown signal on
+                const bool isReady {isIntegrityOk_ && connectionTrackerPtr_->isReady()};
+                HttpResponse response(HttpLiterals::contentTypeText(),isReady ? QByteArray {"ready"} : QByteArray {"not ready"},
+                                      isReady ? HttpResponse::StatusCode::Ok : HttpResponse::StatusCode::ServiceUnavailable);
+                sendResponse(response,request,socket);
+                return true;
+        });
+        router_.addRule<ViewHandler>(rule);
+    }
+}
+
 void HttpClient::logRequest(const HttpRequest &request)
 {
     const QString logMsg {QStringLiteral("[REQUEST]; [URL]: %1; [METHOD]: %2; [BODY]: %3").
@@ -1248,11 +2049,114 @@ QMap<QString, QString> HttpClient::getQueryMap(const HttpRequest &request)
     return queryMap;
 }
 
+QByteArray HttpClient::getETag(const HttpRequest &request, const QString &requesterId, const QStringList &versions)
+{
+    //the requester's authorization inputs are part of the tag, so a 304 answered
+    //without sql never outlives the authorization decision behind the cached body
+    const QStringList authzVersions {
+        QString::number(versionStorePtr_->entityVersion("users_roles_permissions",requesterId)),
+        QString::number(versionStorePtr_->tableVersion("roles_permissions")),
+        QString::number(versionStorePtr_->tableVersion("roles_permissions_relationship"))
+    };
+    return versionStorePtr_->makeETag(QStringList {request.url().toString(),requesterId} + authzVersions + versions);
+}
+
+bool HttpClient::sendNotModified(const QByteArray &eTag, const HttpRequest &request, QAbstractSocket *socket)
+{
+    if(!VersionStore::isETagMatch(request.value(HttpLiterals::ifNoneMatchHeader()),eTag)){
+        return false;
+    }
+    HttpResponse response(HttpResponse::StatusCode::NotModified);
+    response.setHeader(HttpLiterals::eTagHeader(),eTag);
+    sendResponse(response,request,socket);
+    return true;
+}
+
+QByteArray HttpClient::toHttpDate(const QString &dateTimeText)
+{
+    QDateTime dateTime {QDateTime::fromString(dateTimeText,Qt::ISODateWithMs)};
+    if(!dateTime.isValid()){
+        return QByteArray {};
+    }
+    return QLocale::c().toString(dateTime.toUTC(),"ddd, dd MMM yyyy hh:mm:ss").toLatin1() + " GMT";
+}
+
+bool HttpClient::checkMinPolicyVersion(const QMap<QString, QString> &queryMap, const HttpRequest &request, QAbstractSocket *socket)
+{
+    if(!queryMap.contains("min_version")){
+        return true;
+    }
+    bool isOk {false};
+    const quint64 minVersion {queryMap.value("min_version").toULongLong(&isOk)};
+    if(!isOk){
+        HttpResponse response(HttpLiterals::contentTypeText(),
+                              QStringLiteral("Parameter 'min_version' incorrect value: %1").arg(queryMap.value("min_version")).toUtf8(),
+                              HttpResponse::StatusCode::BadRequest);
+        sendResponse(response,request,socket);
+        return false;
+    }
+    //the write may come from another instance whose change is not applied here yet
+    if(!versionStorePtr_->waitForGeneration(minVersion,minVersionWait_)){
+        const quint64 generation {versionStorePtr_->generation()};
+        HttpResponse response(HttpLiterals::contentTypeText(),
+                              QStringLiteral("Policy version: %1 not reached, current: %2").arg(minVersion).arg(generation).toUtf8(),
+                              HttpResponse::StatusCode::PreconditionFailed);
+        response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(generation));
+        sendResponse(response,request,socket);
+        return false;
+    }
+    return true;
+}
+
+quint64 HttpClient::syncWrite(const QVector<QPair<QString, QString>> &changes)
+{
+    QString lastError {};
+    quint64 generation {0};
+    if(sqlHandlerPtr_->getGeneration(generation,lastError)!=SQL_Status::Success){
+        generation=versionStorePtr_->generation() + 1;
+    }
+    if(!versionStorePtr_->waitForGeneration(generation,minVersionWait_)){
+        //listener is behind or down, caches here must not serve the old state meanwhile
+        for(const auto& change: changes){
+            if(change.second.isEmpty()){
+                versionStorePtr_->bumpTable(change.first,generation);
+            }
+            else{
+                versionStorePtr_->bumpEntity(change.first,change.second,generation);
+            }
+        }
+    }
+    //the same version reads report, so clients can compare them; it covers a write to the policy
+    //tables and is never ahead of the generation 'min_version' waits for
+    return versionStorePtr_->policyVersion();
+}
+
+void HttpClient::setPolicyHeaders(HttpResponse &response, quint64 policyVersion)
+{
+    response.setHeader(HttpLiterals::policyVersionHeader(),QByteArray::number(policyVersion));
+    response.setHeader(HttpLiterals::cacheControlHeader(),authzMaxAge_ > 0 ? "max-age=" + QByteArray::number(authzMaxAge_) : QByteArray {"no-cache"});
+}
+
 void HttpClient::run()
 {
     sqlHandlerPtr_.reset(new SQL_Handler{appSettingsPtr_});
+    sqlHandlerPtr_->setDecisionCache(decisionCachePtr_);
+    sqlHandlerPtr_->setPolicyCache(policyCachePtr_);
+    pgHandlerPtr_.reset(new PG_Handler{appSettingsPtr_});
     auto socket {sslEnable_ ? new QSslSocket : new QTcpSocket};
-    socket->setSocketDescriptor(socketDescriptor_);
+    if(!socket->setSocketDescriptor(socketDescriptor_)){
+        //the socket never owned the descriptor, no 'disconnected' would ever end this thread
+        const QString logMsg {QStringLiteral("Http connection not served, error: %1").arg(socket->errorString())};
+        qWarning(qPrintable(logMsg));
+        delete socket;
+#ifdef Q_OS_WINDOWS
+        ::closesocket(static_cast<SOCKET>(socketDescriptor_));
+#else
+        ::close(static_cast<int>(socketDescriptor_));
+#endif
+        connectionTrackerPtr_->connectionFinished();
+        return;
+    }
     if(sslEnable_){
         auto sslSocket {qobject_cast<QSslSocket*>(socket)};
         sslSocket->setSslConfiguration(sslConfiguration_);
@@ -1260,8 +2164,18 @@ void HttpClient::run()
     HttpRequest* request {new HttpRequest(socket->peerAddress())};
     http_parser_init(&request->d->httpParser,HTTP_REQUEST);
 
+    //an idle kept-alive connection holds a thread, so it is closed after 'keepAliveTimeout_' seconds
+    QTimer idleTimer {};
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(qMax(keepAliveTimeout_,1) * 1000);
+    idleTimerPtr_=&idleTimer;
+    QObject::connect(&idleTimer,&QTimer::timeout,[socket](){
+        socket->disconnectFromHost();
+    });
+
     QObject::connect(socket,&QTcpSocket::readyRead,
                      [this, request, socket](){
+        idleTimerPtr_->stop();
         handleReadyRead(socket,request);
     });
     QObject::connect(socket, &QTcpSocket::disconnected, [this,socket,request](){
@@ -1269,12 +2183,41 @@ void HttpClient::run()
         delete request;
         QThread::quit();
     });
+    //queued into this thread, so it never interrupts a request being handled;
+    //a request read in part is completed and answered, then the connection closes
+    const auto drainHandler {[socket](){
+            if(!socket->isTransactionStarted()){
+                socket->disconnectFromHost();
+            }
+        }
+    };
+    QObject::connect(connectionTrackerPtr_.data(),&ConnectionTracker::drainSignal,socket,drainHandler);
+    //accepted after the signal went out, it would otherwise stay open until the drain timeout
+    if(connectionTrackerPtr_->isDraining()){
+        drainHandler();
+    }
     QThread::exec();
+    idleTimerPtr_=nullptr;
+    connectionTrackerPtr_->connectionFinished();
 }
 
-HttpClient::HttpClient(qintptr socketDescriptor, bool isIntegrityOk, QSharedPointer<QSettings> appSettingsPtr, QObject *parent)
-    :QThread{parent},socketDescriptor_{socketDescriptor},isIntegrityOk_{isIntegrityOk},appSettingsPtr_{appSettingsPtr}
+HttpClient::HttpClient(qintptr socketDescriptor, bool isIntegrityOk, QSharedPointer<QSettings> appSettingsPtr,
+                       QSharedPointer<VersionStore> versionStorePtr, QSharedPointer<PolicyCache> policyCachePtr,
+                       QSharedPointer<DecisionCache> decisionCachePtr, QSharedPointer<SingleFlight> singleFlightPtr,
+                       QSharedPointer<ChangeFeed> changeFeedPtr, QSharedPointer<HttpListenerGroup> listenerGroupPtr,
+                       QSharedPointer<ConnectionTracker> connectionTrackerPtr, QObject *parent)
+    :QThread{parent},socketDescriptor_{socketDescriptor},isIntegrityOk_{isIntegrityOk},appSettingsPtr_{appSettingsPtr},
+     versionStorePtr_{versionStorePtr},policyCachePtr_{policyCachePtr},decisionCachePtr_{decisionCachePtr},
+     singleFlightPtr_{singleFlightPtr},changeFeedPtr_{changeFeedPtr},listenerGroupPtr_{listenerGroupPtr},
+     connectionTrackerPtr_{connectionTrackerPtr}
 {
+    //level 0 means no compression at all, so it switches the feature off
+    compressLevel_=appSettingsPtr_->value("UA_HTTP_COMPRESS_LEVEL",6).toInt();
+    compressMinSize_=compressLevel_==0 ? -1 : appSettingsPtr_->value("UA_HTTP_COMPRESS_MIN_SIZE",1024).toInt();
+    authzMaxAge_=appSettingsPtr_->value("UA_AUTHZ_CACHE_MAX_AGE",0).toInt();
+    minVersionWait_=appSettingsPtr_->value("UA_AUTHZ_MIN_VERSION_WAIT",1000).toInt();
+    //0 closes the connection after every response
+    keepAliveTimeout_=appSettingsPtr_->value("UA_HTTP_KEEP_ALIVE_TIMEOUT",5).toInt();
 }
 
 HttpClient::~HttpClient()
@@ -1294,38 +2237,137 @@ void HttpClient::handleReadyRead(QAbstractSocket *socket, HttpRequest *request)
     Q_ASSERT(socket);
     Q_ASSERT(request);
 
-    if(request->d->state==HttpRequestPrivate::State::OnMessageComplete){
-        request->d->clear();
+    //requests pipelined into one read are parsed and answered one after another
+    do{
+        //raw bytes of an upgrade request are read again by the web socket handshake
+        if(!socket->isTransactionStarted()){
+            socket->startTransaction();
+        }
+        if(request->d->state==HttpRequestPrivate::State::OnMessageComplete){
+            request->d->clear();
+        }
+        if(!request->d->parse(socket)){
+            socket->disconnect();
+            return;
+        }
+        if(!request->d->httpParser.upgrade && request->d->state != HttpRequestPrivate::State::OnMessageComplete){
+            //nothing of a next message yet, the connection is idle and may be drained
+            if(request->d->state==HttpRequestPrivate::State::NotStarted){
+                socket->commitTransaction();
+                idleTimerPtr_->start();
+            }
+            return; // Partial read
+        }
+        logRequest(*request);
+        if(request->d->httpParser.upgrade){
+            if(request->d->isPipelined){
+                //its bytes came with an earlier request and cannot be read again by the handshake
+                sendResponse(HttpResponse(HttpResponse::StatusCode::BadRequest),*request,socket);
+                socket->disconnectFromHost();
+                return;
+            }
+            handleUpgrade(socket,request);
+            return;
+        }
+        socket->commitTransaction();
+        if(!handleRequest(*request,socket)){
+            sendResponse(HttpResponse(HttpResponse::StatusCode::NotFound),*request,socket);
+        }
+        //HTTP/1.1 keeps the connection unless 'Connection: close', HTTP/1.0 only with 'Connection: keep-alive';
+        //a draining server closes it, the client reconnects to whichever process accepts then
+        if(keepAliveTimeout_ <= 0 || !request->d->isKeepAlive || connectionTrackerPtr_->isDraining()){
+            socket->disconnectFromHost();
+            return;
+        }
+    }while(request->d->hasPending());
+    idleTimerPtr_->start();
+}
+
+void HttpClient::handleUpgrade(QAbstractSocket *socket, HttpRequest *request)
+{
+    const bool isWebSocket {request->value("upgrade").compare("websocket",Qt::CaseInsensitive)==0};
+    if(!isWebSocket || request->method()!=HttpRequest::Method::GET || request->url().path()!="/api/v1/u-auth/changes"){
+        sendResponse(HttpResponse(HttpResponse::StatusCode::NotFound),*request,socket);
+        socket->disconnectFromHost();
+        return;
     }
-    if(!request->d->parse(socket)){
-        socket->disconnect();
+    if(!isIntegrityOk_){
+        sendResponse(HttpResponse(HttpResponse::StatusCode::FailedDependency),*request,socket);
+        socket->disconnectFromHost();
         return;
     }
-    if(!request->d->httpParser.upgrade && request->d->state != HttpRequestPrivate::State::OnMessageComplete){
-        return; // Partial read
+    const QMap<QString,QString> queryMap {getQueryMap(*request)};
+    qint64 sinceSequence {-1};
+    if(queryMap.contains("since")){
+        bool isOk {false};
+        sinceSequence=queryMap.value("since").toLongLong(&isOk);
+        if(!isOk || sinceSequence < 0){
+            HttpResponse response(HttpLiterals::contentTypeText(),
+                                  QStringLiteral("Parameter 'since' incorrect value: %1").arg(queryMap.value("since")).toUtf8(),
+                                  HttpResponse::StatusCode::BadRequest);
+            sendResponse(response,*request,socket);
+            socket->disconnectFromHost();
+            return;
+        }
     }
-    logRequest(*request);
-    if(!handleRequest(*request,socket)){
-        sendResponse(HttpResponse(HttpResponse::StatusCode::NotFound),*request,socket);
+    {//authorize, events carry users and roles/permissions alike
+        QString lastError{};
+        const QString requesterId {getRequesterId(*request)};
+        const SQL_Status sqlStatus {sqlHandlerPtr_->getAuthzCheck(requesterId,"user:read role_permission:read",lastError)};
+        if(sqlStatus!=SQL_Status::Success){
+            sendResponse(HttpResponse(HttpResponse::StatusCode::Unauthorized),*request,socket);
+            socket->disconnectFromHost();
+            return;
+        }
+    }
+    {//hand the connection over, it is no longer http from here
+        QObject::disconnect(socket,&QTcpSocket::readyRead,nullptr,nullptr);
+        QObject::disconnect(socket,&QTcpSocket::disconnected,nullptr,nullptr);
+        QObject::disconnect(connectionTrackerPtr_.data(),nullptr,socket,nullptr);
+        idleTimerPtr_->stop();
+        delete request;
+        socket->rollbackTransaction();
+        ChangeFeedSession* sessionPtr {new ChangeFeedSession{changeFeedPtr_,sqlHandlerPtr_,sinceSequence}};
+        QObject::connect(sessionPtr,&ChangeFeedSession::finishedSignal,sessionPtr,[this,sessionPtr](){
+            sessionPtr->deleteLater();
+            QThread::quit();
+        });
+        //the close reason carries the last 'seq' sent, a 'change_log' sequence, so the subscriber
+        //resumes with '?since=' on whichever process accepts then, the one taking over included
+        QObject::connect(connectionTrackerPtr_.data(),&ConnectionTracker::drainSignal,sessionPtr,&ChangeFeedSession::close);
+        sessionPtr->start(qobject_cast<QTcpSocket*>(socket));
     }
-    socket->disconnectFromHost();
 }
 
 bool HttpClient::handleRequest(const HttpRequest &request, QAbstractSocket *socket)
 {
-    addUserRules(request,socket);
-    addRolePermRules(request,socket);
-    addParentChildRules(request,socket);
-    addParentChildRules(request,socket);
-    addUserRolePermRules(request,socket);
-    addAuthzRules(request,socket);
-    addAuthzManageRules(request,socket);
-    addCertificateRules(request,socket);
-    return router_.handleRequest(request,socket); 
+    //rules only use their own arguments, so one set serves every request of a kept-alive connection
+    if(!isRulesAdded_){
+        addUserRules(request,socket);
+        addRolePermRules(request,socket);
+        addParentChildRules(request,socket);
+        addUserRolePermRules(request,socket);
+        addAuthzRules(request,socket);
+        addAuthzManageRules(request,socket);
+        addCertificateRules(request,socket);
+        addExportRules(request,socket);
+        addChangesRules(request,socket);
+        addMetricsRules(request,socket);
+        addHealthRules(request,socket);
+        isRulesAdded_=true;
+    }
+    return router_.handleRequest(request,socket);
 }
 
 void HttpClient::sendResponse(const HttpResponse &response, const HttpRequest &request, QAbstractSocket *socket)
 {
     logResponse(response);
-    response.write(HttpResponder(request, socket));
+    response.write(makeResponder(request,socket));
+}
+
+HttpResponder HttpClient::makeResponder(const HttpRequest &request, QAbstractSocket *socket)
+{
+    HttpResponder responder {request,socket};
+    responder.setCompression(compressMinSize_,compressLevel_);
+    return responder;
 }
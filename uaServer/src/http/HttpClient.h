@@ -2,6 +2,9 @@
 #define HTTPCLIENT_H
 
 #include <QMap>
+#include <QPair>
+#include <QVector>
+#include <QStringList>
 #include <QThread>
 #include <QSharedPointer>
 #include <QSslConfiguration>
@@ -12,8 +15,17 @@
 
 class HttpResponse;
 class SQL_Handler;
+class PG_Handler;
+class VersionStore;
+class PolicyCache;
+class DecisionCache;
+class SingleFlight;
+class ChangeFeed;
+class HttpListenerGroup;
+class ConnectionTracker;
 class QSettings;
 class QAbstractSocket;
+class QTimer;
 
 class HttpClient : public QThread
 {
@@ -25,8 +37,23 @@ private:
     bool sslEnable_ {false};
     QSslConfiguration sslConfiguration_;
     bool isIntegrityOk_ {false};
+    int compressMinSize_ {-1};
+    int compressLevel_ {-1};
+    int authzMaxAge_ {0};
+    int minVersionWait_ {1000};
+    int keepAliveTimeout_ {5};
+    bool isRulesAdded_ {false};
+    QTimer* idleTimerPtr_ {nullptr};
     QSharedPointer<QSettings> appSettingsPtr_  {nullptr};
     QSharedPointer<SQL_Handler> sqlHandlerPtr_ {nullptr};
+    QSharedPointer<PG_Handler> pgHandlerPtr_   {nullptr};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
+    QSharedPointer<DecisionCache> decisionCachePtr_ {nullptr};
+    QSharedPointer<SingleFlight> singleFlightPtr_ {nullptr};
+    QSharedPointer<ChangeFeed> changeFeedPtr_ {nullptr};
+    QSharedPointer<HttpListenerGroup> listenerGroupPtr_ {nullptr};
+    QSharedPointer<ConnectionTracker> connectionTrackerPtr_ {nullptr};
 
     void addUserRules(const HttpRequest &request, QAbstractSocket *socket);
     void addRolePermRules(const HttpRequest &request, QAbstractSocket *socket);
@@ -35,6 +62,10 @@ private:
     void addAuthzRules(const HttpRequest &request, QAbstractSocket *socket);
     void addAuthzManageRules(const HttpRequest &request, QAbstractSocket *socket);
     void addCertificateRules(const HttpRequest &request, QAbstractSocket *socket);
+    void addExportRules(const HttpRequest &request, QAbstractSocket *socket);
+    void addChangesRules(const HttpRequest &request, QAbstractSocket *socket);
+    void addMetricsRules(const HttpRequest &request, QAbstractSocket *socket);
+    void addHealthRules(const HttpRequest &request, QAbstractSocket *socket);
 
     void logRequest(const HttpRequest& request);
     void logResponse(const HttpResponse& response);
@@ -42,18 +73,32 @@ private:
     QString methodToText(HttpRequest::Method method);
     QString getRequesterId(const HttpRequest& request);
     QMap<QString,QString> getQueryMap(const HttpRequest& request);
+    QByteArray getETag(const HttpRequest& request,const QString& requesterId,const QStringList& versions);
+    bool sendNotModified(const QByteArray& eTag,const HttpRequest& request,QAbstractSocket* socket);
+    QByteArray toHttpDate(const QString& dateTimeText);
+    bool checkMinPolicyVersion(const QMap<QString,QString>& queryMap,const HttpRequest& request,QAbstractSocket* socket);
+    void setPolicyHeaders(HttpResponse& response,quint64 policyVersion);
+    //Wait Until The Listener Applied This Write, Local Bumps Stand In When It Does Not In Time;
+    //Returns Policy Version Including The Write, Empty Id Means Table-Wide
+    quint64 syncWrite(const QVector<QPair<QString,QString>>& changes);
 
 protected:
     virtual void run()override;
 
 public:
-    explicit HttpClient(qintptr socketDescriptor,bool isIntegrityOk,QSharedPointer<QSettings> appSettingsPtr,QObject* parent=nullptr);
+    explicit HttpClient(qintptr socketDescriptor,bool isIntegrityOk,QSharedPointer<QSettings> appSettingsPtr,
+                        QSharedPointer<VersionStore> versionStorePtr,QSharedPointer<PolicyCache> policyCachePtr,
+                        QSharedPointer<DecisionCache> decisionCachePtr,QSharedPointer<SingleFlight> singleFlightPtr,
+                        QSharedPointer<ChangeFeed> changeFeedPtr,QSharedPointer<HttpListenerGroup> listenerGroupPtr,
+                        QSharedPointer<ConnectionTracker> connectionTrackerPtr,QObject* parent=nullptr);
     ~HttpClient();
     void sslSetup(const QSslConfiguration& sslConfiguration);
 
     void handleReadyRead(QAbstractSocket* socket,HttpRequest* request);
+    void handleUpgrade(QAbstractSocket* socket,HttpRequest* request);
     bool handleRequest(const HttpRequest &request, QAbstractSocket *socket);
     void sendResponse(const HttpResponse &response, const HttpRequest &request, QAbstractSocket *socket);
+    HttpResponder makeResponder(const HttpRequest &request, QAbstractSocket *socket);
 };
 
 #endif // HTTPCLIENT_H
@@ -0,0 +1,140 @@
+#include "HttpCompressor.h"
+
+#include <QList>
+#include <zlib.h>
+
+QByteArray HttpCompressor::process(const char *data, int size, int flush)
+{
+    if(encoding_==Encoding::Identity){
+        return QByteArray(data,size);
+    }
+    if(!streamPtr_ || isFinished_){
+        return QByteArray {};
+    }
+    QByteArray outData {};
+    char buffer[16384];
+    streamPtr_->next_in=reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    streamPtr_->avail_in=static_cast<uInt>(size);
+    do{
+        streamPtr_->next_out=reinterpret_cast<Bytef*>(buffer);
+        streamPtr_->avail_out=static_cast<uInt>(sizeof(buffer));
+        if(deflate(streamPtr_.data(),flush)==Z_STREAM_ERROR){
+            break;
+        }
+        outData.append(buffer,static_cast<int>(sizeof(buffer)-streamPtr_->avail_out));
+    }while(streamPtr_->avail_out==0);
+    if(flush==Z_FINISH){
+        isFinished_=true;
+    }
+    return outData;
+}
+
+HttpCompressor::HttpCompressor(Encoding encoding, int level)
+    :encoding_{encoding}
+{
+    if(encoding_==Encoding::Identity){
+        return;
+    }
+    streamPtr_.reset(new z_stream{});
+    //windowBits+16 makes zlib write gzip header and trailer instead of zlib ones
+    const int windowBits {encoding_==Encoding::Gzip ? MAX_WBITS + 16 : MAX_WBITS};
+    if(deflateInit2(streamPtr_.data(),level,Z_DEFLATED,windowBits,8,Z_DEFAULT_STRATEGY)!=Z_OK){
+        streamPtr_.reset();
+    }
+}
+
+HttpCompressor::~HttpCompressor()
+{
+    if(streamPtr_){
+        deflateEnd(streamPtr_.data());
+    }
+}
+
+bool HttpCompressor::isValid() const
+{
+    return encoding_==Encoding::Identity || !streamPtr_.isNull();
+}
+
+HttpCompressor::Encoding HttpCompressor::encoding() const
+{
+    return encoding_;
+}
+
+QByteArray HttpCompressor::compress(const char *data, int size)
+{
+    return process(data,size,Z_NO_FLUSH);
+}
+
+QByteArray HttpCompressor::compress(const QByteArray &data)
+{
+    return process(data.constData(),data.size(),Z_NO_FLUSH);
+}
+
+QByteArray HttpCompressor::finish()
+{
+    if(encoding_==Encoding::Identity){
+        return QByteArray {};
+    }
+    return process(nullptr,0,Z_FINISH);
+}
+
+QByteArray HttpCompressor::encodingName(Encoding encoding)
+{
+    switch(encoding){
+    case Encoding::Gzip:
+        return QByteArrayLiteral("gzip");
+    case Encoding::Deflate:
+        return QByteArrayLiteral("deflate");
+    case Encoding::Identity:
+    default:
+        return QByteArrayLiteral("identity");
+    }
+}
+
+HttpCompressor::Encoding HttpCompressor::acceptedEncoding(const QByteArray &acceptEncoding)
+{
+    //'Accept-Encoding: gzip;q=0.8, deflate, *;q=0', unknown codings are ignored
+    double gzipQuality {-1.0};
+    double deflateQuality {-1.0};
+    double anyQuality {-1.0};
+    const QList<QByteArray> codings {acceptEncoding.split(',')};
+    for(const QByteArray& coding: codings){
+        const QList<QByteArray> params {coding.split(';')};
+        const QByteArray name {params.first().trimmed().toLower()};
+        double quality {1.0};
+        for(int i=1;i<params.size();++i){
+            const QByteArray param {params.at(i).trimmed()};
+            if(param.startsWith("q=")){
+                bool isOk {false};
+                const double value {param.mid(2).toDouble(&isOk)};
+                quality=isOk ? value : 0.0;
+            }
+        }
+        if(name=="gzip" || name=="x-gzip"){
+            gzipQuality=quality;
+        }
+        else if(name=="deflate"){
+            deflateQuality=quality;
+        }
+        else if(name=="*"){
+            anyQuality=quality;
+        }
+    }
+    if(gzipQuality < 0.0){
+        gzipQuality=anyQuality;
+    }
+    if(deflateQuality < 0.0){
+        deflateQuality=anyQuality;
+    }
+    if(gzipQuality <= 0.0 && deflateQuality <= 0.0){
+        return Encoding::Identity;
+    }
+    return gzipQuality >= deflateQuality ? Encoding::Gzip : Encoding::Deflate;
+}
+
+bool HttpCompressor::isCompressible(const QByteArray &mimeType)
+{
+    //pem/pkcs12 and other binary payloads do not shrink
+    const QByteArray type {mimeType.split(';').first().trimmed().toLower()};
+    return type.startsWith("text/") || type.endsWith("json") || type.endsWith("xml");
+}
@@ -0,0 +1,42 @@
+#ifndef HTTPCOMPRESSOR_H
+#define HTTPCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+
+struct z_stream_s;
+
+//Streaming zlib compressor for HTTP 'Content-Encoding'
+class HttpCompressor
+{
+public:
+    enum class Encoding{
+        Identity,
+        Gzip,
+        Deflate
+    };
+
+private:
+    Encoding encoding_ {Encoding::Identity};
+    QScopedPointer<z_stream_s> streamPtr_;
+    bool isFinished_ {false};
+
+    QByteArray process(const char* data,int size,int flush);
+
+public:
+    explicit HttpCompressor(Encoding encoding,int level=-1);
+    ~HttpCompressor();
+
+    bool isValid() const;
+    Encoding encoding() const;
+
+    QByteArray compress(const char* data,int size);
+    QByteArray compress(const QByteArray& data);
+    QByteArray finish();
+
+    static QByteArray encodingName(Encoding encoding);
+    static Encoding acceptedEncoding(const QByteArray& acceptEncoding);
+    static bool isCompressible(const QByteArray& mimeType);
+};
+
+#endif // HTTPCOMPRESSOR_H
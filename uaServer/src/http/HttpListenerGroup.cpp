@@ -0,0 +1,127 @@
+#include "HttpListenerGroup.h"
+#include "HttpAcceptor.h"
+
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+void HttpListenerGroup::failedSlot(const QString &lastError)
+{
+    HttpAcceptor* acceptorPtr {qobject_cast<HttpAcceptor*>(sender())};
+    if(!acceptorPtr){
+        return;
+    }
+    int index {-1};
+    {
+        QMutexLocker locker {&mutex_};
+        index=acceptors_.indexOf(acceptorPtr);
+    }
+    const QString logMsg {QStringLiteral("HttpAcceptor %1 stopped accepting, resumed in 1 s, error: %2").arg(index).arg(lastError)};
+    qWarning(qPrintable(logMsg));
+    //queued into the acceptor thread, a pause lets descriptors be released
+    QTimer::singleShot(1000,acceptorPtr,&HttpAcceptor::resumeSlot);
+}
+
+HttpListenerGroup::HttpListenerGroup(HttpServer *httpServerPtr, QObject *parent)
+    :QObject{parent},httpServerPtr_{httpServerPtr}
+{
+}
+
+HttpListenerGroup::~HttpListenerGroup()
+{
+    close();
+}
+
+bool HttpListenerGroup::listen(const QHostAddress &address, quint16 port, int count, QString &lastError)
+{
+    QVector<qintptr> listenDescriptors {};
+    for(int i=0;i<count;++i){
+        const qintptr listenDescriptor {HttpAcceptor::makeReusePortSocket(address,port,lastError)};
+        if(listenDescriptor < 0){
+#ifdef Q_OS_UNIX
+            for(qintptr descriptor: listenDescriptors){
+                ::close(static_cast<int>(descriptor));
+            }
+#endif
+            return false;
+        }
+        listenDescriptors.push_back(listenDescriptor);
+    }
+    return listen(listenDescriptors,lastError);
+}
+
+bool HttpListenerGroup::listen(const QVector<qintptr> &listenDescriptors, QString &lastError)
+{
+    close();
+    for(int i=0;i<listenDescriptors.size();++i){
+        HttpAcceptor* acceptorPtr {new HttpAcceptor{httpServerPtr_}};
+        if(!acceptorPtr->setSocketDescriptor(listenDescriptors.at(i))){
+            lastError=acceptorPtr->errorString();
+            delete acceptorPtr;
+            close();
+#ifdef Q_OS_UNIX
+            //the adopted ones went with their acceptors
+            for(int j=i;j<listenDescriptors.size();++j){
+                ::close(static_cast<int>(listenDescriptors.at(j)));
+            }
+#endif
+            return false;
+        }
+        //the socket notifier follows the acceptor into its thread
+        QThread* threadPtr {new QThread};
+        acceptorPtr->moveToThread(threadPtr);
+        QObject::connect(threadPtr,&QThread::finished,acceptorPtr,&HttpAcceptor::deleteLater);
+        QObject::connect(acceptorPtr,&HttpAcceptor::failedSignal,this,&HttpListenerGroup::failedSlot);
+        {
+            QMutexLocker locker {&mutex_};
+            threads_.push_back(threadPtr);
+            acceptors_.push_back(acceptorPtr);
+        }
+        threadPtr->start();
+    }
+    return true;
+}
+
+QVector<qintptr> HttpListenerGroup::socketDescriptors() const
+{
+    QMutexLocker locker {&mutex_};
+    QVector<qintptr> outDescriptors {};
+    for(const HttpAcceptor* acceptorPtr: acceptors_){
+        outDescriptors.push_back(acceptorPtr->socketDescriptor());
+    }
+    return outDescriptors;
+}
+
+void HttpListenerGroup::close()
+{
+    //acceptors are deleted by their threads on the way out, connections already accepted go on
+    QMutexLocker locker {&mutex_};
+    for(QThread* threadPtr: threads_){
+        threadPtr->quit();
+        threadPtr->wait();
+        delete threadPtr;
+    }
+    threads_.clear();
+    acceptors_.clear();
+}
+
+QByteArray HttpListenerGroup::metrics() const
+{
+    QMutexLocker locker {&mutex_};
+    QByteArray outData {};
+    outData+="# HELP uauth_http_listener_connections_total Connections accepted by an accept loop.\n"
+             "# TYPE uauth_http_listener_connections_total counter\n";
+    for(int i=0;i<acceptors_.size();++i){
+        outData+="uauth_http_listener_connections_total{listener=\"" + QByteArray::number(i) + "\"} "
+                + QByteArray::number(acceptors_.at(i)->accepted()) + "\n";
+    }
+    outData+="# HELP uauth_http_listener_restarts_total Accept loops resumed after an accept error.\n"
+             "# TYPE uauth_http_listener_restarts_total counter\n";
+    for(int i=0;i<acceptors_.size();++i){
+        outData+="uauth_http_listener_restarts_total{listener=\"" + QByteArray::number(i) + "\"} "
+                + QByteArray::number(acceptors_.at(i)->restarts()) + "\n";
+    }
+    return outData;
+}
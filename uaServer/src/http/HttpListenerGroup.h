@@ -0,0 +1,46 @@
+#ifndef HTTPLISTENERGROUP_H
+#define HTTPLISTENERGROUP_H
+
+#include <QMutex>
+#include <QVector>
+#include <QObject>
+#include <QThread>
+#include <QByteArray>
+#include <QHostAddress>
+
+class HttpServer;
+class HttpAcceptor;
+
+//UA_HTTP_LISTENERS > 1 replaces the single accept loop of HttpServer by that many
+//HttpAcceptor threads bound to the same address with SO_REUSEPORT. All of them feed
+//the one HttpServer, so caches, listener and publisher stay shared. The group
+//supervises them: an accept loop stopped by an error (out of descriptors and
+//alike) is resumed after a pause, and their counters are reported together.
+class HttpListenerGroup : public QObject
+{
+    Q_OBJECT
+private:
+    HttpServer* httpServerPtr_ {nullptr};
+    QVector<QThread*> threads_ {};
+    QVector<HttpAcceptor*> acceptors_ {};
+    //metrics are read by http client threads
+    mutable QMutex mutex_ {};
+
+private Q_SLOTS:
+    void failedSlot(const QString& lastError);
+
+public:
+    explicit HttpListenerGroup(HttpServer* httpServerPtr,QObject* parent=nullptr);
+    ~HttpListenerGroup();
+
+    //Start 'count' Accept Loops, Either All Or None
+    bool listen(const QHostAddress& address,quint16 port,int count,QString& lastError);
+    //Start One Accept Loop Per Inherited Listening Descriptor
+    bool listen(const QVector<qintptr>& listenDescriptors,QString& lastError);
+    QVector<qintptr> socketDescriptors() const;
+    void close();
+    //Prometheus Text Of Accepted Connections And Restarts Per Accept Loop
+    QByteArray metrics() const;
+};
+
+#endif // HTTPLISTENERGROUP_H
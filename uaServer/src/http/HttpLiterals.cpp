@@ -64,8 +64,62 @@ QByteArray HttpLiterals::contentTypeJson()
     return QByteArrayLiteral("application/json");
 }
 
+QByteArray HttpLiterals::contentTypeNdjson()
+{
+    return QByteArrayLiteral("application/x-ndjson");
+}
+
+QByteArray HttpLiterals::contentTypeCsv()
+{
+    return QByteArrayLiteral("text/csv");
+}
+
 QByteArray HttpLiterals::contentLengthHeader()
 {
     return QByteArrayLiteral("Content-Length");
 }
 
+QByteArray HttpLiterals::contentEncodingHeader()
+{
+    return QByteArrayLiteral("Content-Encoding");
+}
+
+QByteArray HttpLiterals::transferEncodingHeader()
+{
+    return QByteArrayLiteral("Transfer-Encoding");
+}
+
+QByteArray HttpLiterals::acceptEncodingHeader()
+{
+    return QByteArrayLiteral("Accept-Encoding");
+}
+
+QByteArray HttpLiterals::varyHeader()
+{
+    return QByteArrayLiteral("Vary");
+}
+
+QByteArray HttpLiterals::eTagHeader()
+{
+    return QByteArrayLiteral("ETag");
+}
+
+QByteArray HttpLiterals::ifNoneMatchHeader()
+{
+    return QByteArrayLiteral("If-None-Match");
+}
+
+QByteArray HttpLiterals::lastModifiedHeader()
+{
+    return QByteArrayLiteral("Last-Modified");
+}
+
+QByteArray HttpLiterals::cacheControlHeader()
+{
+    return QByteArrayLiteral("Cache-Control");
+}
+
+QByteArray HttpLiterals::policyVersionHeader()
+{
+    return QByteArrayLiteral("X-UAuth-Policy-Version");
+}
@@ -52,7 +52,18 @@ public:
     static QByteArray contentTypeText();
     static QByteArray contentTypeTextHtml();
     static QByteArray contentTypeJson();
+    static QByteArray contentTypeNdjson();
+    static QByteArray contentTypeCsv();
     static QByteArray contentLengthHeader();
+    static QByteArray contentEncodingHeader();
+    static QByteArray transferEncodingHeader();
+    static QByteArray acceptEncodingHeader();
+    static QByteArray varyHeader();
+    static QByteArray eTagHeader();
+    static QByteArray ifNoneMatchHeader();
+    static QByteArray lastModifiedHeader();
+    static QByteArray cacheControlHeader();
+    static QByteArray policyVersionHeader();
 };
 
 #endif // QHTTPSERVERLITERALS_P_H
@@ -0,0 +1,156 @@
+#include "HttpLocalServer.h"
+#include "HttpServer.h"
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#endif
+
+void HttpLocalServer::incomingConnection(qintptr socketDescriptor)
+{
+    httpServerPtr_->handleConnection(socketDescriptor);
+}
+
+HttpLocalServer::HttpLocalServer(HttpServer *httpServerPtr, QObject *parent)
+    :QTcpServer{parent},httpServerPtr_{httpServerPtr}
+{
+}
+
+HttpLocalServer::~HttpLocalServer()
+{
+    QTcpServer::close();
+    removeUnixSocket(socketPath_,socketInode_);
+}
+
+bool HttpLocalServer::listen(const QString &socketPath, const QString &mode, QString &lastError)
+{
+    quint64 socketInode {0};
+    const qintptr listenDescriptor {makeUnixSocket(socketPath,mode,socketInode,lastError)};
+    if(listenDescriptor < 0){
+        return false;
+    }
+    if(!QTcpServer::setSocketDescriptor(listenDescriptor)){
+        lastError=QTcpServer::errorString();
+#ifdef Q_OS_UNIX
+        ::close(static_cast<int>(listenDescriptor));
+#endif
+        removeUnixSocket(socketPath,socketInode);
+        return false;
+    }
+    socketPath_=socketPath;
+    socketInode_=socketInode;
+    return true;
+}
+
+bool HttpLocalServer::listen(qintptr socketDescriptor, QString &lastError)
+{
+#ifdef Q_OS_UNIX
+    sockaddr_un address {};
+    socklen_t addressSize {sizeof(address)};
+    if(::getsockname(static_cast<int>(socketDescriptor),reinterpret_cast<sockaddr*>(&address),&addressSize) < 0 || address.sun_family!=AF_UNIX){
+        lastError="Inherited socket is not a unix domain socket";
+        return false;
+    }
+    if(!QTcpServer::setSocketDescriptor(socketDescriptor)){
+        lastError=QTcpServer::errorString();
+        return false;
+    }
+    socketPath_=QString::fromLocal8Bit(address.sun_path);
+    struct stat fileStat {};
+    if(::stat(address.sun_path,&fileStat)==0){
+        socketInode_=static_cast<quint64>(fileStat.st_ino);
+    }
+    return true;
+#else
+    Q_UNUSED(socketDescriptor)
+    lastError="Unix domain socket listener is not supported on this platform";
+    return false;
+#endif
+}
+
+QString HttpLocalServer::socketPath() const
+{
+    return socketPath_;
+}
+
+void HttpLocalServer::release()
+{
+    QTcpServer::close();
+    socketPath_.clear();
+    socketInode_=0;
+}
+
+qintptr HttpLocalServer::makeUnixSocket(const QString &socketPath, const QString &mode, quint64 &outInode, QString &lastError)
+{
+#ifdef Q_OS_UNIX
+    bool isOk {false};
+    const uint modeBits {mode.toUInt(&isOk,8)};
+    if(!isOk || modeBits > 0777){
+        lastError=QStringLiteral("Socket mode incorrect value: %1").arg(mode);
+        return -1;
+    }
+    const QByteArray pathData {socketPath.toLocal8Bit()};
+    sockaddr_un address {};
+    if(pathData.isEmpty() || static_cast<size_t>(pathData.size()) >= sizeof(address.sun_path)){
+        lastError=QStringLiteral("Socket path empty or too long: %1").arg(socketPath);
+        return -1;
+    }
+    address.sun_family=AF_UNIX;
+    std::memcpy(address.sun_path,pathData.constData(),static_cast<size_t>(pathData.size()));
+
+    //a file left by a killed process would fail the bind, anything else is not touched
+    struct stat fileStat {};
+    if(::lstat(pathData.constData(),&fileStat)==0 && S_ISSOCK(fileStat.st_mode)){
+        ::unlink(pathData.constData());
+    }
+    const int listenDescriptor {::socket(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0)};
+    if(listenDescriptor < 0){
+        lastError=QStringLiteral("Unix socket not created, error: %1").arg(std::strerror(errno));
+        return -1;
+    }
+    //owner only while the file is created, 'mode' right after; umask is process wide, so startup only
+    const mode_t previousMask {::umask(0177)};
+    const int bindResult {::bind(listenDescriptor,reinterpret_cast<sockaddr*>(&address),sizeof(address))};
+    ::umask(previousMask);
+    if(bindResult < 0 || ::listen(listenDescriptor,SOMAXCONN) < 0){
+        lastError=QStringLiteral("Unix socket not bound to %1, error: %2").arg(socketPath).arg(std::strerror(errno));
+        ::close(listenDescriptor);
+        return -1;
+    }
+    if(::chmod(pathData.constData(),static_cast<mode_t>(modeBits)) < 0 || ::stat(pathData.constData(),&fileStat) < 0){
+        lastError=QStringLiteral("Permissions of %1 not set, error: %2").arg(socketPath).arg(std::strerror(errno));
+        ::close(listenDescriptor);
+        ::unlink(pathData.constData());
+        return -1;
+    }
+    outInode=static_cast<quint64>(fileStat.st_ino);
+    return listenDescriptor;
+#else
+    Q_UNUSED(socketPath)
+    Q_UNUSED(mode)
+    Q_UNUSED(outInode)
+    lastError="Unix domain socket listener is not supported on this platform";
+    return -1;
+#endif
+}
+
+void HttpLocalServer::removeUnixSocket(const QString &socketPath, quint64 socketInode)
+{
+#ifdef Q_OS_UNIX
+    if(socketPath.isEmpty()){
+        return;
+    }
+    const QByteArray pathData {socketPath.toLocal8Bit()};
+    struct stat fileStat {};
+    if(::lstat(pathData.constData(),&fileStat)==0 && static_cast<quint64>(fileStat.st_ino)==socketInode){
+        ::unlink(pathData.constData());
+    }
+#else
+    Q_UNUSED(socketPath)
+    Q_UNUSED(socketInode)
+#endif
+}
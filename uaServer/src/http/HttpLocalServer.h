@@ -0,0 +1,43 @@
+#ifndef HTTPLOCALSERVER_H
+#define HTTPLOCALSERVER_H
+
+#include <QString>
+#include <QTcpServer>
+
+class HttpServer;
+
+//Optional unix domain socket front-end (UA_UNIX_SOCKET) for clients on the same
+//host. Every accepted descriptor is handed to HttpServer and served by an HttpClient
+//thread exactly like a tcp connection, QTcpServer and QTcpSocket take any stream
+//socket descriptor. Unlike QLocalServer it can adopt an inherited socket and it
+//leaves the socket file alone once another process took the socket over.
+class HttpLocalServer : public QTcpServer
+{
+    Q_OBJECT
+private:
+    HttpServer* httpServerPtr_ {nullptr};
+    QString socketPath_ {};
+    quint64 socketInode_ {0};
+
+protected:
+    virtual void incomingConnection(qintptr socketDescriptor)override;
+
+public:
+    explicit HttpLocalServer(HttpServer* httpServerPtr,QObject* parent=nullptr);
+    ~HttpLocalServer();
+
+    //Replace Stale Socket File, Listen And Apply Octal 'mode' To It
+    bool listen(const QString& socketPath,const QString& mode,QString& lastError);
+    //Adopt Listening Socket Of Another Process
+    bool listen(qintptr socketDescriptor,QString& lastError);
+    QString socketPath() const;
+    //Stop Accepting, Socket File Stays For The Process It Was Handed Over To
+    void release();
+
+    //Bound And Listening AF_UNIX Socket, -1 On Failure; 'outInode' Identifies The File
+    static qintptr makeUnixSocket(const QString& socketPath,const QString& mode,quint64& outInode,QString& lastError);
+    //Remove Socket File Unless It Was Replaced Since
+    static void removeUnixSocket(const QString& socketPath,quint64 socketInode);
+};
+
+#endif // HTTPLOCALSERVER_H
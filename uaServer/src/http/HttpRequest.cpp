@@ -84,7 +84,11 @@ QByteArray HttpRequestPrivate::header(const QByteArray &key) const
 
 bool HttpRequestPrivate::parse(QIODevice *socket)
 {
-    const auto fragment = socket->readAll();
+    //a message begun in bytes read along with the previous one was pipelined
+    if (state == State::NotStarted || state == State::OnMessageComplete)
+        isPipelined = !pending.isEmpty();
+    pending.append(socket->readAll());
+    const auto &fragment = pending;
     if (fragment.size()) {
 #if QT_CONFIG(ssl)
         auto sslSocket = qobject_cast<QSslSocket *>(socket);
@@ -97,14 +101,24 @@ bool HttpRequestPrivate::parse(QIODevice *socket)
                                                 &httpParserSettings,
                                                 fragment.constData(),
                                                 size_t(fragment.size()));
-        if (int(parsed) < fragment.size()) {
+        if (HTTP_PARSER_ERRNO(&httpParser) == HPE_PAUSED) {
+            //stopped after one message, the rest is kept for the next one
+            http_parser_pause(&httpParser, 0);
+        } else if (int(parsed) < fragment.size()) {
             qWarning("Parse error: %d", httpParser.http_errno);
+            pending.clear();
             return false;
         }
+        pending.remove(0, int(parsed));
     }
     return true;
 }
 
+bool HttpRequestPrivate::hasPending() const
+{
+    return !pending.isEmpty();
+}
+
 uint HttpRequestPrivate::headerHash(const QByteArray &key) const
 {
     return qHash(key.toLower(), headersSeed);
@@ -112,6 +126,8 @@ uint HttpRequestPrivate::headerHash(const QByteArray &key) const
 
 void HttpRequestPrivate::clear()
 {
+    //a read holding no new message, e.g. the CRLF tolerated after a body, must not dispatch again
+    state = State::NotStarted;
     url.clear();
     lastHeader.clear();
     headers.clear();
@@ -225,6 +241,9 @@ int HttpRequestPrivate::onMessageComplete(http_parser *httpParser)
 {
     //qDebug() << httpParser;
     instance(httpParser)->state = State::OnMessageComplete;
+    instance(httpParser)->isKeepAlive = http_should_keep_alive(httpParser) != 0;
+    //one message per parse(), a pipelined one is handled after this one is answered
+    http_parser_pause(httpParser, 1);
     return 0;
 }
 
@@ -70,6 +70,8 @@ public:
         OnChunkHeader,
         OnChunkComplete
     } state = State::NotStarted;
+    //taken at message completion, the parser flags are reset by the next message
+    bool isKeepAlive = false;
     QByteArray body;
 
     QUrl url;
@@ -77,7 +79,11 @@ public:
     http_parser httpParser;
 
     QByteArray header(const QByteArray &key) const;
+    //parses bytes left by the previous call and newly read ones, up to the end of one message
     bool parse(QIODevice *socket);
+    bool hasPending() const;
+    //current message arrived behind the previous one, before it was answered
+    bool isPipelined = false;
 
     QByteArray lastHeader;
     QMap<uint, QPair<QByteArray, QByteArray>> headers;
@@ -88,6 +94,9 @@ public:
     QHostAddress remoteAddress;
 
 private:
+    //bytes read past the end of the last parsed message
+    QByteArray pending;
+
     static http_parser_settings httpParserSettings;
     static bool parseUrl(const char *at, size_t length, bool connect, QUrl *url);
 
@@ -394,6 +394,137 @@ void HttpResponder::writeBody(const QByteArray &body)
     writeBody(body.constData(), body.size());
 }
 
+/*!
+    This function writes "Transfer-Encoding: chunked" for a body of type
+    \a mimeType and, when compression is enabled and the client accepts it,
+    the matching "Content-Encoding" and "Vary" headers. Chunks written after
+    this call are compressed as one stream.
+
+    \sa setCompression(), writeChunk(), writeLastChunk()
+*/
+void HttpResponder::writeChunkedHeaders(const QByteArray &mimeType)
+{
+    Q_D(HttpResponder);
+    writeHeader(HttpLiterals::transferEncodingHeader(), QByteArrayLiteral("chunked"));
+    if (isCompressionEnabled(mimeType))
+        writeHeader(HttpLiterals::varyHeader(), HttpLiterals::acceptEncodingHeader());
+
+    const HttpCompressor::Encoding encoding = acceptedEncoding(mimeType);
+    if (encoding == HttpCompressor::Encoding::Identity)
+        return;
+
+    d->chunkCompressor.reset(new HttpCompressor(encoding, d->compressLevel));
+    if (!d->chunkCompressor->isValid()) {
+        d->chunkCompressor.reset();
+        return;
+    }
+    writeHeader(HttpLiterals::contentEncodingHeader(), HttpCompressor::encodingName(encoding));
+}
+
+/*!
+    This function writes a chunk \a chunk with size \a size of a body sent
+    with "Transfer-Encoding: chunked". Empty chunks are skipped, since a
+    zero-sized chunk terminates the body. If writeChunkedHeaders() negotiated
+    a content coding, the data is compressed first and may be held back by
+    the compressor until enough input is collected.
+
+    \sa writeLastChunk()
+*/
+void HttpResponder::writeChunk(const char *chunk, qint64 size)
+{
+    Q_D(HttpResponder);
+    if (d->chunkCompressor) {
+        const QByteArray compressed = d->chunkCompressor->compress(chunk, int(size));
+        writeChunkData(compressed.constData(), compressed.size());
+        return;
+    }
+    writeChunkData(chunk, size);
+}
+
+/*!
+    This function writes a chunk \a chunk of a body sent
+    with "Transfer-Encoding: chunked".
+*/
+void HttpResponder::writeChunk(const QByteArray &chunk)
+{
+    writeChunk(chunk.constData(), chunk.size());
+}
+
+/*!
+    This function flushes the compressor, if any, and writes the terminating
+    zero-sized chunk of a body sent with "Transfer-Encoding: chunked".
+*/
+void HttpResponder::writeLastChunk()
+{
+    Q_D(HttpResponder);
+    if (d->chunkCompressor) {
+        const QByteArray compressed = d->chunkCompressor->finish();
+        writeChunkData(compressed.constData(), compressed.size());
+        d->chunkCompressor.reset();
+    }
+    writeBody("0\r\n\r\n", 5);
+}
+
+void HttpResponder::writeChunkData(const char *chunk, qint64 size)
+{
+    if (size <= 0)
+        return;
+
+    writeBody(QByteArray::number(size, 16));
+    writeBody("\r\n", 2);
+    writeBody(chunk, size);
+    writeBody("\r\n", 2);
+}
+
+/*!
+    Enables response compression negotiated from the "Accept-Encoding"
+    header of the request. Bodies shorter than \a minSize bytes are sent
+    as is, a negative \a minSize disables compression. \a level is the
+    zlib level, -1 selects the zlib default.
+*/
+void HttpResponder::setCompression(int minSize, int level)
+{
+    Q_D(HttpResponder);
+    d->compressMinSize = minSize;
+    d->compressLevel = level;
+    d->compressEncoding = minSize < 0
+            ? HttpCompressor::Encoding::Identity
+            : HttpCompressor::acceptedEncoding(d->request.value(HttpLiterals::acceptEncodingHeader()));
+}
+
+/*!
+    Returns the zlib level set by setCompression().
+*/
+int HttpResponder::compressionLevel() const
+{
+    Q_D(const HttpResponder);
+    return d->compressLevel;
+}
+
+/*!
+    Returns true if a body of type \a mimeType may be compressed, so the
+    response depends on "Accept-Encoding" and has to carry "Vary".
+*/
+bool HttpResponder::isCompressionEnabled(const QByteArray &mimeType) const
+{
+    Q_D(const HttpResponder);
+    return d->compressMinSize >= 0 && HttpCompressor::isCompressible(mimeType);
+}
+
+/*!
+    Returns the content coding for a body of type \a mimeType with \a size
+    bytes, or HttpCompressor::Encoding::Identity if it is sent as is.
+    A negative \a size stands for a streamed body of unknown length.
+*/
+HttpCompressor::Encoding HttpResponder::acceptedEncoding(const QByteArray &mimeType, qint64 size) const
+{
+    Q_D(const HttpResponder);
+    if (!isCompressionEnabled(mimeType) || (size >= 0 && size < d->compressMinSize))
+        return HttpCompressor::Encoding::Identity;
+
+    return d->compressEncoding;
+}
+
 /*!
     Returns the socket used.
 */
@@ -41,6 +41,8 @@
 #include <utility>
 #include <initializer_list>
 
+#include "HttpCompressor.h"
+
 class QAbstractSocket;
 class HttpRequest;
 class HttpResponderPrivate;
@@ -168,12 +170,24 @@ public:
     void writeBody(const char *body);
     void writeBody(const QByteArray &body);
 
+    void writeChunkedHeaders(const QByteArray &mimeType);
+    void writeChunk(const char *chunk, qint64 size);
+    void writeChunk(const QByteArray &chunk);
+    void writeLastChunk();
+
+    void setCompression(int minSize, int level = -1);
+    int compressionLevel() const;
+    bool isCompressionEnabled(const QByteArray &mimeType) const;
+    HttpCompressor::Encoding acceptedEncoding(const QByteArray &mimeType, qint64 size = -1) const;
+
     QAbstractSocket *socket() const;
     const HttpRequest& request();
 
 private:
     HttpResponder(const HttpRequest &request, QAbstractSocket *socket);
 
+    void writeChunkData(const char *chunk, qint64 size);
+
     QScopedPointer<HttpResponderPrivate> d_ptr;
 };
 
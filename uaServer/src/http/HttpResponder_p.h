@@ -32,6 +32,7 @@
 
 #include "HttpRequest.h"
 #include "HttpResponder.h"
+#include "HttpCompressor.h"
 
 #include <QtCore/qcoreapplication.h>
 #include <QtCore/qpair.h>
@@ -59,6 +60,11 @@ public:
     const HttpRequest &request;
     QAbstractSocket *const socket;
     bool bodyStarted{false};
+
+    int compressMinSize{-1};
+    int compressLevel{-1};
+    HttpCompressor::Encoding compressEncoding{HttpCompressor::Encoding::Identity};
+    QScopedPointer<HttpCompressor> chunkCompressor;
 };
 
 #endif // QHTTPSERVERRESPONDER_P_H
@@ -345,11 +345,40 @@ QVector<QByteArray> HttpResponse::headers(const QByteArray &name) const
 void HttpResponse::write(HttpResponder &&responder) const
 {
     Q_D(const HttpResponse);
+    const QByteArray type = mimeType();
+    const bool isEncoded = hasHeader(HttpLiterals::contentEncodingHeader());
+
+    QByteArray compressed;
+    const HttpCompressor::Encoding encoding = isEncoded
+            ? HttpCompressor::Encoding::Identity
+            : responder.acceptedEncoding(type, d->data.size());
+    if (encoding != HttpCompressor::Encoding::Identity) {
+        HttpCompressor compressor(encoding, responder.compressionLevel());
+        compressed = compressor.compress(d->data) + compressor.finish();
+        // already compressed or tiny bodies may grow, send those as is
+        if (!compressor.isValid() || compressed.size() >= d->data.size())
+            compressed.clear();
+    }
+
     responder.writeStatusLine(d->statusCode);
 
     for (auto &&header : d->headers)
         responder.writeHeader(header.first, header.second);
 
+    if (!isEncoded && !d->data.isEmpty() && responder.isCompressionEnabled(type)
+            && !hasHeader(HttpLiterals::varyHeader())) {
+        responder.writeHeader(HttpLiterals::varyHeader(), HttpLiterals::acceptEncodingHeader());
+    }
+
+    if (!compressed.isEmpty()) {
+        responder.writeHeader(HttpLiterals::contentEncodingHeader(),
+                              HttpCompressor::encodingName(encoding));
+        responder.writeHeader(HttpLiterals::contentLengthHeader(),
+                              QByteArray::number(compressed.size()));
+        responder.writeBody(compressed);
+        return;
+    }
+
     responder.writeHeader(HttpLiterals::contentLengthHeader(),
                           QByteArray::number(d->data.size()));
 
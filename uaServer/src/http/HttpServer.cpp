@@ -1,23 +1,352 @@
 #include "HttpServer.h"
 #include "HttpClient.h"
+#include "HttpLocalServer.h"
+#include "HttpListenerGroup.h"
+#include "ConnectionTracker.h"
+#include "../authz/PolicyCache.h"
+#include "../authz/AuthzBinServer.h"
+#include "../authz/PolicyPublisher.h"
+#include "../authz/DecisionCache.h"
+#include "../authz/SnapshotFile.h"
+#include "../cache/SingleFlight.h"
+#include "../cache/VersionStore.h"
+#include "../feed/ChangeFeed.h"
+#include "../postgres/SQL_Handler.h"
+#include "../postgres/SQL_Listener.h"
+
+#include <QSettings>
+
+void HttpServer::loadSnapshotFile()
+{
+    QSharedPointer<PolicySnapshot> snapshotPtr {new PolicySnapshot};
+    QSharedPointer<AssignmentIndex> assignmentIndexPtr {new AssignmentIndex};
+    QString lastError {};
+    if(!SnapshotFile::read(snapshotPath_,*snapshotPtr,*assignmentIndexPtr,lastError)){
+        const QString logMsg {QStringLiteral("Policy snapshot file not loaded, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+        return;
+    }
+    fileSnapshotPtr_=snapshotPtr;
+    fileAssignmentIndexPtr_=assignmentIndexPtr;
+    qInfo("Policy snapshot file read: %s, versions: %llu, %llu",qPrintable(snapshotPath_),
+          snapshotPtr->version,assignmentIndexPtr->version);
+}
+
+void HttpServer::installSnapshotFile()
+{
+    //requests wait for integrity, so none is served before this
+    QString lastError {};
+    if(policyCachePtr_->installSnapshot(fileSnapshotPtr_,lastError)){
+        qInfo("Policy snapshot installed from file");
+    }
+    else{
+        const QString logMsg {QStringLiteral("Policy snapshot from file refused, loaded from database, reason: %1").arg(lastError)};
+        qInfo(qPrintable(logMsg));
+    }
+    lastError.clear();
+    SQL_Handler sqlHandler {appSettingsPtr_};
+    if(policyCachePtr_->installAssignmentIndex(fileAssignmentIndexPtr_,sqlHandler,lastError)){
+        qInfo("Assignment index installed from file");
+    }
+    else{
+        const QString logMsg {QStringLiteral("Assignment index from file refused, loaded from database, reason: %1").arg(lastError)};
+        qInfo(qPrintable(logMsg));
+    }
+    fileSnapshotPtr_.reset();
+    fileAssignmentIndexPtr_.reset();
+}
 
 void HttpServer::incomingConnection(qintptr socketDescriptor)
 {
-    HttpClient* httpClientPtr {new HttpClient(socketDescriptor,isIntegrityOk_,appSettingsPtr_)};
+    handleConnection(socketDescriptor);
+}
+
+void HttpServer::drainedSlot(bool isComplete)
+{
+    if(isDrained_){
+        return;
+    }
+    isDrained_=true;
+    if(drainTimerPtr_){
+        drainTimerPtr_->stop();
+    }
+    Q_EMIT drainedSignal(isComplete);
+}
+
+void HttpServer::handleConnection(qintptr socketDescriptor)
+{
+    connectionTrackerPtr_->connectionStarted();
+    HttpClient* httpClientPtr {new HttpClient(socketDescriptor,isIntegrityOk_.loadAcquire()!=0,appSettingsPtr_,versionStorePtr_,policyCachePtr_,decisionCachePtr_,
+                                                     singleFlightPtr_,changeFeedPtr_,listenerGroupPtr_,connectionTrackerPtr_)};
     QObject::connect(httpClientPtr,&QThread::finished,httpClientPtr,&HttpClient::deleteLater);
     httpClientPtr->start();
 }
 
 HttpServer::HttpServer(QSharedPointer<QSettings> appSettingsPtr, QObject *parent)
-    :QTcpServer{parent},appSettingsPtr_{appSettingsPtr}
+    :QTcpServer{parent},appSettingsPtr_{appSettingsPtr},versionStorePtr_{new VersionStore},singleFlightPtr_{new SingleFlight},
+     connectionTrackerPtr_{new ConnectionTracker}
+{
+    //emitted by the last connection thread, so queued into this one
+    QObject::connect(connectionTrackerPtr_.data(),&ConnectionTracker::drainedSignal,this,[this](){
+        drainedSlot(true);
+    });
+    policyCachePtr_.reset(new PolicyCache{versionStorePtr_});
+    //0 switches decision caching off
+    const int decisionCacheSize {appSettingsPtr_->value("UA_AUTHZ_DECISION_CACHE_SIZE",65536).toInt()};
+    decisionCachePtr_.reset(new DecisionCache{versionStorePtr_,decisionCacheSize});
+    //events kept for sessions resuming with '?since='
+    const int changesBufferSize {appSettingsPtr_->value("UA_CHANGES_BUFFER_SIZE",10000).toInt()};
+    changeFeedPtr_.reset(new ChangeFeed{changesBufferSize});
+    sqlListenerPtr_.reset(new SQL_Listener{appSettingsPtr_,versionStorePtr_});
+    sqlListenerPtr_->setChangeFeed(changeFeedPtr_);
+    sqlListenerPtr_->setPolicyCache(policyCachePtr_);
+
+    //empty path switches snapshot file off
+    snapshotPath_=appSettingsPtr_->value("UA_AUTHZ_SNAPSHOT_PATH").toString();
+    if(!snapshotPath_.isEmpty()){
+        loadSnapshotFile();
+        const int snapshotInterval {appSettingsPtr_->value("UA_AUTHZ_SNAPSHOT_INTERVAL",300).toInt()};
+        snapshotTimerPtr_.reset(new QTimer);
+        QObject::connect(snapshotTimerPtr_.get(),&QTimer::timeout,this,&HttpServer::snapshotTimeoutSlot);
+        snapshotTimerPtr_->start(qMax(snapshotInterval,1) * 1000);
+    }
+
+    //days of 'change_log' kept for '/changes?since=', 0 keeps all
+    changeLogRetention_=appSettingsPtr_->value("UA_CHANGE_LOG_RETENTION",7).toInt();
+    if(changeLogRetention_ > 0){
+        trimTimerPtr_.reset(new QTimer);
+        QObject::connect(trimTimerPtr_.get(),&QTimer::timeout,this,&HttpServer::trimTimeoutSlot);
+        trimTimerPtr_->start(60 * 60 * 1000);
+    }
+
+    //empty path switches shared memory segment off
+    const QString segmentPath {appSettingsPtr_->value("UA_AUTHZ_SHM_PATH").toString()};
+    if(!segmentPath.isEmpty()){
+        const qint64 segmentSize {appSettingsPtr_->value("UA_AUTHZ_SHM_SIZE",64).toLongLong() * 1024 * 1024};
+        policyPublisherPtr_.reset(new PolicyPublisher{segmentPath,segmentSize,appSettingsPtr_,versionStorePtr_,policyCachePtr_});
+        policyPublisherPtr_->start();
+    }
+}
+
+HttpServer::~HttpServer()
+{
+    //stopped before the caches it reads from go away
+    policyPublisherPtr_.reset();
+    //the next process starts from what this one loaded last
+    if(snapshotTimerPtr_){
+        snapshotTimerPtr_->stop();
+        snapshotTimeoutSlot();
+    }
+    //clients keep the group for metrics, its accept loops must not outlive the server
+    if(listenerGroupPtr_){
+        listenerGroupPtr_->close();
+    }
+}
+
+bool HttpServer::listenAuthzBin(const QHostAddress &address, quint16 port, QString &lastError)
+{
+    authzBinServerPtr_.reset(new AuthzBinServer{appSettingsPtr_,versionStorePtr_,policyCachePtr_,decisionCachePtr_,connectionTrackerPtr_});
+    authzBinServerPtr_->setIntegrityOk(isIntegrityOk_.loadAcquire()!=0);
+    if(!authzBinServerPtr_->listen(address,port)){
+        lastError=authzBinServerPtr_->errorString();
+        authzBinServerPtr_.reset();
+        return false;
+    }
+    qInfo("AuthzBinServer started at: %s:%d",qPrintable(authzBinServerPtr_->serverAddress().toString()),authzBinServerPtr_->serverPort());
+    return true;
+}
+
+bool HttpServer::listenAuthzBin(qintptr socketDescriptor, QString &lastError)
+{
+    authzBinServerPtr_.reset(new AuthzBinServer{appSettingsPtr_,versionStorePtr_,policyCachePtr_,decisionCachePtr_,connectionTrackerPtr_});
+    authzBinServerPtr_->setIntegrityOk(isIntegrityOk_.loadAcquire()!=0);
+    if(!authzBinServerPtr_->setSocketDescriptor(socketDescriptor)){
+        lastError=authzBinServerPtr_->errorString();
+        authzBinServerPtr_.reset();
+        return false;
+    }
+    qInfo("AuthzBinServer inherited at: %s:%d",qPrintable(authzBinServerPtr_->serverAddress().toString()),authzBinServerPtr_->serverPort());
+    return true;
+}
+
+bool HttpServer::listenLocal(const QString &socketPath, const QString &mode, QString &lastError)
+{
+    httpLocalServerPtr_.reset(new HttpLocalServer{this});
+    if(!httpLocalServerPtr_->listen(socketPath,mode,lastError)){
+        httpLocalServerPtr_.reset();
+        return false;
+    }
+    qInfo("HttpLocalServer started at: %s",qPrintable(httpLocalServerPtr_->socketPath()));
+    return true;
+}
+
+bool HttpServer::listenLocal(qintptr socketDescriptor, QString &lastError)
+{
+    httpLocalServerPtr_.reset(new HttpLocalServer{this});
+    if(!httpLocalServerPtr_->listen(socketDescriptor,lastError)){
+        httpLocalServerPtr_.reset();
+        return false;
+    }
+    qInfo("HttpLocalServer inherited at: %s",qPrintable(httpLocalServerPtr_->socketPath()));
+    return true;
+}
+
+bool HttpServer::listenReusePort(const QHostAddress &address, quint16 port, int count, QString &lastError)
+{
+    //set before the first connection, clients report its metrics
+    listenerGroupPtr_.reset(new HttpListenerGroup{this});
+    if(!listenerGroupPtr_->listen(address,port,count,lastError)){
+        listenerGroupPtr_.reset();
+        return false;
+    }
+    qInfo("HttpServer started at: %s:%d, accept loops: %d",qPrintable(address.toString()),port,count);
+    return true;
+}
+
+bool HttpServer::listenReusePort(const QVector<qintptr> &socketDescriptors, QString &lastError)
 {
+    listenerGroupPtr_.reset(new HttpListenerGroup{this});
+    if(!listenerGroupPtr_->listen(socketDescriptors,lastError)){
+        listenerGroupPtr_.reset();
+        return false;
+    }
+    qInfo("HttpServer inherited accept loops: %d",socketDescriptors.size());
+    return true;
+}
+
+QMultiHash<QString, qintptr> HttpServer::listenSockets() const
+{
+    QMultiHash<QString,qintptr> outSockets {};
+    if(QTcpServer::isListening()){
+        outSockets.insert("http",QTcpServer::socketDescriptor());
+    }
+    if(listenerGroupPtr_){
+        for(qintptr socketDescriptor: listenerGroupPtr_->socketDescriptors()){
+            outSockets.insert("http",socketDescriptor);
+        }
+    }
+    if(authzBinServerPtr_ && authzBinServerPtr_->isListening()){
+        outSockets.insert("authz-bin",authzBinServerPtr_->socketDescriptor());
+    }
+    if(httpLocalServerPtr_ && httpLocalServerPtr_->isListening()){
+        outSockets.insert("unix",httpLocalServerPtr_->socketDescriptor());
+    }
+    return outSockets;
+}
+
+void HttpServer::stopListening(bool isHandedOver)
+{
+    //only this process' descriptors are closed, a process they were handed to goes on accepting
+    QTcpServer::close();
+    if(listenerGroupPtr_){
+        listenerGroupPtr_->close();
+    }
+    if(authzBinServerPtr_){
+        authzBinServerPtr_->close();
+    }
+    if(httpLocalServerPtr_){
+        if(isHandedOver){
+            httpLocalServerPtr_->release();
+        }
+        else{
+            httpLocalServerPtr_.reset();
+        }
+    }
+    if(isHandedOver){
+        //the segment lock goes with it, the next process publishes from its own listener
+        policyPublisherPtr_.reset();
+    }
+}
+
+void HttpServer::drain(int drainTimeout)
+{
+    qInfo("Draining connections: %d, timeout: %d s",connectionTrackerPtr_->connections(),drainTimeout);
+    drainTimerPtr_.reset(new QTimer);
+    drainTimerPtr_->setSingleShot(true);
+    QObject::connect(drainTimerPtr_.get(),&QTimer::timeout,this,[this](){
+        const QString logMsg {QStringLiteral("Drain timed out, connections left: %1").arg(connectionTrackerPtr_->connections())};
+        qWarning(qPrintable(logMsg));
+        drainedSlot(false);
+    });
+    drainTimerPtr_->start(qMax(drainTimeout,0) * 1000);
+    connectionTrackerPtr_->drain();
+}
+
+void HttpServer::setReady(bool isReady)
+{
+    connectionTrackerPtr_->setReady(isReady);
 }
 
 void HttpServer::integritySlot(bool isIntegrityOk, const QString &lastError)
 {
-    isIntegrityOk_=isIntegrityOk;
-    if(!isIntegrityOk_){
+    isIntegrityOk_.storeRelease(isIntegrityOk ? 1 : 0);
+    if(authzBinServerPtr_){
+        authzBinServerPtr_->setIntegrityOk(isIntegrityOk);
+    }
+    if(!isIntegrityOk){
         const QString logMsg {QStringLiteral("Integrity failed, error: %1").arg(lastError)};
         qCritical(qPrintable(logMsg));
+        return;
+    }
+    if(!sqlListenerPtr_->isListening()){
+        QString listenError {};
+        if(!sqlListenerPtr_->start(listenError)){
+            const QString logMsg {QStringLiteral("Change notifications not subscribed, error: %1").arg(listenError)};
+            qWarning(qPrintable(logMsg));
+        }
+    }
+    {//without notifications this is all that moves the versions on, with them it is a cheap no-op
+        QString catchUpError {};
+        if(!sqlListenerPtr_->catchUp(catchUpError)){
+            const QString logMsg {QStringLiteral("Change log not applied, error: %1").arg(catchUpError)};
+            qWarning(qPrintable(logMsg));
+        }
+        else if(fileSnapshotPtr_){
+            installSnapshotFile();
+        }
+    }
+    //load roles/permissions before the first request, so names resolve without a query
+    SQL_Handler sqlHandler {appSettingsPtr_};
+    QString loadError {};
+    if(!policyCachePtr_->snapshot(sqlHandler,loadError)){
+        const QString logMsg {QStringLiteral("Policy snapshot not loaded, error: %1").arg(loadError)};
+        qWarning(qPrintable(logMsg));
+    }
+}
+
+void HttpServer::snapshotTimeoutSlot()
+{
+    //only what request threads already loaded is written, the timer never queries database
+    QSharedPointer<const PolicySnapshot> snapshotPtr {nullptr};
+    QSharedPointer<const AssignmentIndex> assignmentIndexPtr {nullptr};
+    policyCachePtr_->loaded(snapshotPtr,assignmentIndexPtr);
+    if(!snapshotPtr || !assignmentIndexPtr){
+        return;
+    }
+    const QPair<quint64,quint64> versions {snapshotPtr->version,assignmentIndexPtr->version};
+    if(versions==writtenSnapshotVersions_){
+        return;
+    }
+    QString lastError {};
+    if(!SnapshotFile::write(snapshotPath_,*snapshotPtr,*assignmentIndexPtr,lastError)){
+        const QString logMsg {QStringLiteral("Policy snapshot file not written, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+        return;
+    }
+    writtenSnapshotVersions_=versions;
+}
+
+void HttpServer::trimTimeoutSlot()
+{
+    //every instance trims, the statements are idempotent and the listener connection is not always up
+    int removed {0};
+    QString lastError {};
+    if(!sqlListenerPtr_->trimChangeLog(changeLogRetention_,removed,lastError)){
+        const QString logMsg {QStringLiteral("Change log not trimmed, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+        return;
+    }
+    if(removed > 0){
+        qInfo("Change log trimmed, rows removed: %d",removed);
     }
 }
@@ -1,23 +1,93 @@
 #ifndef HTTPSERVER_H
 #define HTTPSERVER_H
 
+#include <QPair>
+#include <QTimer>
+#include <QVector>
+#include <QAtomicInt>
+#include <QMultiHash>
+#include <QHostAddress>
 #include <QTcpServer>
 #include <QSharedPointer>
 
 class QSettings;
+class VersionStore;
+class PolicyCache;
+struct PolicySnapshot;
+struct AssignmentIndex;
+class DecisionCache;
+class SingleFlight;
+class SQL_Listener;
+class PolicyPublisher;
+class ChangeFeed;
+class AuthzBinServer;
+class HttpLocalServer;
+class HttpListenerGroup;
+class ConnectionTracker;
 class HttpServer : public QTcpServer
 {
     Q_OBJECT
 private:
-    bool isIntegrityOk_ {false};
+    QAtomicInt isIntegrityOk_ {0};
     QSharedPointer<QSettings> appSettingsPtr_ {nullptr};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
+    QSharedPointer<DecisionCache> decisionCachePtr_ {nullptr};
+    QSharedPointer<SingleFlight> singleFlightPtr_ {nullptr};
+    QSharedPointer<SQL_Listener> sqlListenerPtr_ {nullptr};
+    QSharedPointer<QTimer> snapshotTimerPtr_ {nullptr};
+    QSharedPointer<QTimer> trimTimerPtr_ {nullptr};
+    int changeLogRetention_ {7};
+    QSharedPointer<PolicyPublisher> policyPublisherPtr_ {nullptr};
+    QSharedPointer<ChangeFeed> changeFeedPtr_ {nullptr};
+    QSharedPointer<AuthzBinServer> authzBinServerPtr_ {nullptr};
+    QSharedPointer<HttpLocalServer> httpLocalServerPtr_ {nullptr};
+    QSharedPointer<HttpListenerGroup> listenerGroupPtr_ {nullptr};
+    QSharedPointer<ConnectionTracker> connectionTrackerPtr_ {nullptr};
+    QSharedPointer<QTimer> drainTimerPtr_ {nullptr};
+    bool isDrained_ {false};
+    QString snapshotPath_ {};
+    QPair<quint64,quint64> writtenSnapshotVersions_ {0,0};
+    //read at start, installed once the listener knows the versions of the database
+    QSharedPointer<PolicySnapshot> fileSnapshotPtr_ {nullptr};
+    QSharedPointer<AssignmentIndex> fileAssignmentIndexPtr_ {nullptr};
+
+    void loadSnapshotFile();
+    void installSnapshotFile();
+private Q_SLOTS:
+    void drainedSlot(bool isComplete);
 protected:
     virtual void incomingConnection(qintptr socketDescriptor)override;
 public:
     explicit HttpServer(QSharedPointer<QSettings> appSettingsPtr,QObject* parent=nullptr);
-    ~HttpServer()=default;
+    ~HttpServer();
+    //Start Binary Authorization Protocol Listener Sharing Caches With Http Clients
+    bool listenAuthzBin(const QHostAddress& address,quint16 port,QString& lastError);
+    bool listenAuthzBin(qintptr socketDescriptor,QString& lastError);
+    //Start Unix Domain Socket Listener Served By The Same Http Clients, 'mode' Is Octal Like chmod
+    bool listenLocal(const QString& socketPath,const QString& mode,QString& lastError);
+    bool listenLocal(qintptr socketDescriptor,QString& lastError);
+    //Accept On 'count' SO_REUSEPORT Sockets In Own Threads Instead Of listen()
+    bool listenReusePort(const QHostAddress& address,quint16 port,int count,QString& lastError);
+    bool listenReusePort(const QVector<qintptr>& socketDescriptors,QString& lastError);
+    //Listening Descriptors By Name: "http", "authz-bin", "unix"; See SocketHandoff
+    QMultiHash<QString,qintptr> listenSockets() const;
+    //Stop Accepting Everywhere; Handed Over Sockets Keep Their Unix Socket File
+    void stopListening(bool isHandedOver);
+    //Close Idle Connections, Busy Ones After Their Response; 'drainedSignal' When None
+    //Is Left Or After 'drainTimeout' Seconds
+    void drain(int drainTimeout);
+    //Readiness Of '/health/ready', Turned Off First On Shutdown
+    void setReady(bool isReady);
+    //Serve Accepted Connection, Tcp Or Unix Domain, Called From Any Accepting Thread
+    void handleConnection(qintptr socketDescriptor);
 public Q_SLOTS:
     void integritySlot(bool isIntegrityOk,const QString& lastError);
+    void snapshotTimeoutSlot();
+    void trimTimeoutSlot();
+Q_SIGNALS:
+    //'isComplete' False When Connections Were Left At The Timeout
+    void drainedSignal(bool isComplete);
 };
 
 #endif // HTTPSERVER_H
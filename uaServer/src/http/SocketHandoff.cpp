@@ -0,0 +1,252 @@
+#include "SocketHandoff.h"
+#include "HttpLocalServer.h"
+
+#include <QTcpSocket>
+#include <QStringList>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#endif
+
+namespace{
+//a handoff never carries more, a cmsg buffer for them is small
+const int maxSockets {64};
+//first descriptor passed by systemd
+const int listenFdsStart {3};
+const char handoffRequest {'H'};
+
+#ifdef Q_OS_UNIX
+int connectUnixSocket(const QString& socketPath)
+{
+    const QByteArray pathData {socketPath.toLocal8Bit()};
+    sockaddr_un address {};
+    if(pathData.isEmpty() || static_cast<size_t>(pathData.size()) >= sizeof(address.sun_path)){
+        return -1;
+    }
+    address.sun_family=AF_UNIX;
+    std::memcpy(address.sun_path,pathData.constData(),static_cast<size_t>(pathData.size()));
+    const int socketDescriptor {::socket(AF_UNIX,SOCK_STREAM | SOCK_CLOEXEC,0)};
+    if(socketDescriptor < 0){
+        return -1;
+    }
+    if(::connect(socketDescriptor,reinterpret_cast<sockaddr*>(&address),sizeof(address)) < 0){
+        ::close(socketDescriptor);
+        return -1;
+    }
+    return socketDescriptor;
+}
+
+bool sendSockets(int socketDescriptor,const QMultiHash<QString,qintptr>& sockets)
+{
+    QStringList names {};
+    QVector<int> descriptors {};
+    for(auto it=sockets.constBegin();it!=sockets.constEnd() && descriptors.size() < maxSockets;++it){
+        names.push_back(it.key());
+        descriptors.push_back(static_cast<int>(it.value()));
+    }
+    QByteArray namesData {names.join(',').toUtf8()};
+    if(namesData.isEmpty()){
+        //sendmsg needs at least one byte to carry the descriptors
+        namesData=",";
+    }
+    iovec ioVector {};
+    ioVector.iov_base=namesData.data();
+    ioVector.iov_len=static_cast<size_t>(namesData.size());
+    QByteArray controlData(static_cast<int>(CMSG_SPACE(sizeof(int) * maxSockets)),'\0');
+    msghdr message {};
+    message.msg_iov=&ioVector;
+    message.msg_iovlen=1;
+    if(!descriptors.isEmpty()){
+        message.msg_control=controlData.data();
+        message.msg_controllen=CMSG_SPACE(sizeof(int) * static_cast<size_t>(descriptors.size()));
+        cmsghdr* controlPtr {CMSG_FIRSTHDR(&message)};
+        controlPtr->cmsg_level=SOL_SOCKET;
+        controlPtr->cmsg_type=SCM_RIGHTS;
+        controlPtr->cmsg_len=CMSG_LEN(sizeof(int) * static_cast<size_t>(descriptors.size()));
+        std::memcpy(CMSG_DATA(controlPtr),descriptors.constData(),sizeof(int) * static_cast<size_t>(descriptors.size()));
+    }
+    return ::sendmsg(socketDescriptor,&message,MSG_NOSIGNAL) >= 0;
+}
+#endif
+}
+
+void SocketHandoff::incomingConnection(qintptr socketDescriptor)
+{
+    //lives in the main thread, a request is a single byte
+    QTcpSocket* socket {new QTcpSocket{this}};
+    socket->setSocketDescriptor(socketDescriptor);
+    QObject::connect(socket,&QTcpSocket::disconnected,socket,&QTcpSocket::deleteLater);
+    QObject::connect(socket,&QTcpSocket::readyRead,this,[this,socket](){
+        const QByteArray request {socket->readAll()};
+        if(request.isEmpty() || request.at(0)!=handoffRequest){
+            socket->disconnectFromHost();
+            return;
+        }
+#ifdef Q_OS_UNIX
+        if(!sendSockets(static_cast<int>(socket->socketDescriptor()),sockets_)){
+            const QString logMsg {QStringLiteral("Listening sockets not handed over, error: %1").arg(std::strerror(errno))};
+            qWarning(qPrintable(logMsg));
+            socket->disconnectFromHost();
+            return;
+        }
+#endif
+        socket->disconnectFromHost();
+        qInfo("Listening sockets handed over: %d",sockets_.size());
+        Q_EMIT handedOverSignal();
+    });
+}
+
+SocketHandoff::SocketHandoff(QObject *parent)
+    :QTcpServer{parent}
+{
+}
+
+SocketHandoff::~SocketHandoff()
+{
+    QTcpServer::close();
+    //the next process binds a new file at the same path, which stays
+    HttpLocalServer::removeUnixSocket(socketPath_,socketInode_);
+}
+
+bool SocketHandoff::listen(const QString &socketPath, QString &lastError)
+{
+    quint64 socketInode {0};
+    const qintptr listenDescriptor {HttpLocalServer::makeUnixSocket(socketPath,"600",socketInode,lastError)};
+    if(listenDescriptor < 0){
+        return false;
+    }
+    if(!QTcpServer::setSocketDescriptor(listenDescriptor)){
+        lastError=QTcpServer::errorString();
+#ifdef Q_OS_UNIX
+        ::close(static_cast<int>(listenDescriptor));
+#endif
+        HttpLocalServer::removeUnixSocket(socketPath,socketInode);
+        return false;
+    }
+    socketPath_=socketPath;
+    socketInode_=socketInode;
+    return true;
+}
+
+void SocketHandoff::release()
+{
+    QTcpServer::close();
+    socketPath_.clear();
+    socketInode_=0;
+}
+
+void SocketHandoff::setSockets(const QMultiHash<QString, qintptr> &sockets)
+{
+    sockets_=sockets;
+}
+
+bool SocketHandoff::takeSystemdSockets(QMultiHash<QString, qintptr> &outSockets)
+{
+#ifdef Q_OS_UNIX
+    //only descriptors meant for this very process, not for a parent that left them set
+    if(qgetenv("LISTEN_PID").toLongLong()!=static_cast<qint64>(::getpid())){
+        return false;
+    }
+    const int listenFds {qgetenv("LISTEN_FDS").toInt()};
+    const QStringList names {QString::fromUtf8(qgetenv("LISTEN_FDNAMES")).split(':')};
+    ::unsetenv("LISTEN_PID");
+    ::unsetenv("LISTEN_FDS");
+    ::unsetenv("LISTEN_FDNAMES");
+    for(int i=0;i<listenFds;++i){
+        const int socketDescriptor {listenFdsStart + i};
+        ::fcntl(socketDescriptor,F_SETFD,FD_CLOEXEC);
+        const QString name {i < names.size() ? names.at(i) : QString {}};
+        //systemd names unnamed ones after the socket unit, so anything unknown is http
+        outSockets.insert(name=="authz-bin" || name=="unix" ? name : QString {"http"},socketDescriptor);
+    }
+    return !outSockets.isEmpty();
+#else
+    Q_UNUSED(outSockets)
+    return false;
+#endif
+}
+
+bool SocketHandoff::isServing(const QString &socketPath)
+{
+#ifdef Q_OS_UNIX
+    const int socketDescriptor {connectUnixSocket(socketPath)};
+    if(socketDescriptor < 0){
+        return false;
+    }
+    ::close(socketDescriptor);
+    return true;
+#else
+    Q_UNUSED(socketPath)
+    return false;
+#endif
+}
+
+bool SocketHandoff::requestSockets(const QString &socketPath, QMultiHash<QString, qintptr> &outSockets, QString &lastError)
+{
+#ifdef Q_OS_UNIX
+    const int socketDescriptor {connectUnixSocket(socketPath)};
+    if(socketDescriptor < 0){
+        lastError=QStringLiteral("Handoff socket %1 not connected, error: %2").arg(socketPath).arg(std::strerror(errno));
+        return false;
+    }
+    const timeval timeout {5,0};
+    ::setsockopt(socketDescriptor,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+    if(::send(socketDescriptor,&handoffRequest,1,MSG_NOSIGNAL)!=1){
+        lastError=QStringLiteral("Handoff not requested, error: %1").arg(std::strerror(errno));
+        ::close(socketDescriptor);
+        return false;
+    }
+    QByteArray namesData(4096,'\0');
+    iovec ioVector {};
+    ioVector.iov_base=namesData.data();
+    ioVector.iov_len=static_cast<size_t>(namesData.size());
+    QByteArray controlData(static_cast<int>(CMSG_SPACE(sizeof(int) * maxSockets)),'\0');
+    msghdr message {};
+    message.msg_iov=&ioVector;
+    message.msg_iovlen=1;
+    message.msg_control=controlData.data();
+    message.msg_controllen=static_cast<size_t>(controlData.size());
+    const ssize_t received {::recvmsg(socketDescriptor,&message,MSG_CMSG_CLOEXEC)};
+    const int receiveError {errno};
+    ::close(socketDescriptor);
+    if(received <= 0){
+        lastError=QStringLiteral("Handoff not answered, error: %1").arg(received < 0 ? std::strerror(receiveError) : "connection closed");
+        return false;
+    }
+    QVector<int> descriptors {};
+    for(cmsghdr* controlPtr=CMSG_FIRSTHDR(&message);controlPtr!=nullptr;controlPtr=CMSG_NXTHDR(&message,controlPtr)){
+        if(controlPtr->cmsg_level!=SOL_SOCKET || controlPtr->cmsg_type!=SCM_RIGHTS){
+            continue;
+        }
+        const int count {static_cast<int>((controlPtr->cmsg_len - CMSG_LEN(0)) / sizeof(int))};
+        const int* descriptorsPtr {reinterpret_cast<const int*>(CMSG_DATA(controlPtr))};
+        for(int i=0;i<count;++i){
+            descriptors.push_back(descriptorsPtr[i]);
+        }
+    }
+    const QStringList names {QString::fromUtf8(namesData.constData(),static_cast<int>(received)).split(',',QString::SkipEmptyParts)};
+    if(names.size()!=descriptors.size() || (message.msg_flags & MSG_CTRUNC)){
+        for(int descriptor: descriptors){
+            ::close(descriptor);
+        }
+        lastError="Handoff answer malformed";
+        return false;
+    }
+    for(int i=0;i<descriptors.size();++i){
+        outSockets.insert(names.at(i),descriptors.at(i));
+    }
+    return true;
+#else
+    Q_UNUSED(socketPath)
+    Q_UNUSED(outSockets)
+    lastError="Socket handoff is not supported on this platform";
+    return false;
+#endif
+}
@@ -0,0 +1,49 @@
+#ifndef SOCKETHANDOFF_H
+#define SOCKETHANDOFF_H
+
+#include <QString>
+#include <QMultiHash>
+#include <QTcpServer>
+
+//Listening sockets survive a restart in one of two ways:
+//- systemd socket activation: LISTEN_FDS descriptors from 3 on, named by
+//  FileDescriptorName= of the .socket unit (LISTEN_FDNAMES), a lone unnamed one is http;
+//- handoff (UA_HANDOFF_SOCKET): the running process serves a unix socket, a new
+//  process connects, sends 'H' and gets every listening descriptor with SCM_RIGHTS
+//  plus their comma separated names. The old process stops accepting and drains.
+//Names: "http" (one per accept loop), "authz-bin", "unix". Accept queues are shared,
+//so no connection is refused while the processes swap.
+class SocketHandoff : public QTcpServer
+{
+    Q_OBJECT
+private:
+    QString socketPath_ {};
+    quint64 socketInode_ {0};
+    QMultiHash<QString,qintptr> sockets_ {};
+
+protected:
+    virtual void incomingConnection(qintptr socketDescriptor)override;
+
+public:
+    explicit SocketHandoff(QObject* parent=nullptr);
+    ~SocketHandoff();
+
+    //Serve Handoff Requests On 'socketPath', Owner Only
+    bool listen(const QString& socketPath,QString& lastError);
+    //Stop Serving, The Socket File Is Left To The Next Process
+    void release();
+    //Descriptors Sent To The Next Process, Still Owned By The Listeners
+    void setSockets(const QMultiHash<QString,qintptr>& sockets);
+
+    //Take Over Descriptors Passed By systemd, False When There Are None
+    static bool takeSystemdSockets(QMultiHash<QString,qintptr>& outSockets);
+    //A Running Process Answers On 'socketPath'
+    static bool isServing(const QString& socketPath);
+    //Ask The Running Process For Its Listening Descriptors
+    static bool requestSockets(const QString& socketPath,QMultiHash<QString,qintptr>& outSockets,QString& lastError);
+
+Q_SIGNALS:
+    void handedOverSignal();
+};
+
+#endif // SOCKETHANDOFF_H
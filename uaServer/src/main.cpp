@@ -10,6 +10,7 @@
 #include <vector>
 #include "../Version.h"
 #include "Bootloader.h"
+#include "SignalWatcher.h"
 
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
@@ -105,6 +106,28 @@ void setEnvironments()
     //_putenv("UA_ORIGINS=[http://127.0.0.1:8030]");
     //_putenv("UA_SSL_WEB_CRT_VALID=365");
 
+    //optional http params
+    //_putenv("UA_HTTP_COMPRESS_MIN_SIZE=1024");
+    //_putenv("UA_HTTP_COMPRESS_LEVEL=6");
+    //_putenv("UA_HTTP_KEEP_ALIVE_TIMEOUT=5");
+    //_putenv("UA_AUTHZ_CACHE_MAX_AGE=5");
+    //_putenv("UA_AUTHZ_MIN_VERSION_WAIT=1000");
+    //_putenv("UA_AUTHZ_DECISION_CACHE_SIZE=65536");
+    //_putenv("UA_HIERARCHY_MAX_DEPTH=32");
+    //_putenv("UA_AUTHZ_SNAPSHOT_PATH=C:/uauth/authz-snapshot.bin");
+    //_putenv("UA_AUTHZ_SNAPSHOT_INTERVAL=300");
+    //_putenv("UA_AUTHZ_SHM_PATH=C:/uauth/authz-policy.shm");
+    //_putenv("UA_AUTHZ_SHM_SIZE=64");
+    //_putenv("UA_CHANGES_BUFFER_SIZE=10000");
+    //_putenv("UA_CHANGE_LOG_RETENTION=7");
+    //_putenv("UA_AUTHZ_BIN_PORT=8031");
+    //_putenv("UA_UNIX_SOCKET=/run/uauth/uauth.sock");
+    //_putenv("UA_UNIX_SOCKET_MODE=660");
+    //_putenv("UA_HTTP_LISTENERS=4");
+    //_putenv("UA_HANDOFF_SOCKET=/run/uauth/handoff.sock");
+    //_putenv("UA_DRAIN_TIMEOUT=30");
+    //_putenv("UA_SHUTDOWN_DELAY=5");
+
     //uauth certificates part
     _putenv("UA_CA_CRT_PATH=C:/uauth/root-ca.pem");
     _putenv("UA_SIGNING_CA_CRT_PATH=C:/uauth/signing-ca.pem");
@@ -143,6 +166,28 @@ void setEnvironments()
     //setenv("UA_ORIGINS","[http://127.0.0.1:8030]",0);
     //setenv("UA_SSL_WEB_CRT_VALID","365",0);
 
+    //optional http params
+    //setenv("UA_HTTP_COMPRESS_MIN_SIZE","1024",0);
+    //setenv("UA_HTTP_COMPRESS_LEVEL","6",0);
+    //setenv("UA_HTTP_KEEP_ALIVE_TIMEOUT","5",0);
+    //setenv("UA_AUTHZ_CACHE_MAX_AGE","5",0);
+    //setenv("UA_AUTHZ_MIN_VERSION_WAIT","1000",0);
+    //setenv("UA_AUTHZ_DECISION_CACHE_SIZE","65536",0);
+    //setenv("UA_HIERARCHY_MAX_DEPTH","32",0);
+    //setenv("UA_AUTHZ_SNAPSHOT_PATH",QString("/home/%1/uauth/authz-snapshot.bin").arg(userName).toLatin1(),0);
+    //setenv("UA_AUTHZ_SNAPSHOT_INTERVAL","300",0);
+    //setenv("UA_AUTHZ_SHM_PATH","/dev/shm/uauth-policy",0);
+    //setenv("UA_AUTHZ_SHM_SIZE","64",0);
+    //setenv("UA_CHANGES_BUFFER_SIZE","10000",0);
+    //setenv("UA_CHANGE_LOG_RETENTION","7",0);
+    //setenv("UA_AUTHZ_BIN_PORT","8031",0);
+    //setenv("UA_UNIX_SOCKET","/run/uauth/uauth.sock",0);
+    //setenv("UA_UNIX_SOCKET_MODE","660",0);
+    //setenv("UA_HTTP_LISTENERS","4",0);
+    //setenv("UA_HANDOFF_SOCKET","/run/uauth/handoff.sock",0);
+    //setenv("UA_DRAIN_TIMEOUT","30",0);
+    //setenv("UA_SHUTDOWN_DELAY","5",0);
+
     //uauth certificates
     setenv("UA_CA_CRT_PATH",QString("/home/%1/uauth/root-ca.pem").arg(userName).toLatin1(),0);
     setenv("UA_SIGNING_CA_CRT_PATH",QString("/home/%1/uauth/signing-ca.pem").arg(userName).toLatin1(),0);
@@ -180,6 +225,23 @@ int main(int argc, char *argv[])
         const QString envValue {qgetenv(envKey.toLatin1().constData())};
         appSettingsPtr->setValue(envKey,envValue);
     }
+    //optional params, settings are persistent so unset ones are removed to fall back to defaults
+    const QStringList& optionalEnvList {"UA_HTTP_COMPRESS_MIN_SIZE","UA_HTTP_COMPRESS_LEVEL","UA_HTTP_KEEP_ALIVE_TIMEOUT",
+                                        "UA_AUTHZ_CACHE_MAX_AGE","UA_AUTHZ_MIN_VERSION_WAIT",
+                                        "UA_AUTHZ_DECISION_CACHE_SIZE","UA_HIERARCHY_MAX_DEPTH",
+                                        "UA_AUTHZ_SNAPSHOT_PATH","UA_AUTHZ_SNAPSHOT_INTERVAL",
+                                        "UA_AUTHZ_SHM_PATH","UA_AUTHZ_SHM_SIZE",
+                                        "UA_CHANGES_BUFFER_SIZE","UA_CHANGE_LOG_RETENTION","UA_AUTHZ_BIN_PORT",
+                                        "UA_UNIX_SOCKET","UA_UNIX_SOCKET_MODE","UA_HTTP_LISTENERS",
+                                        "UA_HANDOFF_SOCKET","UA_DRAIN_TIMEOUT","UA_SHUTDOWN_DELAY"};
+    for(const QString& envKey: optionalEnvList){
+        if(!qEnvironmentVariableIsSet(envKey.toLatin1().data())){
+            appSettingsPtr->remove(envKey);
+            continue;
+        }
+        const QString envValue {qgetenv(envKey.toLatin1().constData())};
+        appSettingsPtr->setValue(envKey,envValue);
+    }
 
     QString lastError {};
     const bool isLoggerOk {initLogger(lastError)};
@@ -191,15 +253,27 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    Bootloader bootloader {appSettingsPtr};
-    QObject::connect(&bootloader,&Bootloader::finishedSignal,[&](bool isSuccess,const QString& lastError){
-        if(!isSuccess){
-            std::cerr<<lastError.toStdString()<<std::endl;
-            std::exit(1);
-        }
-        std::exit(0);
-    });
-    bootloader.run();
-    return app.exec();
+    int exitCode {0};
+    {
+        Bootloader bootloader {appSettingsPtr};
+        SignalWatcher signalWatcher {};
+        QObject::connect(&signalWatcher,&SignalWatcher::terminateSignal,&bootloader,&Bootloader::shutdownSlot);
+        QObject::connect(&bootloader,&Bootloader::finishedSignal,[&](bool isSuccess,const QString& lastError){
+            if(!isSuccess){
+                //before the event loop or with connection threads still busy, nothing is waited for
+                qCritical(qPrintable(lastError));
+                std::cerr<<lastError.toStdString()<<std::endl;
+                loggerPtr_->flush();
+                std::exit(1);
+            }
+            //connections are drained, so the server and its database connections go with the scope
+            QCoreApplication::exit(0);
+        });
+        bootloader.run();
+        exitCode=app.exec();
+    }
+    qInfo("uaServer stopped");
+    loggerPtr_->flush();
+    return exitCode;
 }
 
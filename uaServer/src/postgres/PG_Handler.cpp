@@ -0,0 +1,132 @@
+#include "PG_Handler.h"
+#include "PG_Importer.h"
+
+#include <QMap>
+#include <QBuffer>
+#include <QSettings>
+
+QSharedPointer<PGconn> PG_Handler::makeConn(QString &lastError)
+{
+    const QByteArray UA_DB_NAME {appSettingsPtr_->value("UA_DB_NAME").toString().toUtf8()};
+    const QByteArray UA_DB_HOST {appSettingsPtr_->value("UA_DB_HOST").toString().toUtf8()};
+    const QByteArray UA_DB_PORT {appSettingsPtr_->value("UA_DB_PORT").toString().toUtf8()};
+    const QByteArray UA_DB_USER {appSettingsPtr_->value("UA_DB_USER").toString().toUtf8()};
+    const QByteArray UA_DB_PASS {appSettingsPtr_->value("UA_DB_PASS").toString().toUtf8()};
+
+    const char* keywords[] {"dbname","host","port","user","password","connect_timeout",nullptr};
+    const char* values[] {UA_DB_NAME.constData(),UA_DB_HOST.constData(),UA_DB_PORT.constData(),
+                          UA_DB_USER.constData(),UA_DB_PASS.constData(),"10",nullptr};
+    QSharedPointer<PGconn> connPtr {PQconnectdbParams(keywords,values,0),&PQfinish};
+    if(PQstatus(connPtr.get())!=CONNECTION_OK){
+        lastError=QString {PQerrorMessage(connPtr.get())};
+        return nullptr;
+    }
+    return connPtr;
+}
+
+PG_Handler::PG_Handler(QSharedPointer<QSettings> appSettingsPtr)
+    :appSettingsPtr_{appSettingsPtr}
+{
+}
+
+//Export Objects
+SQL_Status PG_Handler::exportObjects(const QString &objectsName, const QString &format, const ChunkHandler &chunkHandler, QString &lastError)
+{
+    const QMap<QString,QString> tableMap {
+        {"users","users"},
+        {"roles-permissions","roles_permissions"},
+        {"assignments","users_roles_permissions"},
+        {"hierarchy","roles_permissions_relationship"}
+    };
+    const auto it {tableMap.find(objectsName)};
+    if(it==tableMap.end()){
+        lastError=QStringLiteral("Unknown export objects: '%1'").arg(objectsName);
+        return SQL_Status::NotFound;
+    }
+
+    QString queryText {};
+    if(format=="ndjson"){
+        //row_to_json() escapes control characters, so neither QUOTE nor DELIMITER
+        //can occur in the output and each row is emitted verbatim as one json line
+        queryText=QStringLiteral("COPY (SELECT row_to_json(t) FROM %1 t) TO STDOUT "
+                                 "WITH (FORMAT csv, QUOTE E'\\x01', DELIMITER E'\\x02')").arg(it.value());
+    }
+    else if(format=="csv"){
+        queryText=QStringLiteral("COPY %1 TO STDOUT WITH (FORMAT csv, HEADER true)").arg(it.value());
+    }
+    else{
+        lastError=QStringLiteral("Parameter 'format' incorrect value: %1").arg(format);
+        return SQL_Status::BadRequest;
+    }
+
+    QSharedPointer<PGconn> connPtr {makeConn(lastError)};
+    if(!connPtr){
+        return SQL_Status::BadRequest;
+    }
+    {//start copy
+        QSharedPointer<PGresult> resPtr {PQexec(connPtr.get(),queryText.toUtf8().constData()),&PQclear};
+        if(PQresultStatus(resPtr.get())!=PGRES_COPY_OUT){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            return SQL_Status::BadRequest;
+        }
+    }
+    {//read copy data
+        char* buffer {nullptr};
+        int size {0};
+        while((size=PQgetCopyData(connPtr.get(),&buffer,0)) > 0){
+            const bool isChunkOk {chunkHandler(buffer,size)};
+            PQfreemem(buffer);
+            if(!isChunkOk){
+                //closing the connection makes the backend abort the COPY
+                lastError=QStringLiteral("Export interrupted by receiver");
+                return SQL_Status::BadRequest;
+            }
+        }
+        if(size==-2){
+            lastError=QString {PQerrorMessage(connPtr.get())};
+            return SQL_Status::BadRequest;
+        }
+    }
+    {//check copy result
+        QSharedPointer<PGresult> resPtr {PQgetResult(connPtr.get()),&PQclear};
+        if(PQresultStatus(resPtr.get())!=PGRES_COMMAND_OK){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            return SQL_Status::BadRequest;
+        }
+    }
+    return SQL_Status::Success;
+}
+
+//Import Users
+SQL_Status PG_Handler::importUsers(const QString &format, const QByteArray &inUsersData, QJsonObject &outReportObject, QString &lastError)
+{
+    QSharedPointer<PGconn> connPtr {makeConn(lastError)};
+    if(!connPtr){
+        return SQL_Status::BadRequest;
+    }
+    QBuffer usersBuffer {};
+    usersBuffer.setData(inUsersData);
+    if(!usersBuffer.open(QIODevice::ReadOnly)){
+        lastError=usersBuffer.errorString();
+        return SQL_Status::BadRequest;
+    }
+    PG_Importer importer {connPtr.get()};
+    if(!importer.importUsers(&usersBuffer,format,outReportObject,lastError)){
+        return SQL_Status::BadRequest;
+    }
+    return SQL_Status::Success;
+}
+
+//Import Hierarchy
+SQL_Status PG_Handler::importHierarchy(const QByteArray &inHierarchyData, QJsonObject &outReportObject, QString &lastError)
+{
+    QSharedPointer<PGconn> connPtr {makeConn(lastError)};
+    if(!connPtr){
+        return SQL_Status::BadRequest;
+    }
+    PG_Importer importer {connPtr.get()};
+    if(!importer.importHierarchy(inHierarchyData,outReportObject,lastError)){
+        return SQL_Status::BadRequest;
+    }
+    return SQL_Status::Success;
+}
@@ -0,0 +1,37 @@
+#ifndef PGHANDLER_H
+#define PGHANDLER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <functional>
+
+#include "SQL_Handler.h"
+#include "libpq-fe.h"
+
+class QSettings;
+
+//Uses libpq directly for COPY streams, which QtSql does not expose
+class PG_Handler
+{
+private:
+    QSharedPointer<QSettings> appSettingsPtr_  {nullptr};
+
+    QSharedPointer<PGconn> makeConn(QString& lastError);
+
+public:
+    using ChunkHandler=std::function<bool(const char* data,int size)>;
+
+    explicit PG_Handler(QSharedPointer<QSettings> appSettingsPtr);
+    ~PG_Handler()=default;
+
+    //Export Objects ('users','roles-permissions','assignments','hierarchy') As NDJSON Or CSV
+    SQL_Status exportObjects(const QString& objectsName,const QString& format,const ChunkHandler& chunkHandler,QString& lastError);
+    //Import Users From NDJSON Or CSV
+    SQL_Status importUsers(const QString& format,const QByteArray& inUsersData,QJsonObject& outReportObject,QString& lastError);
+    //Import Roles/Permissions Hierarchy From JSON
+    SQL_Status importHierarchy(const QByteArray& inHierarchyData,QJsonObject& outReportObject,QString& lastError);
+};
+
+#endif // PGHANDLER_H
@@ -0,0 +1,650 @@
+#include "PG_Importer.h"
+
+#include <QSet>
+#include <QUuid>
+#include <QVector>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSharedPointer>
+
+bool PG_Importer::exec(const QString &queryText, QString &lastError, int *rowCount)
+{
+    QSharedPointer<PGresult> resPtr {PQexec(conn_,queryText.toUtf8().constData()),&PQclear};
+    const ExecStatusType execStatus {PQresultStatus(resPtr.get())};
+    if(execStatus!=PGRES_COMMAND_OK && execStatus!=PGRES_TUPLES_OK){
+        lastError=QString {PQresultErrorMessage(resPtr.get())};
+        return false;
+    }
+    if(rowCount){
+        *rowCount=QByteArray {PQcmdTuples(resPtr.get())}.toInt();
+    }
+    return true;
+}
+
+QSharedPointer<PGresult> PG_Importer::execParams(const QString &queryText, const QStringList &params, QString &lastError)
+{
+    QList<QByteArray> paramDatas {};
+    QVector<const char*> paramValues {};
+    for(const QString& param: params){
+        paramDatas.push_back(param.toUtf8());
+        paramValues.push_back(param.isNull() ? nullptr : paramDatas.last().constData());
+    }
+    QSharedPointer<PGresult> resPtr {PQexecParams(conn_,queryText.toUtf8().constData(),paramValues.size(),
+                                                  nullptr,paramValues.constData(),nullptr,nullptr,0),&PQclear};
+    const ExecStatusType execStatus {PQresultStatus(resPtr.get())};
+    if(execStatus!=PGRES_COMMAND_OK && execStatus!=PGRES_TUPLES_OK){
+        lastError=QString {PQresultErrorMessage(resPtr.get())};
+        return nullptr;
+    }
+    return resPtr;
+}
+
+bool PG_Importer::startCopy(const QString &queryText, QString &lastError)
+{
+    QSharedPointer<PGresult> resPtr {PQexec(conn_,queryText.toUtf8().constData()),&PQclear};
+    if(PQresultStatus(resPtr.get())!=PGRES_COPY_IN){
+        lastError=QString {PQresultErrorMessage(resPtr.get())};
+        return false;
+    }
+    copyBuffer_.clear();
+    return true;
+}
+
+bool PG_Importer::putCopyData(bool isFinal, QString &lastError)
+{
+    const int copyBufferSize {64 * 1024};
+    if(copyBuffer_.size() >= copyBufferSize || (isFinal && !copyBuffer_.isEmpty())){
+        if(PQputCopyData(conn_,copyBuffer_.constData(),copyBuffer_.size())!=1){
+            lastError=QString {PQerrorMessage(conn_)};
+            PQputCopyEnd(conn_,"import aborted");
+            QSharedPointer<PGresult> resPtr {PQgetResult(conn_),&PQclear};
+            return false;
+        }
+        copyBuffer_.clear();
+    }
+    if(!isFinal){
+        return true;
+    }
+    if(PQputCopyEnd(conn_,nullptr)!=1){
+        lastError=QString {PQerrorMessage(conn_)};
+        return false;
+    }
+    QSharedPointer<PGresult> resPtr {PQgetResult(conn_),&PQclear};
+    if(PQresultStatus(resPtr.get())!=PGRES_COMMAND_OK){
+        lastError=QString {PQresultErrorMessage(resPtr.get())};
+        return false;
+    }
+    return true;
+}
+
+void PG_Importer::appendCopyRow(int lineNo, const QStringList &columns, const QHash<QString, QString> &values, const QString &error)
+{
+    copyBuffer_.append(QByteArray::number(lineNo));
+    for(const QString& column: columns){
+        copyBuffer_.append('\t');
+        const auto it {values.find(column)};
+        copyBuffer_.append(it==values.end() ? QByteArray {"\\N"} : escapeCopyValue(it.value()));
+    }
+    copyBuffer_.append('\t');
+    copyBuffer_.append(error.isEmpty() ? QByteArray {"\\N"} : escapeCopyValue(error));
+    copyBuffer_.append('\n');
+}
+
+bool PG_Importer::readRecord(QIODevice *device, const QString &format, int &lineCount, int &recordLineNo, QString &record)
+{
+    record.clear();
+    while(!device->atEnd()){
+        const QString line {QString::fromUtf8(device->readLine())};
+        ++lineCount;
+        if(record.isEmpty()){
+            if(line.trimmed().isEmpty()){
+                continue;
+            }
+            recordLineNo=lineCount;
+        }
+        record+=line;
+        //csv record spans several lines while a quoted field is open
+        if(format=="csv" && (record.count('"') % 2)!=0){
+            continue;
+        }
+        break;
+    }
+    while(record.endsWith('\n') || record.endsWith('\r')){
+        record.chop(1);
+    }
+    return !record.isEmpty();
+}
+
+QStringList PG_Importer::splitCsvRecord(const QString &record)
+{
+    QStringList fields {};
+    QString field {};
+    bool isQuoted {false};
+    for(int i=0;i<record.size();++i){
+        const QChar ch {record.at(i)};
+        if(isQuoted){
+            if(ch=='"'){
+                if(i+1<record.size() && record.at(i+1)=='"'){
+                    field+=ch;
+                    ++i;
+                }
+                else{
+                    isQuoted=false;
+                }
+            }
+            else{
+                field+=ch;
+            }
+        }
+        else if(ch=='"'){
+            isQuoted=true;
+        }
+        else if(ch==','){
+            fields.push_back(field);
+            field.clear();
+        }
+        else{
+            field+=ch;
+        }
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+QByteArray PG_Importer::escapeCopyValue(const QString &value)
+{
+    QByteArray data {value.toUtf8()};
+    data.replace('\\',"\\\\");
+    data.replace('\t',"\\t");
+    data.replace('\n',"\\n");
+    data.replace('\r',"\\r");
+    return data;
+}
+
+QString PG_Importer::arrayLiteral(const QStringList &values)
+{
+    //'{"a","b\"c",NULL}', null strings become sql NULL elements
+    QStringList elements {};
+    for(const QString& value: values){
+        if(value.isNull()){
+            elements.push_back("NULL");
+            continue;
+        }
+        QString element {value};
+        element.replace('\\',"\\\\");
+        element.replace('"',"\\\"");
+        elements.push_back('"' + element + '"');
+    }
+    return '{' + elements.join(',') + '}';
+}
+
+bool PG_Importer::collectHierarchyNode(const QJsonObject &nodeObject, QHash<QString, QJsonObject> &definedNodes,
+                                       QList<QPair<QString, QString>> &edges, QString &lastError)
+{
+    const QString name {nodeObject.value("name").toString()};
+    if(name.isEmpty()){
+        lastError="Not valid node, key: 'name' not present!";
+        return false;
+    }
+    if(name.size() > 50){
+        lastError=QStringLiteral("Not valid node '%1', key: 'name' is longer than 50").arg(name);
+        return false;
+    }
+    //node without 'type' only references a role/permission declared elsewhere or already stored
+    if(nodeObject.contains("type")){
+        const QString type {nodeObject.value("type").toString()};
+        if(type!="role" && type!="permission"){
+            lastError=QStringLiteral("Not valid node '%1', key: 'type' is not 'role' or 'permission'").arg(name);
+            return false;
+        }
+        QJsonObject definedObject {{"type",type}};
+        if(nodeObject.value("description").isString()){
+            definedObject.insert("description",nodeObject.value("description"));
+        }
+        const auto it {definedNodes.find(name)};
+        if(it!=definedNodes.end() && it.value()!=definedObject){
+            lastError=QStringLiteral("Node '%1' is declared twice with different content").arg(name);
+            return false;
+        }
+        definedNodes.insert(name,definedObject);
+    }
+    const QJsonValue childrenValue {nodeObject.value("children")};
+    if(childrenValue.isUndefined()){
+        return true;
+    }
+    if(!childrenValue.isArray()){
+        lastError=QStringLiteral("Not valid node '%1', key: 'children' is not array!").arg(name);
+        return false;
+    }
+    const QJsonArray childObjects {childrenValue.toArray()};
+    for(const QJsonValue& childValue: childObjects){
+        if(!childValue.isObject()){
+            lastError=QStringLiteral("Not valid node '%1', child is not json object!").arg(name);
+            return false;
+        }
+        const QJsonObject childObject {childValue.toObject()};
+        if(!collectHierarchyNode(childObject,definedNodes,edges,lastError)){
+            return false;
+        }
+        edges.push_back(qMakePair(name,childObject.value("name").toString()));
+    }
+    return true;
+}
+
+PG_Importer::PG_Importer(PGconn *conn)
+    :conn_{conn}
+{
+}
+
+//Import Users
+bool PG_Importer::importUsers(QIODevice *device, const QString &format, QJsonObject &outReportObject, QString &lastError)
+{
+    if(format!="ndjson" && format!="csv"){
+        lastError=QStringLiteral("Parameter 'format' incorrect value: %1").arg(format);
+        return false;
+    }
+    const QStringList columns {"id","first_name","last_name","email","is_blocked",
+                               "phone_number","position","gender","location_id","ou_id"};
+    const int maxReportedErrors {1000};
+    bool isImportOk {false};
+    int updatedCount {0};
+    int insertedCount {0};
+
+    if(!exec("BEGIN",lastError)){
+        return false;
+    }
+    {//create staging table
+        const QString queryText {"CREATE TEMP TABLE users_import (line_no integer NOT NULL, id text, first_name text, "
+                                 "last_name text, email text, is_blocked text, phone_number text, position text, "
+                                 "gender text, location_id text, ou_id text, error text, uid uuid) ON COMMIT DROP"};
+        if(!exec(queryText,lastError)){
+            goto end;
+        }
+    }
+    {//copy records into staging table, malformed records are copied with their error
+        const QString queryText {QStringLiteral("COPY users_import (line_no,%1,error) FROM STDIN").arg(columns.join(","))};
+        if(!startCopy(queryText,lastError)){
+            goto end;
+        }
+        int lineCount {0};
+        int recordLineNo {0};
+        QString record {};
+        QStringList csvHeader {};
+        while(readRecord(device,format,lineCount,recordLineNo,record)){
+            QString error {};
+            QHash<QString,QString> values {};
+            if(format=="ndjson"){
+                QJsonParseError parseError {};
+                const QJsonDocument userDocument {QJsonDocument::fromJson(record.toUtf8(),&parseError)};
+                if(parseError.error!=QJsonParseError::NoError || !userDocument.isObject()){
+                    error=QStringLiteral("Not valid json object: %1").arg(parseError.errorString());
+                }
+                else{
+                    const QJsonObject userObject {userDocument.object()};
+                    for(const QString& column: columns){
+                        const QJsonValue value {userObject.value(column)};
+                        if(value.isBool()){
+                            values.insert(column,value.toBool() ? "true" : "false");
+                        }
+                        else if(value.isString()){
+                            values.insert(column,value.toString());
+                        }
+                        else if(value.isDouble()){
+                            values.insert(column,QString::number(value.toDouble()));
+                        }
+                    }
+                }
+            }
+            else{
+                const QStringList fields {splitCsvRecord(record)};
+                if(csvHeader.isEmpty()){
+                    for(const QString& field: fields){
+                        csvHeader.push_back(field.trimmed());
+                    }
+                    continue;
+                }
+                if(fields.size()!=csvHeader.size()){
+                    error=QStringLiteral("Expected %1 fields, got %2").arg(csvHeader.size()).arg(fields.size());
+                }
+                else{
+                    for(int i=0;i<fields.size();++i){
+                        if(columns.contains(csvHeader.at(i)) && !fields.at(i).isEmpty()){
+                            values.insert(csvHeader.at(i),fields.at(i));
+                        }
+                    }
+                }
+            }
+            appendCopyRow(recordLineNo,columns,values,error);
+            if(!putCopyData(false,lastError)){
+                goto end;
+            }
+        }
+        if(!putCopyData(true,lastError)){
+            goto end;
+        }
+    }
+    {//validate staging rows, every statement only looks at rows without error yet
+        const QString uuidPattern {"'^[0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12}$'"};
+        const QStringList queryTexts {
+            "UPDATE users_import SET error='Key: ''id'' is not valid uuid' WHERE error IS NULL AND (id IS NULL OR id !~* " + uuidPattern + ")",
+            "UPDATE users_import SET error='Key: ''location_id'' is not valid uuid' WHERE error IS NULL AND (location_id IS NULL OR location_id !~* " + uuidPattern + ")",
+            "UPDATE users_import SET error='Key: ''ou_id'' is not valid uuid' WHERE error IS NULL AND (ou_id IS NULL OR ou_id !~* " + uuidPattern + ")",
+            "UPDATE users_import SET error='Key: ''email'' not present' WHERE error IS NULL AND email IS NULL",
+            "UPDATE users_import SET error='Key: ''email'' is longer than 60' WHERE error IS NULL AND char_length(email) > 60",
+            "UPDATE users_import SET error='Key: ''first_name'' is longer than 20' WHERE error IS NULL AND char_length(first_name) > 20",
+            "UPDATE users_import SET error='Key: ''last_name'' is longer than 20' WHERE error IS NULL AND char_length(last_name) > 20",
+            "UPDATE users_import SET error='Key: ''gender'' is not ''male'' or ''female''' WHERE error IS NULL AND gender NOT IN ('male','female')",
+            "UPDATE users_import SET error='Key: ''is_blocked'' is not valid boolean' WHERE error IS NULL AND lower(is_blocked) NOT IN ('true','false','t','f','1','0')",
+            "UPDATE users_import s SET error='Duplicate ''id'', first seen at line ' || d.first_line FROM "
+            "(SELECT line_no, min(line_no) OVER (PARTITION BY lower(id)) AS first_line FROM users_import WHERE error IS NULL) d "
+            "WHERE s.line_no=d.line_no AND d.line_no<>d.first_line",
+            "UPDATE users_import s SET error='Duplicate ''email'', first seen at line ' || d.first_line FROM "
+            "(SELECT line_no, min(line_no) OVER (PARTITION BY email) AS first_line FROM users_import WHERE error IS NULL) d "
+            "WHERE s.line_no=d.line_no AND d.line_no<>d.first_line"
+        };
+        for(const QString& queryText: queryTexts){
+            if(!exec(queryText,lastError)){
+                goto end;
+            }
+        }
+    }
+    {//an email is free if its user gives it up in this import ('users_email_key' is checked at commit),
+     //a rejected row keeps its user's email, so rows are rejected until none is left
+        const QString queryText {"UPDATE users_import s SET error='Key: ''email'' already used by another user' FROM users u "
+                                 "WHERE s.error IS NULL AND u.email=s.email AND u.id::text<>lower(s.id) "
+                                 "AND NOT EXISTS (SELECT 1 FROM users_import o WHERE o.error IS NULL "
+                                 "AND lower(o.id)=u.id::text AND o.email<>u.email)"};
+        int rejectedCount {0};
+        do{
+            if(!exec(queryText,lastError,&rejectedCount)){
+                goto end;
+            }
+        }while(rejectedCount > 0);
+        if(!exec("UPDATE users_import SET uid=id::uuid WHERE error IS NULL",lastError)){
+            goto end;
+        }
+    }
+    {//merge, keys missing in a record keep the stored value of an existing user
+        const QString queryText {"UPDATE users u SET updated_at=now(), email=s.email, "
+                                 "first_name=COALESCE(s.first_name,u.first_name), last_name=COALESCE(s.last_name,u.last_name), "
+                                 "is_blocked=COALESCE(s.is_blocked::boolean,u.is_blocked), phone_number=COALESCE(s.phone_number,u.phone_number), "
+                                 "position=COALESCE(s.position,u.position), gender=COALESCE(s.gender::gender,u.gender), "
+                                 "location_id=s.location_id::uuid, ou_id=s.ou_id::uuid "
+                                 "FROM users_import s WHERE s.uid IS NOT NULL AND u.id=s.uid"};
+        if(!exec(queryText,lastError,&updatedCount)){
+            goto end;
+        }
+    }
+    {//a deferrable constraint can not be an arbiter, so only 'id' is named
+        const QString queryText {"INSERT INTO users (id,created_at,updated_at,first_name,last_name,email,is_blocked,"
+                                 "phone_number,position,gender,location_id,ou_id) "
+                                 "SELECT s.uid, now(), now(), s.first_name, s.last_name, s.email, COALESCE(s.is_blocked::boolean,false), "
+                                 "s.phone_number, s.position, s.gender::gender, s.location_id::uuid, s.ou_id::uuid "
+                                 "FROM users_import s WHERE s.uid IS NOT NULL AND NOT EXISTS (SELECT 1 FROM users u WHERE u.id=s.uid) "
+                                 "ON CONFLICT (id) DO NOTHING"};
+        if(!exec(queryText,lastError,&insertedCount)){
+            goto end;
+        }
+    }
+    {//report
+        QSharedPointer<PGresult> resPtr {PQexec(conn_,"SELECT count(*), count(error) FROM users_import"),&PQclear};
+        if(PQresultStatus(resPtr.get())!=PGRES_TUPLES_OK){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            goto end;
+        }
+        const int totalCount {QByteArray {PQgetvalue(resPtr.get(),0,0)}.toInt()};
+        const int failedCount {QByteArray {PQgetvalue(resPtr.get(),0,1)}.toInt()};
+
+        const QString queryText {QStringLiteral("SELECT line_no, error FROM users_import WHERE error IS NOT NULL "
+                                                "ORDER BY line_no LIMIT %1").arg(maxReportedErrors)};
+        resPtr.reset(PQexec(conn_,queryText.toUtf8().constData()),&PQclear);
+        if(PQresultStatus(resPtr.get())!=PGRES_TUPLES_OK){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            goto end;
+        }
+        QJsonArray errorObjects {};
+        const int rowCount {PQntuples(resPtr.get())};
+        for(int i=0;i<rowCount;++i){
+            errorObjects.push_back(QJsonObject {
+                {"line",QByteArray {PQgetvalue(resPtr.get(),i,0)}.toInt()},
+                {"error",QString::fromUtf8(PQgetvalue(resPtr.get(),i,1))}
+            });
+        }
+        outReportObject.insert("total",totalCount);
+        outReportObject.insert("inserted",insertedCount);
+        outReportObject.insert("updated",updatedCount);
+        outReportObject.insert("failed",failedCount);
+        outReportObject.insert("errors",errorObjects);
+        if(failedCount > rowCount){
+            outReportObject.insert("errors_truncated",true);
+        }
+    }
+    if(!exec("COMMIT",lastError)){
+        goto end;
+    }
+    isImportOk=true;
+end:
+    if(!isImportOk){
+        QString rollbackError {};
+        exec("ROLLBACK",rollbackError);
+    }
+    return isImportOk;
+}
+
+//Import Hierarchy
+bool PG_Importer::importHierarchy(const QByteArray &hierarchyData, QJsonObject &outReportObject, QString &lastError)
+{
+    QHash<QString,QJsonObject> definedNodes {};
+    QList<QPair<QString,QString>> edges {};
+    {//parse, accepts '[nodes]', '{node}' or '{"nodes":[...],"edges":[{"parent":..,"child":..}]}'
+        QJsonParseError parseError {};
+        const QJsonDocument hierarchyDocument {QJsonDocument::fromJson(hierarchyData,&parseError)};
+        if(parseError.error!=QJsonParseError::NoError){
+            lastError=QStringLiteral("Not valid json: %1").arg(parseError.errorString());
+            return false;
+        }
+        QJsonArray nodeValues {};
+        QJsonArray edgeValues {};
+        if(hierarchyDocument.isArray()){
+            nodeValues=hierarchyDocument.array();
+        }
+        else if(hierarchyDocument.object().contains("name")){
+            nodeValues.push_back(hierarchyDocument.object());
+        }
+        else{
+            nodeValues=hierarchyDocument.object().value("nodes").toArray();
+            edgeValues=hierarchyDocument.object().value("edges").toArray();
+        }
+        for(const QJsonValue& nodeValue: nodeValues){
+            if(!collectHierarchyNode(nodeValue.toObject(),definedNodes,edges,lastError)){
+                return false;
+            }
+        }
+        for(const QJsonValue& edgeValue: edgeValues){
+            const QString parentName {edgeValue.toObject().value("parent").toString()};
+            const QString childName {edgeValue.toObject().value("child").toString()};
+            if(parentName.isEmpty() || childName.isEmpty()){
+                lastError="Not valid edge, keys: 'parent' and 'child' must be present!";
+                return false;
+            }
+            edges.push_back(qMakePair(parentName,childName));
+        }
+    }
+    QStringList names {definedNodes.keys()};
+    for(const auto& edge: edges){
+        names.push_back(edge.first);
+        names.push_back(edge.second);
+    }
+    names.removeDuplicates();
+    if(names.isEmpty()){
+        lastError="Nothing to import";
+        return false;
+    }
+
+    bool isImportOk {false};
+    int createdEdgeCount {0};
+    QHash<QString,QString> nameIds {};
+    QStringList createdNames {};
+    QList<QPair<QString,QString>> edgeIds {};
+
+    if(!exec("BEGIN",lastError)){
+        return false;
+    }
+    {//edges written concurrently could close a cycle this import does not see
+        if(!exec("LOCK TABLE roles_permissions_relationship IN SHARE ROW EXCLUSIVE MODE",lastError)){
+            goto end;
+        }
+    }
+    {//resolve names already stored
+        const QString queryText {"SELECT name, id, type FROM roles_permissions WHERE name=ANY($1::text[])"};
+        QSharedPointer<PGresult> resPtr {execParams(queryText,{arrayLiteral(names)},lastError)};
+        if(!resPtr){
+            goto end;
+        }
+        const int rowCount {PQntuples(resPtr.get())};
+        for(int i=0;i<rowCount;++i){
+            const QString name {QString::fromUtf8(PQgetvalue(resPtr.get(),i,0))};
+            const QString type {QString::fromUtf8(PQgetvalue(resPtr.get(),i,2))};
+            const auto it {definedNodes.find(name)};
+            if(it!=definedNodes.end() && it.value().value("type").toString()!=type){
+                lastError=QStringLiteral("Role/Permission '%1' already exists with type '%2'").arg(name,type);
+                goto end;
+            }
+            nameIds.insert(name,QString::fromUtf8(PQgetvalue(resPtr.get(),i,1)));
+        }
+    }
+    {//assign ids to new nodes, same namespace as single create
+        const QString usystemNamespace {"6ba7b810-9dad-11d1-80b4-00c04fd430c8"};
+        for(const QString& name: names){
+            if(nameIds.contains(name)){
+                continue;
+            }
+            if(!definedNodes.contains(name)){
+                lastError=QStringLiteral("Role/Permission '%1' not found and not declared with 'type'").arg(name);
+                goto end;
+            }
+            nameIds.insert(name,QUuid::createUuidV5(QUuid::createUuid(),usystemNamespace).toString(QUuid::WithoutBraces));
+            createdNames.push_back(name);
+        }
+        QSet<QString> edgeKeys {};
+        for(const auto& edge: edges){
+            const QString parentId {nameIds.value(edge.first)};
+            const QString childId {nameIds.value(edge.second)};
+            if(!edgeKeys.contains(parentId + childId)){
+                edgeKeys.insert(parentId + childId);
+                edgeIds.push_back(qMakePair(parentId,childId));
+            }
+        }
+    }
+    {//detect cycles on stored plus imported edges
+        QHash<QString,QStringList> childIds {};
+        {
+            QSharedPointer<PGresult> resPtr {execParams("SELECT parent_id, child_id FROM roles_permissions_relationship",{},lastError)};
+            if(!resPtr){
+                goto end;
+            }
+            const int rowCount {PQntuples(resPtr.get())};
+            for(int i=0;i<rowCount;++i){
+                childIds[QString::fromUtf8(PQgetvalue(resPtr.get(),i,0))].push_back(QString::fromUtf8(PQgetvalue(resPtr.get(),i,1)));
+            }
+        }
+        for(const auto& edgeId: edgeIds){
+            childIds[edgeId.first].push_back(edgeId.second);
+        }
+        QHash<QString,QString> idNames {};
+        for(auto it=nameIds.begin();it!=nameIds.end();++it){
+            idNames.insert(it.value(),it.key());
+        }
+        //iterative dfs, a child met while still on the stack closes a cycle
+        enum class VisitState{NotVisited,OnStack,Done};
+        QHash<QString,VisitState> visitStates {};
+        for(const auto& edgeId: edgeIds){
+            if(visitStates.value(edgeId.first,VisitState::NotVisited)!=VisitState::NotVisited){
+                continue;
+            }
+            QVector<QPair<QString,int>> stack {qMakePair(edgeId.first,0)};
+            visitStates.insert(edgeId.first,VisitState::OnStack);
+            while(!stack.isEmpty()){
+                const QString nodeId {stack.last().first};
+                const QStringList nodeChildIds {childIds.value(nodeId)};
+                if(stack.last().second >= nodeChildIds.size()){
+                    visitStates.insert(nodeId,VisitState::Done);
+                    stack.removeLast();
+                    continue;
+                }
+                const QString childId {nodeChildIds.at(stack.last().second++)};
+                const VisitState childState {visitStates.value(childId,VisitState::NotVisited)};
+                if(childState==VisitState::OnStack){
+                    QStringList cycleNames {};
+                    bool isInCycle {false};
+                    for(const auto& entry: stack){
+                        isInCycle=isInCycle || entry.first==childId;
+                        if(isInCycle){
+                            cycleNames.push_back(idNames.value(entry.first,entry.first));
+                        }
+                    }
+                    cycleNames.push_back(idNames.value(childId,childId));
+                    lastError=QStringLiteral("Cycle detected: %1").arg(cycleNames.join(" -> "));
+                    goto end;
+                }
+                if(childState==VisitState::NotVisited){
+                    visitStates.insert(childId,VisitState::OnStack);
+                    stack.push_back(qMakePair(childId,0));
+                }
+            }
+        }
+    }
+    if(!createdNames.isEmpty()){//create nodes
+        QStringList ids {};
+        QStringList types {};
+        QStringList descriptions {};
+        for(const QString& name: createdNames){
+            const QJsonObject definedObject {definedNodes.value(name)};
+            ids.push_back(nameIds.value(name));
+            types.push_back(definedObject.value("type").toString());
+            descriptions.push_back(definedObject.contains("description") ? definedObject.value("description").toString() : QString {});
+        }
+        const QString queryText {"INSERT INTO roles_permissions (id,name,type,description) "
+                                 "SELECT * FROM unnest($1::uuid[],$2::text[],$3::rolepermissiontype[],$4::text[])"};
+        if(!execParams(queryText,{arrayLiteral(ids),arrayLiteral(createdNames),arrayLiteral(types),arrayLiteral(descriptions)},lastError)){
+            goto end;
+        }
+    }
+    if(!edgeIds.isEmpty()){//create edges, already stored ones are kept
+        QStringList parentIds {};
+        QStringList childIds {};
+        for(const auto& edgeId: edgeIds){
+            parentIds.push_back(edgeId.first);
+            childIds.push_back(edgeId.second);
+        }
+        const QString queryText {"INSERT INTO roles_permissions_relationship (created_at,parent_id,child_id) "
+                                 "SELECT now(), t.parent_id, t.child_id FROM unnest($1::uuid[],$2::uuid[]) AS t(parent_id,child_id) "
+                                 "ON CONFLICT DO NOTHING"};
+        QSharedPointer<PGresult> resPtr {execParams(queryText,{arrayLiteral(parentIds),arrayLiteral(childIds)},lastError)};
+        if(!resPtr){
+            goto end;
+        }
+        createdEdgeCount=QByteArray {PQcmdTuples(resPtr.get())}.toInt();
+    }
+    if(!exec("COMMIT",lastError)){
+        goto end;
+    }
+    {//report
+        QJsonObject idsObject {};
+        for(auto it=nameIds.begin();it!=nameIds.end();++it){
+            idsObject.insert(it.key(),it.value());
+        }
+        outReportObject.insert("created",createdNames.size());
+        outReportObject.insert("existing",nameIds.size() - createdNames.size());
+        outReportObject.insert("edges_created",createdEdgeCount);
+        outReportObject.insert("ids",idsObject);
+    }
+    isImportOk=true;
+end:
+    if(!isImportOk){
+        QString rollbackError {};
+        exec("ROLLBACK",rollbackError);
+    }
+    return isImportOk;
+}
@@ -0,0 +1,48 @@
+#ifndef PGIMPORTER_H
+#define PGIMPORTER_H
+
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QJsonObject>
+#include <QStringList>
+#include <QSharedPointer>
+
+#include "libpq-fe.h"
+
+class QIODevice;
+
+//Bulk loader shared by uaServer and uaShell, works on an opened libpq connection.
+//Rows are streamed with COPY FROM STDIN into a temporary staging table, validated
+//and merged with set-based statements, so bad rows are reported instead of
+//aborting the whole batch.
+class PG_Importer
+{
+private:
+    PGconn* conn_ {nullptr};
+    QByteArray copyBuffer_ {};
+
+    bool exec(const QString& queryText,QString& lastError,int* rowCount=nullptr);
+    QSharedPointer<PGresult> execParams(const QString& queryText,const QStringList& params,QString& lastError);
+    bool startCopy(const QString& queryText,QString& lastError);
+    bool putCopyData(bool isFinal,QString& lastError);
+    void appendCopyRow(int lineNo,const QStringList& columns,const QHash<QString,QString>& values,const QString& error);
+
+    static bool readRecord(QIODevice* device,const QString& format,int& lineCount,int& recordLineNo,QString& record);
+    static QStringList splitCsvRecord(const QString& record);
+    static QByteArray escapeCopyValue(const QString& value);
+    static QString arrayLiteral(const QStringList& values);
+    static bool collectHierarchyNode(const QJsonObject& nodeObject,QHash<QString,QJsonObject>& definedNodes,
+                                     QList<QPair<QString,QString>>& edges,QString& lastError);
+
+public:
+    explicit PG_Importer(PGconn* conn);
+    ~PG_Importer()=default;
+
+    //Import Users From NDJSON Or CSV Stream
+    bool importUsers(QIODevice* device,const QString& format,QJsonObject& outReportObject,QString& lastError);
+    //Import Roles/Permissions And Parent/Child Edges From JSON Tree Or Node/Edge Lists
+    bool importHierarchy(const QByteArray& hierarchyData,QJsonObject& outReportObject,QString& lastError);
+};
+
+#endif // PGIMPORTER_H
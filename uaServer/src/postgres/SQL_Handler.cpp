@@ -1,8 +1,14 @@
 #include "SQL_Handler.h"
+#include "../authz/PolicySnapshot.h"
+#include "../authz/AssignmentIndex.h"
+#include "../authz/DecisionCache.h"
+#include "../authz/PolicyCache.h"
 
+#include <QHash>
 #include <QUuid>
 #include <QDebug>
 #include <QDateTime>
+#include <QJsonDocument>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QSettings>
@@ -13,6 +19,15 @@
 #include <QRegularExpression>
 #include <algorithm>
 
+namespace{
+//'UAuthAdmin' and every role/permission above it, holding any of them makes a superuser
+const QString uauthAdminIdsCte {"WITH RECURSIVE admin_ids(id) AS ("
+                                "SELECT id FROM roles_permissions WHERE name = 'UAuthAdmin' "
+                                "UNION "
+                                "SELECT rpr.parent_id FROM roles_permissions_relationship rpr "
+                                "JOIN admin_ids a ON rpr.child_id = a.id) "};
+}
+
 QString SQL_Handler::timeWithTimezone()
 {
     QDateTime currentDateTime {QDateTime::currentDateTime()};
@@ -99,31 +114,50 @@ bool SQL_Handler::checkRolePermById(const QSqlDatabase &dataBase, const QString
     return false;
 }
 
+SQL_Status SQL_Handler::checkDecisionCache(const QString &userId, const QString &rolePermIdent, const std::function<SQL_Status (QString &)> &computeHandler, QString &lastError)
+{
+    if(!decisionCachePtr_ || !decisionCachePtr_->isEnabled()){
+        return computeHandler(lastError);
+    }
+    //stamp is taken before computing, a write landing meanwhile makes the entry stale
+    const DecisionCache::Stamp stamp {decisionCachePtr_->stamp(userId)};
+    bool isAllowed {false};
+    if(decisionCachePtr_->lookup(userId,rolePermIdent,stamp,isAllowed)){
+        return isAllowed ? SQL_Status::Success : SQL_Status::Unauthorized;
+    }
+    QString computeError {};
+    const SQL_Status sqlStatus {computeHandler(computeError)};
+    //failed queries are not decisions, only definite answers are kept
+    if(!computeError.isEmpty()){
+        lastError=computeError;
+        return sqlStatus;
+    }
+    if(sqlStatus==SQL_Status::Success || sqlStatus==SQL_Status::Unauthorized){
+        decisionCachePtr_->insert(userId,rolePermIdent,stamp,sqlStatus==SQL_Status::Success);
+    }
+    return sqlStatus;
+}
+
 SQL_Status SQL_Handler::checkIsAuthorized(const QSqlDatabase &dataBase, const QString &userId, const QString &rolePermIdent, QString &lastError)
+{
+    return checkDecisionCache(userId,rolePermIdent,[&](QString& computeError){
+        return computeIsAuthorized(dataBase,userId,rolePermIdent,computeError);
+    },lastError);
+}
+
+SQL_Status SQL_Handler::computeIsAuthorized(const QSqlDatabase &dataBase, const QString &userId, const QString &rolePermIdent, QString &lastError)
 {
     SQL_Status sqlStatus {SQL_Status::Unauthorized};
     QStringList userIdRolePermIdList {};
     {//check if uauthadmin
-        const QString queryText {"SELECT name FROM roles_permissions WHERE id IN (SELECT role_permission_id FROM users_roles_permissions WHERE user_id=:userId)"};
-        QSqlQuery sqlQuery {dataBase};
-        if(!sqlQuery.prepare(queryText)){
-            lastError=sqlQuery.lastError().text();
+        const bool isUAuthAdmin {checkIsUAuthAdmin(dataBase,userId,lastError)};
+        if(!lastError.isEmpty()){
             goto end;
         }
-        sqlQuery.bindValue(":userId",userId);
-
-        if(!sqlQuery.exec()){
-            lastError=sqlQuery.lastError().text();
+        if(isUAuthAdmin){
+            sqlStatus=SQL_Status::Success;
             goto end;
         }
-        while(sqlQuery.next()){
-            const QString uauthAdminName {"UAuthAdmin"};
-            const QString nameText {sqlQuery.value("name").toString()};
-            if(uauthAdminName==nameText){
-                sqlStatus=SQL_Status::Success;
-                goto end;
-            }
-        }
     }
     {//get tot-level 'id' from users_roles_permissions
         const QString queryText {"SELECT role_permission_id FROM users_roles_permissions WHERE user_id=:userId"};
@@ -157,23 +191,7 @@ SQL_Status SQL_Handler::checkIsAuthorized(const QSqlDatabase &dataBase, const QS
             goto end;
         }
         else{
-            QStringList rolePermNameList {rolePermIdent.split(" ")};
-            std::transform(rolePermNameList.begin(),rolePermNameList.end(),rolePermNameList.begin(),[](const QString& rolePermName){
-                return QStringLiteral("'%1'").arg(rolePermName);
-            });
-            QStringList rolePermIdList {};
-            QString queryText {QStringLiteral("SELECT id FROM roles_permissions WHERE name IN (%1)").arg(rolePermNameList.join(","))};
-            QSqlQuery sqlQuery {dataBase};
-            if(!sqlQuery.prepare(queryText)){
-                lastError=sqlQuery.lastError().text();
-                goto end;
-            }
-            if(sqlQuery.exec()){
-                while(sqlQuery.next()){
-                    const QString rolePermId {sqlQuery.value(0).toString()};
-                    rolePermIdList.push_back(rolePermId);
-                }
-            }
+            const QStringList rolePermIdList {getRolePermIdsByNames(dataBase,rolePermIdent.split(" "),lastError)};
             if(rolePermIdList.isEmpty()){
                 sqlStatus=SQL_Status::Unauthorized;
                 goto end;
@@ -189,6 +207,73 @@ end:
     return sqlStatus;
 }
 
+QSharedPointer<const PolicySnapshot> SQL_Handler::getPolicyMirror()
+{
+    if(!policyCachePtr_){
+        return nullptr;
+    }
+    //a failed reload is not an error here, callers fall back to sql
+    QString cacheError {};
+    return policyCachePtr_->snapshot(*this,cacheError);
+}
+
+bool SQL_Handler::checkIsUAuthAdmin(const QSqlDatabase &dataBase, const QString &userId, QString &lastError)
+{
+    if(policyCachePtr_){
+        QString cacheError {};
+        const QSharedPointer<const QSet<QString>> superuserIdsPtr {policyCachePtr_->superuserIds(*this,cacheError)};
+        if(superuserIdsPtr){
+            return superuserIdsPtr->contains(userId.toLower());
+        }
+    }
+    //same holders as the cached set, direct ones and those of any role above 'UAuthAdmin'
+    const QString queryText {uauthAdminIdsCte + "SELECT EXISTS (SELECT 1 FROM users_roles_permissions "
+                                                "WHERE user_id=:userId AND role_permission_id IN (SELECT id FROM admin_ids))"};
+    QSqlQuery sqlQuery {dataBase};
+    if(!sqlQuery.prepare(queryText)){
+        lastError=sqlQuery.lastError().text();
+        return false;
+    }
+    sqlQuery.bindValue(":userId",userId);
+
+    if(!sqlQuery.exec() || !sqlQuery.next()){
+        lastError=sqlQuery.lastError().text();
+        return false;
+    }
+    return sqlQuery.value(0).toBool();
+}
+
+QStringList SQL_Handler::getRolePermIdsByNames(const QSqlDatabase &dataBase, const QStringList &rolePermNames, QString &lastError)
+{
+    //unknown names are skipped, as with 'name IN (...)'
+    const QSharedPointer<const PolicySnapshot> snapshotPtr {getPolicyMirror()};
+    if(snapshotPtr){
+        return snapshotPtr->idsByNames(rolePermNames);
+    }
+    QStringList rolePermIds {};
+    QStringList placeholders {};
+    for(int i=0;i<rolePermNames.size();++i){
+        placeholders.push_back(QStringLiteral(":name%1").arg(i));
+    }
+    const QString queryText {QStringLiteral("SELECT id FROM roles_permissions WHERE name IN (%1)").arg(placeholders.join(","))};
+    QSqlQuery sqlQuery {dataBase};
+    if(!sqlQuery.prepare(queryText)){
+        lastError=sqlQuery.lastError().text();
+        return rolePermIds;
+    }
+    for(int i=0;i<rolePermNames.size();++i){
+        sqlQuery.bindValue(placeholders.at(i),rolePermNames.at(i));
+    }
+    if(!sqlQuery.exec()){
+        lastError=sqlQuery.lastError().text();
+        return rolePermIds;
+    }
+    while(sqlQuery.next()){
+        rolePermIds.push_back(sqlQuery.value(0).toString());
+    }
+    return rolePermIds;
+}
+
 int SQL_Handler::getTotalUserRolePermsByUserId(const QSqlDatabase &dataBase, const QString &userId, QString &lastError)
 {
     const QString queryText {"SELECT COUNT(*) FROM users_roles_permissions WHERE user_id=:userId"};
@@ -343,6 +428,16 @@ SQL_Handler::SQL_Handler(QSharedPointer<QSettings> appSettingsPtr)
 {
 }
 
+void SQL_Handler::setDecisionCache(QSharedPointer<DecisionCache> decisionCachePtr)
+{
+    decisionCachePtr_=decisionCachePtr;
+}
+
+void SQL_Handler::setPolicyCache(QSharedPointer<PolicyCache> policyCachePtr)
+{
+    policyCachePtr_=policyCachePtr;
+}
+
 //Get Users
 SQL_Status SQL_Handler::getUsersObject(const QMap<QString, QString> &queryMap, const QString &requesterId, QJsonObject &outUsersObject, QString &lastError)
 {
@@ -814,6 +909,27 @@ end:
 //Get RolePermissions
 SQL_Status SQL_Handler::getRolePermsObject(const QMap<QString, QString> &queryMap, const QString &requesterId, QJsonObject &outRolePermsObject, QString &lastError)
 {
+    {//serve from mirror
+        const QSharedPointer<const PolicySnapshot> snapshotPtr {getPolicyMirror()};
+        if(snapshotPtr){
+            if(getAuthzCheck(requesterId,"role_permission:read",lastError)!=SQL_Status::Success){
+                return SQL_Status::Unauthorized;
+            }
+            const int queryLimit {queryMap.contains("limit") ? queryMap.value("limit").toInt() : 100};
+            const int queryOffset {queryMap.contains("offset") ? queryMap.value("offset").toInt() : 0};
+            if(queryLimit < 0 || queryOffset < 0){
+                lastError=QStringLiteral("Parameters 'limit'/'offset' incorrect values: %1/%2").arg(queryLimit).arg(queryOffset);
+                return SQL_Status::BadRequest;
+            }
+            const QJsonArray rolePermObjects {snapshotPtr->rolePermObjects(queryMap.value("name"),queryMap.value("type"),queryLimit,queryOffset)};
+            outRolePermsObject.insert("limit",queryLimit);
+            outRolePermsObject.insert("offset",queryOffset);
+            outRolePermsObject.insert("count",rolePermObjects.size());
+            outRolePermsObject.insert("total",snapshotPtr->orderedIds.size());
+            outRolePermsObject.insert("items",rolePermObjects);
+            return SQL_Status::Success;
+        }
+    }
     SQL_Status sqlStatus {SQL_Status::BadRequest};
     const QString driverName {"QPSQL"};
     const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
@@ -936,6 +1052,16 @@ SQL_Status SQL_Handler::getRolePermsObject(const QMap<QString, QString> &queryMa
 //Get RolePermission
 SQL_Status SQL_Handler::getRolePermObject(const QString &rolePermId, const QString &requesterId, QJsonObject &outRolePermObject, QString &lastError)
 {
+    {//serve from mirror
+        const QSharedPointer<const PolicySnapshot> snapshotPtr {getPolicyMirror()};
+        if(snapshotPtr){
+            if(getAuthzCheck(requesterId,"role_permission:read",lastError)!=SQL_Status::Success){
+                return SQL_Status::Unauthorized;
+            }
+            outRolePermObject=snapshotPtr->rolePermObject(rolePermId);
+            return outRolePermObject.isEmpty() ? SQL_Status::NotFound : SQL_Status::Success;
+        }
+    }
     SQL_Status sqlStatus {SQL_Status::BadRequest};
     const QString driverName {"QPSQL"};
     const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
@@ -1328,12 +1454,55 @@ SQL_Status SQL_Handler::putRolePermChild(const QString &parentRolePermId, const
                 goto end;
             }
         }
+        if(!dataBase.transaction()){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//lock hierarchy, so concurrent add-child calls are checked against each other's edges
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.exec("LOCK TABLE roles_permissions_relationship IN SHARE ROW EXCLUSIVE MODE")){
+                lastError=sqlQuery.lastError().text();
+                dataBase.rollback();
+                goto end;
+            }
+        }
+        {//check cycle and depth on in-memory copy of hierarchy read under lock
+            PolicySnapshot hierarchy {};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.exec("SELECT parent_id,child_id FROM roles_permissions_relationship")){
+                lastError=sqlQuery.lastError().text();
+                dataBase.rollback();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                const QString parentId {sqlQuery.value(0).toString()};
+                const QString childId {sqlQuery.value(1).toString()};
+                hierarchy.childIds[parentId].push_back(childId);
+                hierarchy.parentIds[childId].push_back(parentId);
+            }
+            if(hierarchy.isReachable(childRolePermId,parentRolePermId)){
+                lastError=QString("Role/Permission with id: '%1' is already a descendant of '%2', edge would create a cycle!").arg(parentRolePermId,childRolePermId);
+                sqlStatus=SQL_Status::Conflict;
+                dataBase.rollback();
+                goto end;
+            }
+            const int maxDepth {appSettingsPtr_->value("UA_HIERARCHY_MAX_DEPTH",32).toInt()};
+            const int depth {hierarchy.depthAbove(parentRolePermId) + 1 + hierarchy.depthBelow(childRolePermId)};
+            if(maxDepth > 0 && depth > maxDepth){
+                lastError=QString("Hierarchy depth: %1 would exceed maximum depth: %2!").arg(depth).arg(maxDepth);
+                sqlStatus=SQL_Status::UnprocessableEntity;
+                dataBase.rollback();
+                goto end;
+            }
+        }
         {//create
             const QString createdAt {timeWithTimezone()};
             const QString queryText {"INSERT INTO roles_permissions_relationship (created_at,parent_id,child_id) VALUES(:createdAt,:parentRolePermId,:childRolePermId)"};
             QSqlQuery sqlQuery {dataBase};
             if(!sqlQuery.prepare(queryText)){
                 lastError=sqlQuery.lastError().text();
+                dataBase.rollback();
                 goto end;
             }
             sqlQuery.bindValue(":createdAt",createdAt);
@@ -1342,6 +1511,11 @@ SQL_Status SQL_Handler::putRolePermChild(const QString &parentRolePermId, const
 
             if(!sqlQuery.exec()){
                 lastError=sqlQuery.lastError().text();
+                dataBase.rollback();
+                goto end;
+            }
+            if(!dataBase.commit()){
+                lastError=dataBase.lastError().text();
                 goto end;
             }
         }
@@ -1674,6 +1848,16 @@ end:
 //Get RolePermission Details
 SQL_Status SQL_Handler::getRolePermDetailObject(const QString &rolePermId, const QString &requesterId, QJsonObject &outRolePermObject, QString &lastError)
 {
+    {//serve from mirror
+        const QSharedPointer<const PolicySnapshot> snapshotPtr {getPolicyMirror()};
+        if(snapshotPtr){
+            if(getAuthzCheck(requesterId,"role_permission:read",lastError)!=SQL_Status::Success){
+                return SQL_Status::Unauthorized;
+            }
+            outRolePermObject=snapshotPtr->rolePermDetailObject(rolePermId);
+            return outRolePermObject.isEmpty() ? SQL_Status::NotFound : SQL_Status::Success;
+        }
+    }
     SQL_Status sqlStatus {SQL_Status::BadRequest};
     const QString driverName {"QPSQL"};
     const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
@@ -1737,6 +1921,21 @@ end:
 
 //Check That User Authorized variant_new
 SQL_Status SQL_Handler::getAuthzCheck(const QMap<QString, QString> &queryMap, QString &lastError)
+{
+    //'rp_id'/'rp_name' are tagged, so they never share cache entries with plain idents
+    QStringList rolePermIdents {};
+    std::map<QString,QString> localQueryMap {queryMap.toStdMap()};
+    for(const std::pair<QString,QString>& pair: localQueryMap){
+        if(pair.first=="rp_id" || pair.first=="rp_name"){
+            rolePermIdents.push_back(QStringLiteral("?%1=%2").arg(pair.first,pair.second));
+        }
+    }
+    return checkDecisionCache(queryMap.value("user_id"),rolePermIdents.join(" "),[&](QString& computeError){
+        return computeAuthzCheck(queryMap,computeError);
+    },lastError);
+}
+
+SQL_Status SQL_Handler::computeAuthzCheck(const QMap<QString, QString> &queryMap, QString &lastError)
 {
     SQL_Status sqlStatus {SQL_Status::BadRequest};
     const QString driverName {"QPSQL"};
@@ -1755,26 +1954,14 @@ SQL_Status SQL_Handler::getAuthzCheck(const QMap<QString, QString> &queryMap, QS
         }
         const QString userId {queryMap.value("user_id")};
         {//check if uauthadmin
-            const QString queryText {"SELECT name FROM roles_permissions WHERE id IN (SELECT role_permission_id FROM users_roles_permissions WHERE user_id=:userId)"};
-            QSqlQuery sqlQuery {dataBase};
-            if(!sqlQuery.prepare(queryText)){
-                lastError=sqlQuery.lastError().text();
+            const bool isUAuthAdmin {checkIsUAuthAdmin(dataBase,userId,lastError)};
+            if(!lastError.isEmpty()){
                 goto end;
             }
-            sqlQuery.bindValue(":userId",userId);
-
-            if(!sqlQuery.exec()){
-                lastError=sqlQuery.lastError().text();
+            if(isUAuthAdmin){
+                sqlStatus=SQL_Status::Success;
                 goto end;
             }
-            while(sqlQuery.next()){
-                const QString uauthAdminName {"UAuthAdmin"};
-                const QString nameText {sqlQuery.value("name").toString()};
-                if(uauthAdminName==nameText){
-                    sqlStatus=SQL_Status::Success;
-                    goto end;
-                }
-            }
         }
 
         QStringList userIdRolePermIdList {};
@@ -1811,24 +1998,14 @@ SQL_Status SQL_Handler::getAuthzCheck(const QMap<QString, QString> &queryMap, QS
                     rolePermIdList.push_back(pair.second);
                 }
                 else if(pair.first=="rp_name"){
-                    rolePermNameList.push_back(QStringLiteral("'%1'").arg(pair.second));
+                    rolePermNameList.push_back(pair.second);
                 }
             });
             if(!rolePermNameList.isEmpty()){
-                QString queryText {QStringLiteral("SELECT id from roles_permissions WHERE name IN (%1)").arg(rolePermNameList.join(","))};
-                QSqlQuery sqlQuery {dataBase};
-                if(!sqlQuery.prepare(queryText)){
-                    lastError=sqlQuery.lastError().text();
-                    goto end;
-                }
-                if(!sqlQuery.exec()){
-                    lastError=sqlQuery.lastError().text();
+                rolePermIdList+=getRolePermIdsByNames(dataBase,rolePermNameList,lastError);
+                if(!lastError.isEmpty()){
                     goto end;
                 }
-                while(sqlQuery.next()){
-                    const QString rolePermId {sqlQuery.value(0).toString()};
-                    rolePermIdList.push_back(rolePermId);
-                }
             }
             if(rolePermIdList.isEmpty()){
                 sqlStatus=SQL_Status::Unauthorized;
@@ -1847,6 +2024,14 @@ end:
 }
 //Check That User Authorized variant_old
 SQL_Status SQL_Handler::getAuthzCheck(const QString &userId, const QString &rolePermIdent, QString &lastError)
+{
+    //a cached decision answers without opening a connection
+    return checkDecisionCache(userId,rolePermIdent,[&](QString& computeError){
+        return computeAuthzCheck(userId,rolePermIdent,computeError);
+    },lastError);
+}
+
+SQL_Status SQL_Handler::computeAuthzCheck(const QString &userId, const QString &rolePermIdent, QString &lastError)
 {
     SQL_Status sqlStatus {SQL_Status::BadRequest};
     const QString driverName {"QPSQL"};
@@ -1858,7 +2043,137 @@ SQL_Status SQL_Handler::getAuthzCheck(const QString &userId, const QString &role
             goto end;
         }
         {//authorize
-            sqlStatus=checkIsAuthorized(dataBase,userId,rolePermIdent,lastError);
+            sqlStatus=computeIsAuthorized(dataBase,userId,rolePermIdent,lastError);
+            goto end;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+
+//Check Many Users And Roles/Permissions At Once
+SQL_Status SQL_Handler::getAuthzBatch(const QJsonArray &inChecksArray, QJsonArray &outResultsArray, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    const QRegularExpression re {"^([0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12})$"};
+    //invalid items are answered with their own error, the others are resolved together
+    QVector<QPair<QString,QStringList>> checks(inChecksArray.size());
+    QJsonArray resultsArray {};
+    QSet<QString> userIds {};
+    QSet<QString> rolePermIds {};
+    QSet<QString> rolePermNames {};
+    {//check
+        for(int i=0;i<inChecksArray.size();++i){
+            const QJsonObject checkObject {inChecksArray.at(i).toObject()};
+            const QString userId {checkObject.value("user_id").toString().toLower()};
+            const QString rolePermIdent {checkObject.value("role_permission").toString()};
+            if(!re.match(userId).hasMatch() || rolePermIdent.trimmed().isEmpty()){
+                resultsArray.push_back(QJsonObject {
+                                           {"error","'user_id' must be uuid and 'role_permission' id or names"}
+                                       });
+                continue;
+            }
+            const QStringList rolePermIdents {re.match(rolePermIdent.toLower()).hasMatch() ? QStringList {rolePermIdent.toLower()}
+                                                                                            : rolePermIdent.split(" ",QString::SkipEmptyParts)};
+            checks[i]=qMakePair(userId,rolePermIdents);
+            resultsArray.push_back(QJsonValue {QJsonValue::Null});
+            userIds.insert(userId);
+            for(const QString& ident: rolePermIdents){
+                if(re.match(ident).hasMatch()){
+                    rolePermIds.insert(ident);
+                }
+                else{
+                    rolePermNames.insert(ident);
+                }
+            }
+        }
+    }
+    if(userIds.isEmpty()){
+        outResultsArray=resultsArray;
+        return SQL_Status::Success;
+    }
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//resolve users, their superuser status and held roles/permissions and the asked roles/permissions with one query
+            const QString queryText {uauthAdminIdsCte + ", held(user_id,id) AS ("
+                                     "SELECT user_id, role_permission_id FROM users_roles_permissions WHERE user_id=ANY(CAST(:userIds AS uuid[])) "
+                                     "UNION "
+                                     "SELECT h.user_id, rpr.child_id FROM roles_permissions_relationship rpr "
+                                     "JOIN held h ON rpr.parent_id = h.id) "
+                                     "SELECT 'user', u.id::text, EXISTS (SELECT 1 FROM users_roles_permissions urp "
+                                     "WHERE urp.user_id=u.id AND urp.role_permission_id IN (SELECT id FROM admin_ids))::text "
+                                     "FROM users u WHERE u.id=ANY(CAST(:userIds AS uuid[])) "
+                                     "UNION ALL "
+                                     "SELECT 'held', user_id::text, id::text FROM held "
+                                     "UNION ALL "
+                                     "SELECT 'role_permission', id::text, name FROM roles_permissions "
+                                     "WHERE id=ANY(CAST(:rolePermIds AS uuid[])) OR name=ANY(CAST(:rolePermNames AS text[]))"};
+            //names may hold any character, so array elements are quoted
+            QStringList quotedNames {};
+            for(const QString& rolePermName: rolePermNames){
+                QString quotedName {rolePermName};
+                quotedName.replace("\\","\\\\").replace("\"","\\\"");
+                quotedNames.push_back("\"" + quotedName + "\"");
+            }
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.prepare(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sqlQuery.bindValue(":userIds",QStringLiteral("{%1}").arg(QStringList {userIds.toList()}.join(",")));
+            sqlQuery.bindValue(":rolePermIds",QStringLiteral("{%1}").arg(QStringList {rolePermIds.toList()}.join(",")));
+            sqlQuery.bindValue(":rolePermNames",QStringLiteral("{%1}").arg(quotedNames.join(",")));
+
+            if(!sqlQuery.exec()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            QHash<QString,bool> superuserByUserIds {};
+            QSet<QString> heldKeys {};
+            QHash<QString,QString> rolePermIdsByIdents {};
+            while(sqlQuery.next()){
+                const QString kind {sqlQuery.value(0).toString()};
+                if(kind=="user"){
+                    superuserByUserIds.insert(sqlQuery.value(1).toString(),sqlQuery.value(2).toString()=="true");
+                }
+                else if(kind=="held"){
+                    heldKeys.insert(sqlQuery.value(1).toString() + ":" + sqlQuery.value(2).toString());
+                }
+                else{
+                    rolePermIdsByIdents.insert(sqlQuery.value(1).toString(),sqlQuery.value(1).toString());
+                    rolePermIdsByIdents.insert(sqlQuery.value(2).toString(),sqlQuery.value(1).toString());
+                }
+            }
+            //unknown users and roles/permissions stay null
+            for(int i=0;i<checks.size();++i){
+                const QString& userId {checks.at(i).first};
+                const QStringList& rolePermIdents {checks.at(i).second};
+                if(userId.isEmpty() || !superuserByUserIds.contains(userId)){
+                    continue;
+                }
+                const bool isKnown {std::all_of(rolePermIdents.begin(),rolePermIdents.end(),[&](const QString& ident){
+                        return rolePermIdsByIdents.contains(ident);
+                    })
+                };
+                if(!isKnown){
+                    continue;
+                }
+                const bool isAllowed {superuserByUserIds.value(userId) ||
+                            std::all_of(rolePermIdents.begin(),rolePermIdents.end(),[&](const QString& ident){
+                                return heldKeys.contains(userId + ":" + rolePermIdsByIdents.value(ident));
+                            })
+                };
+                resultsArray[i]=isAllowed;
+            }
+            outResultsArray=resultsArray;
+            sqlStatus=SQL_Status::Success;
             goto end;
         }
     }
@@ -2025,3 +2340,637 @@ end:
     QSqlDatabase::removeDatabase(connectionName);
     return sqlStatus;
 }
+//Assign And Revoke Roles Or Permissions In Bulk
+SQL_Status SQL_Handler::postAuthzManageBulk(const QString &requesterId, const QJsonObject &inOperationsObject, QJsonObject &outResultObject, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    //pairs are passed to postgres as uuid[] literals and expanded with unnest()
+    QStringList assignUserIds {};
+    QStringList assignRolePermIds {};
+    QStringList revokeUserIds {};
+    QStringList revokeRolePermIds {};
+    {//check
+        const QRegularExpression re {"^([0-9a-f]{8}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{4}-[0-9a-f]{12})$"};
+        const QStringList operationKeys {"assign","revoke"};
+        for(const QString& operationKey: operationKeys){
+            const QJsonValue operationsValue {inOperationsObject.value(operationKey)};
+            if(operationsValue.isUndefined()){
+                continue;
+            }
+            if(!operationsValue.isArray()){
+                lastError=QStringLiteral("Key: '%1' is not array!").arg(operationKey);
+                return sqlStatus;
+            }
+            const QJsonArray operationObjects {operationsValue.toArray()};
+            for(int i=0;i<operationObjects.size();++i){
+                const QJsonObject operationObject {operationObjects.at(i).toObject()};
+                const QString userId {operationObject.value("user_id").toString().toLower()};
+                const QString rolePermId {operationObject.value("role_permission_id").toString().toLower()};
+                if(!re.match(userId).hasMatch() || !re.match(rolePermId).hasMatch()){
+                    lastError=QStringLiteral("Not valid '%1' operation at index %2, 'user_id' and 'role_permission_id' must be uuid!").arg(operationKey).arg(i);
+                    return sqlStatus;
+                }
+                if(operationKey=="assign"){
+                    assignUserIds.push_back(userId);
+                    assignRolePermIds.push_back(rolePermId);
+                }
+                else{
+                    revokeUserIds.push_back(userId);
+                    revokeRolePermIds.push_back(rolePermId);
+                }
+            }
+        }
+    }
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//authorize
+            const QString rolePermIdent {"authorization_manage:update"};
+            const SQL_Status authStatus {checkIsAuthorized(dataBase,requesterId,rolePermIdent,lastError)};
+            if(authStatus!=SQL_Status::Success){
+                sqlStatus=SQL_Status::Unauthorized;
+                goto end;
+            }
+        }
+        {//check all referenced users and roles/permissions exist with one query per table
+            const auto getMissingIds {[&](const QString& tableName,const QStringList& ids,QJsonArray& missingIds){
+                    const QString queryText {QStringLiteral("SELECT DISTINCT t.id FROM unnest(CAST(:ids AS uuid[])) AS t(id) "
+                                                            "WHERE NOT EXISTS (SELECT 1 FROM %1 x WHERE x.id=t.id)").arg(tableName)};
+                    QSqlQuery sqlQuery {dataBase};
+                    if(!sqlQuery.prepare(queryText)){
+                        lastError=sqlQuery.lastError().text();
+                        return false;
+                    }
+                    sqlQuery.bindValue(":ids",QStringLiteral("{%1}").arg(ids.join(",")));
+                    if(!sqlQuery.exec()){
+                        lastError=sqlQuery.lastError().text();
+                        return false;
+                    }
+                    while(sqlQuery.next()){
+                        missingIds.push_back(sqlQuery.value(0).toString());
+                    }
+                    return true;
+                }
+            };
+            QJsonArray missingUserIds {};
+            QJsonArray missingRolePermIds {};
+            if(!getMissingIds("users",assignUserIds + revokeUserIds,missingUserIds)){
+                goto end;
+            }
+            if(!getMissingIds("roles_permissions",assignRolePermIds + revokeRolePermIds,missingRolePermIds)){
+                goto end;
+            }
+            if(!missingUserIds.isEmpty() || !missingRolePermIds.isEmpty()){
+                outResultObject.insert("missing_user_ids",missingUserIds);
+                outResultObject.insert("missing_role_permission_ids",missingRolePermIds);
+                lastError="Some users or roles/permissions not found, nothing applied";
+                sqlStatus=SQL_Status::UnprocessableEntity;
+                goto end;
+            }
+        }
+        {//apply, revokes go first so a batch can move a user from one role to another
+            if(!dataBase.transaction()){
+                lastError=dataBase.lastError().text();
+                goto end;
+            }
+            int revokedCount {0};
+            int assignedCount {0};
+            {//revoke
+                const QString queryText {"DELETE FROM users_roles_permissions urp "
+                                         "USING unnest(CAST(:userIds AS uuid[]),CAST(:rolePermIds AS uuid[])) AS t(user_id,role_permission_id) "
+                                         "WHERE urp.user_id=t.user_id AND urp.role_permission_id=t.role_permission_id"};
+                QSqlQuery sqlQuery {dataBase};
+                if(!sqlQuery.prepare(queryText)){
+                    lastError=sqlQuery.lastError().text();
+                    dataBase.rollback();
+                    goto end;
+                }
+                sqlQuery.bindValue(":userIds",QStringLiteral("{%1}").arg(revokeUserIds.join(",")));
+                sqlQuery.bindValue(":rolePermIds",QStringLiteral("{%1}").arg(revokeRolePermIds.join(",")));
+                if(!sqlQuery.exec()){
+                    lastError=sqlQuery.lastError().text();
+                    dataBase.rollback();
+                    goto end;
+                }
+                revokedCount=sqlQuery.numRowsAffected();
+            }
+            {//assign
+                const QString createdAt {timeWithTimezone()};
+                const QString queryText {"INSERT INTO users_roles_permissions (created_at,user_id,role_permission_id) "
+                                         "SELECT CAST(:createdAt AS timestamptz), t.user_id, t.role_permission_id "
+                                         "FROM unnest(CAST(:userIds AS uuid[]),CAST(:rolePermIds AS uuid[])) AS t(user_id,role_permission_id) "
+                                         "ON CONFLICT DO NOTHING"};
+                QSqlQuery sqlQuery {dataBase};
+                if(!sqlQuery.prepare(queryText)){
+                    lastError=sqlQuery.lastError().text();
+                    dataBase.rollback();
+                    goto end;
+                }
+                sqlQuery.bindValue(":createdAt",createdAt);
+                sqlQuery.bindValue(":userIds",QStringLiteral("{%1}").arg(assignUserIds.join(",")));
+                sqlQuery.bindValue(":rolePermIds",QStringLiteral("{%1}").arg(assignRolePermIds.join(",")));
+                if(!sqlQuery.exec()){
+                    lastError=sqlQuery.lastError().text();
+                    dataBase.rollback();
+                    goto end;
+                }
+                assignedCount=sqlQuery.numRowsAffected();
+            }
+            if(!dataBase.commit()){
+                lastError=dataBase.lastError().text();
+                goto end;
+            }
+            outResultObject.insert("assigned",assignedCount);
+            outResultObject.insert("revoked",revokedCount);
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Load Roles/Permissions And Hierarchy
+SQL_Status SQL_Handler::getPolicySnapshot(PolicySnapshot &outSnapshot, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        //both tables are read in one transaction, so edges never point to missing rows
+        if(!dataBase.transaction()){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//get roles/permissions
+            const QString queryText {"SELECT id,name,type,description FROM roles_permissions"};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.exec(queryText)){
+                lastError=sqlQuery.lastError().text();
+                dataBase.rollback();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                PolicySnapshot::RolePerm rolePerm {};
+                rolePerm.id=sqlQuery.value(0).toString();
+                rolePerm.name=sqlQuery.value(1).toString();
+                rolePerm.type=sqlQuery.value(2).toString();
+                if(!sqlQuery.value(3).isNull()){
+                    rolePerm.description=sqlQuery.value(3).toString();
+                }
+                outSnapshot.rolePerms.insert(rolePerm.id,rolePerm);
+                outSnapshot.orderedIds.push_back(rolePerm.id);
+                outSnapshot.nameIds.insert(rolePerm.name,rolePerm.id);
+                outSnapshot.typeIds[rolePerm.type].push_back(rolePerm.id);
+            }
+        }
+        {//get hierarchy
+            const QString queryText {"SELECT parent_id,child_id FROM roles_permissions_relationship"};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.exec(queryText)){
+                lastError=sqlQuery.lastError().text();
+                dataBase.rollback();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                const QString parentId {sqlQuery.value(0).toString()};
+                const QString childId {sqlQuery.value(1).toString()};
+                outSnapshot.childIds[parentId].push_back(childId);
+                outSnapshot.parentIds[childId].push_back(parentId);
+            }
+        }
+        dataBase.commit();
+        sqlStatus=SQL_Status::Success;
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get Ids Of Roles/Permissions Assigned To User Directly
+SQL_Status SQL_Handler::getUserAssignedIds(const QString &userId, QStringList &outRolePermIds, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//check user
+            if(!checkUserById(dataBase,userId)){
+                lastError=QString("User with id: '%1' not found!").arg(userId);
+                sqlStatus=SQL_Status::NotFound;
+                goto end;
+            }
+        }
+        {//get assigned
+            const QString queryText {"SELECT role_permission_id FROM users_roles_permissions WHERE user_id=:userId"};
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.prepare(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sqlQuery.bindValue(":userId",userId);
+
+            if(!sqlQuery.exec()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                outRolePermIds.push_back(sqlQuery.value(0).toString());
+            }
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get Reverse Index Of Direct Assignments
+SQL_Status SQL_Handler::getAssignmentIndex(AssignmentIndex &outAssignmentIndex, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//get assignments, ordered so every user list comes out sorted
+            const QString queryText {"SELECT role_permission_id,user_id FROM users_roles_permissions ORDER BY role_permission_id,user_id"};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.exec(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                outAssignmentIndex.userIds[sqlQuery.value(0).toString()].push_back(sqlQuery.value(1).toString());
+            }
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get UAuthAdmin Holders
+SQL_Status SQL_Handler::getUAuthAdminHolders(QSet<QString> &outRolePermIds, QHash<QString, int> &outHeldCounts, quint64 &outGeneration, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//one statement sees one snapshot, so the generation read with the holders is the one they are current at
+            const QString queryText {uauthAdminIdsCte + "SELECT g.seq, a.id, urp.user_id FROM "
+                                                        "(SELECT GREATEST(COALESCE((SELECT MAX(seq) FROM change_log), 0), seq) AS seq "
+                                                        "FROM change_log_trim WHERE id = 1) g "
+                                                        "LEFT JOIN admin_ids a ON true "
+                                                        "LEFT JOIN users_roles_permissions urp ON urp.role_permission_id = a.id"};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.exec(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                outGeneration=sqlQuery.value(0).toULongLong();
+                if(!sqlQuery.isNull(1)){
+                    outRolePermIds.insert(sqlQuery.value(1).toString());
+                }
+                if(!sqlQuery.isNull(2)){
+                    ++outHeldCounts[sqlQuery.value(2).toString()];
+                }
+            }
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get Users By Ids, Keeping Order Of 'userIds'
+SQL_Status SQL_Handler::getUsersByIds(const QStringList &userIds, QJsonArray &outUserObjects, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    if(userIds.isEmpty()){
+        return SQL_Status::Success;
+    }
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//query
+            const QString queryText {"SELECT * FROM users WHERE id=ANY(CAST(:ids AS uuid[]))"};
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.prepare(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sqlQuery.bindValue(":ids",QStringLiteral("{%1}").arg(userIds.join(",")));
+
+            if(!sqlQuery.exec()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            QHash<QString,QJsonObject> userObjects {};
+            while(sqlQuery.next()){
+                QSqlRecord sqlRecord {sqlQuery.record()};
+                const int fieldCount {sqlRecord.count()};
+
+                QJsonObject userObject {};
+                for(int i=0;i<fieldCount;++i){
+                    const QString fieldName {sqlRecord.fieldName(i)};
+                    const QVariant fieldValue {sqlRecord.value(i)};
+                    if(fieldValue.isNull()){
+                        userObject.insert(fieldName,QJsonValue::Null);
+                    }
+                    else{
+                        userObject.insert(fieldName,fieldValue.toString());
+                    }
+                }
+                userObjects.insert(userObject.value("id").toString(),userObject);
+            }
+            //users deleted after the index was built are skipped
+            for(const QString& userId: userIds){
+                const auto it {userObjects.find(userId)};
+                if(it!=userObjects.end()){
+                    outUserObjects.push_back(it.value());
+                }
+            }
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get Hierarchy Statistics
+SQL_Status SQL_Handler::getHierarchyStatsObject(const QString &requesterId, QJsonObject &outStatsObject, QString &lastError)
+{
+    if(getAuthzCheck(requesterId,"role_permission:read",lastError)!=SQL_Status::Success){
+        return SQL_Status::Unauthorized;
+    }
+    if(!policyCachePtr_){
+        lastError="Policy cache not available!";
+        return SQL_Status::BadRequest;
+    }
+    const QSharedPointer<const PolicySnapshot> snapshotPtr {policyCachePtr_->snapshot(*this,lastError)};
+    if(!snapshotPtr){
+        return SQL_Status::BadRequest;
+    }
+    outStatsObject=snapshotPtr->hierarchyStats();
+    return SQL_Status::Success;
+}
+//Get Change Log Page
+SQL_Status SQL_Handler::getChangesObject(const QMap<QString, QString> &queryMap, const QString &requesterId, QJsonObject &outChangesObject, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    //table names as in '/export/<objects>'
+    const QMap<QString,QString> objectsNameMap {
+        {"users","users"},
+        {"roles_permissions","roles-permissions"},
+        {"roles_permissions_relationship","hierarchy"},
+        {"users_roles_permissions","assignments"}
+    };
+    const int maxLimit {10000};
+    qint64 sinceSeq {0};
+    QDateTime sinceTime {};
+    int queryLimit {1000};
+    {//parse params
+        //'since' is the 'next' token of a previous page or a point in time, none is the whole history
+        const QString since {queryMap.value("since")};
+        bool isOk {true};
+        if(!since.isEmpty()){
+            sinceSeq=since.toLongLong(&isOk);
+            if(!isOk){
+                sinceTime=QDateTime::fromString(since,Qt::ISODateWithMs);
+                isOk=sinceTime.isValid();
+            }
+        }
+        if(!isOk || sinceSeq < 0){
+            lastError=QStringLiteral("Parameter 'since' incorrect value: %1").arg(since);
+            return SQL_Status::BadRequest;
+        }
+        if(queryMap.contains("limit")){
+            queryLimit=queryMap.value("limit").toInt(&isOk);
+            if(!isOk || queryLimit < 1 || queryLimit > maxLimit){
+                lastError=QStringLiteral("Parameter 'limit' incorrect value: %1, allowed 1-%2").arg(queryMap.value("limit")).arg(maxLimit);
+                return SQL_Status::BadRequest;
+            }
+        }
+    }
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//authorize, the log carries users and roles/permissions alike
+            const QString rolePermIdent {"user:read role_permission:read"};
+            const SQL_Status authStatus {checkIsAuthorized(dataBase,requesterId,rolePermIdent,lastError)};
+            if(authStatus!=SQL_Status::Success){
+                sqlStatus=SQL_Status::Unauthorized;
+                goto end;
+            }
+        }
+        if(sinceTime.isValid()){//resolve timestamp to the last sequence before it, a trimmed one to before the trim
+            const QString queryText {"SELECT CASE WHEN :since <= t.changed_at THEN t.seq - 1 ELSE "
+                                     "COALESCE((SELECT MIN(seq) FROM change_log WHERE changed_at >= :since) - 1, "
+                                     "(SELECT MAX(seq) FROM change_log), 0) END FROM change_log_trim t WHERE t.id = 1"};
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.prepare(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sqlQuery.bindValue(":since",sinceTime);
+            if(!sqlQuery.exec() || !sqlQuery.next()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sinceSeq=sqlQuery.value(0).toLongLong();
+        }
+        {//query, one row more than asked tells whether another page follows
+            const QString queryText {"SELECT seq, changed_at, table_name, operation, row_data FROM change_log "
+                                     "WHERE seq > :since ORDER BY seq LIMIT :limit"};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.prepare(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sqlQuery.bindValue(":since",sinceSeq);
+            sqlQuery.bindValue(":limit",queryLimit + 1);
+            if(!sqlQuery.exec()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            QJsonArray changeObjects {};
+            qint64 nextSeq {sinceSeq};
+            bool hasMore {false};
+            while(sqlQuery.next()){
+                if(changeObjects.size()==queryLimit){
+                    hasMore=true;
+                    break;
+                }
+                nextSeq=sqlQuery.value(0).toLongLong();
+                const QString tableName {sqlQuery.value(2).toString()};
+                const QVariant rowData {sqlQuery.value(4)};
+                QJsonObject changeObject {};
+                changeObject.insert("seq",nextSeq);
+                changeObject.insert("changed_at",sqlQuery.value(1).toString());
+                changeObject.insert("objects",objectsNameMap.value(tableName,tableName));
+                changeObject.insert("operation",sqlQuery.value(3).toString());
+                if(rowData.isNull()){
+                    changeObject.insert("data",QJsonValue::Null);
+                }
+                else{
+                    changeObject.insert("data",QJsonDocument::fromJson(rowData.toString().toUtf8()).object());
+                }
+                changeObjects.push_back(changeObject);
+            }
+            outChangesObject.insert("limit",queryLimit);
+            outChangesObject.insert("count",changeObjects.size());
+            outChangesObject.insert("items",changeObjects);
+            outChangesObject.insert("next",QString::number(nextSeq));
+            outChangesObject.insert("has_more",hasMore);
+            outChangesObject.insert("reset",false);
+        }
+        {//check retention after the page was read, a trim meanwhile only makes the answer a reset
+            const QString queryText {"SELECT t.seq, COALESCE((SELECT MAX(seq) FROM change_log), t.seq) FROM change_log_trim t WHERE t.id = 1"};
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.exec(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            if(sqlQuery.next() && sinceSeq < sqlQuery.value(0).toLongLong()){
+                //rows after 'since' were removed, the client resyncs from '/export' and continues after 'next'
+                outChangesObject.insert("count",0);
+                outChangesObject.insert("items",QJsonArray {});
+                outChangesObject.insert("next",QString::number(sqlQuery.value(1).toLongLong()));
+                outChangesObject.insert("has_more",false);
+                outChangesObject.insert("reset",true);
+            }
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get Generation
+SQL_Status SQL_Handler::getGeneration(quint64 &outGeneration, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//query, a trimmed log still counts up to its last removed row
+            const QString queryText {"SELECT GREATEST(COALESCE((SELECT MAX(seq) FROM change_log), 0), seq) FROM change_log_trim WHERE id = 1"};
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.exec(queryText) || !sqlQuery.next()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            outGeneration=sqlQuery.value(0).toULongLong();
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
+//Get Change Log Rows
+SQL_Status SQL_Handler::getChangeLogRows(qint64 sinceSeq, qint64 untilSeq, int maxRows, QJsonArray &outRowObjects, bool &outIsReset, QString &lastError)
+{
+    SQL_Status sqlStatus {SQL_Status::BadRequest};
+    const QString driverName {"QPSQL"};
+    const QString connectionName {QUuid::createUuid().toString(QUuid::WithoutBraces)};
+    outIsReset=false;
+    {
+        QSqlDatabase dataBase {QSqlDatabase::addDatabase(driverName,connectionName)};
+        if(!initDatabase(dataBase)){
+            lastError=dataBase.lastError().text();
+            goto end;
+        }
+        {//check 'since' is still in the log and not ahead of it
+            const QString queryText {"SELECT seq, GREATEST(COALESCE((SELECT MAX(seq) FROM change_log), 0), seq) FROM change_log_trim WHERE id = 1"};
+            QSqlQuery sqlQuery {dataBase};
+            if(!sqlQuery.exec(queryText) || !sqlQuery.next()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            if(sinceSeq < sqlQuery.value(0).toLongLong() || sinceSeq > sqlQuery.value(1).toLongLong()){
+                outIsReset=true;
+                sqlStatus=SQL_Status::Success;
+                goto end;
+            }
+        }
+        {//query, one row more than allowed tells a resync is cheaper
+            const QString queryText {"SELECT seq, table_name, operation, row_data, old_data FROM change_log "
+                                     "WHERE seq > :since AND seq <= :until ORDER BY seq LIMIT :limit"};
+            QSqlQuery sqlQuery {dataBase};
+            sqlQuery.setForwardOnly(true);
+            if(!sqlQuery.prepare(queryText)){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            sqlQuery.bindValue(":since",sinceSeq);
+            sqlQuery.bindValue(":until",untilSeq);
+            sqlQuery.bindValue(":limit",maxRows + 1);
+            if(!sqlQuery.exec()){
+                lastError=sqlQuery.lastError().text();
+                goto end;
+            }
+            while(sqlQuery.next()){
+                if(outRowObjects.size()==maxRows){
+                    outIsReset=true;
+                    outRowObjects=QJsonArray {};
+                    break;
+                }
+                outRowObjects.push_back(QJsonObject {
+                                            {"seq",sqlQuery.value(0).toLongLong()},
+                                            {"table_name",sqlQuery.value(1).toString()},
+                                            {"operation",sqlQuery.value(2).toString()},
+                                            {"row_data",QJsonDocument::fromJson(sqlQuery.value(3).toString().toUtf8()).object()},
+                                            {"old_data",QJsonDocument::fromJson(sqlQuery.value(4).toString().toUtf8()).object()}
+                                        });
+            }
+            sqlStatus=SQL_Status::Success;
+        }
+    }
+end:
+    QSqlDatabase::removeDatabase(connectionName);
+    return sqlStatus;
+}
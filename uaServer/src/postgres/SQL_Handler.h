@@ -2,12 +2,15 @@
 #define SQLHANDLER_H
 
 #include <QMap>
+#include <QSet>
+#include <QHash>
 #include <QString>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QStringList>
 #include <QSqlDatabase>
 #include <QSharedPointer>
+#include <functional>
 
 enum class SQL_Status{
     Success,
@@ -19,6 +22,10 @@ enum class SQL_Status{
 };
 
 class QSettings;
+struct PolicySnapshot;
+struct AssignmentIndex;
+class DecisionCache;
+class PolicyCache;
 
 class SQL_Handler
 {
@@ -26,6 +33,8 @@ private:
     const QString usystemNamespace_ {"6ba7b810-9dad-11d1-80b4-00c04fd430c8"};
     QJsonObject paramsObject_ {};
     QSharedPointer<QSettings> appSettingsPtr_  {nullptr};
+    QSharedPointer<DecisionCache> decisionCachePtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
 
     QString timeWithTimezone();
     bool initDatabase(QSqlDatabase& dataBase);
@@ -33,7 +42,15 @@ private:
 
     bool checkUserById(const QSqlDatabase& dataBase,const QString& userId);
     bool checkRolePermById(const QSqlDatabase& dataBase,const QString& rolePermId);
+    QSharedPointer<const PolicySnapshot> getPolicyMirror();
+    bool checkIsUAuthAdmin(const QSqlDatabase& dataBase,const QString& userId,QString& lastError);
+    QStringList getRolePermIdsByNames(const QSqlDatabase& dataBase,const QStringList& rolePermNames,QString& lastError);
     SQL_Status checkIsAuthorized(const QSqlDatabase& dataBase,const QString& userId,const QString& rolePermIdent,QString& lastError);
+    SQL_Status computeIsAuthorized(const QSqlDatabase& dataBase,const QString& userId,const QString& rolePermIdent,QString& lastError);
+    SQL_Status computeAuthzCheck(const QMap<QString,QString>& queryMap,QString& lastError);
+    SQL_Status computeAuthzCheck(const QString& userId,const QString& rolePermIdent,QString& lastError);
+    SQL_Status checkDecisionCache(const QString& userId,const QString& rolePermIdent,
+                                  const std::function<SQL_Status(QString&)>& computeHandler,QString& lastError);
 
     int getTotalUserRolePermsByUserId(const QSqlDatabase& dataBase,const QString& userId,QString& lastError);
     int getTotalUserRolePermsByRolePermId(const QSqlDatabase& dataBase,const QString& rolePermId,QString& lastError);
@@ -46,6 +63,11 @@ public:
     explicit SQL_Handler(QSharedPointer<QSettings> appSettingsPtr);
     ~SQL_Handler()=default;
 
+    //Share Authorization Decisions Between Handlers, Null Disables Caching
+    void setDecisionCache(QSharedPointer<DecisionCache> decisionCachePtr);
+    //Resolve Role/Permission Names On Cached Snapshot, Null Queries Database
+    void setPolicyCache(QSharedPointer<PolicyCache> policyCachePtr);
+
     //Get Users
     SQL_Status getUsersObject(const QMap<QString,QString>& queryMap,const QString& requesterId,QJsonObject& outUsersObject,QString& lastError);
     //Get User
@@ -83,11 +105,38 @@ public:
     //Check That User Authorized
     SQL_Status getAuthzCheck(const QMap<QString,QString>& queryMap,QString& lastError);
     SQL_Status getAuthzCheck(const QString& userId, const QString& rolePermIdent,QString& lastError);
+    //Check Many Users And Roles/Permissions With One Query: true, false, null For Unknown User
+    //Or Role/Permission, {"error"} For Invalid Item; Same Order As 'inChecksArray'
+    SQL_Status getAuthzBatch(const QJsonArray& inChecksArray,QJsonArray& outResultsArray,QString& lastError);
 
     //Assign Role Or Permission To User
     SQL_Status postAuthzManage(const QString& userId,const QString& rolePermId,const QString& requesterId,QJsonObject& outRolePermObject,QString& lastError);
     //Delete Role Or Permission From User
     SQL_Status deleteAuthzManage(const QString& userId,const QString& rolePermId,const QString& requesterId,QJsonObject& outRolePermObject,QString& lastError);
+    //Assign And Revoke Roles Or Permissions In Bulk
+    SQL_Status postAuthzManageBulk(const QString& requesterId,const QJsonObject& inOperationsObject,QJsonObject& outResultObject,QString& lastError);
+
+    //Load Roles/Permissions And Hierarchy For PolicyCache
+    SQL_Status getPolicySnapshot(PolicySnapshot& outSnapshot,QString& lastError);
+    //Get Ids Of Roles/Permissions Assigned To User Directly
+    SQL_Status getUserAssignedIds(const QString& userId,QStringList& outRolePermIds,QString& lastError);
+    //Get Reverse Index Of Direct Assignments (Role/Permission Id To User Ids)
+    SQL_Status getAssignmentIndex(AssignmentIndex& outAssignmentIndex,QString& lastError);
+    //Get 'UAuthAdmin' With Roles/Permissions Above It And How Many Of Them Each User Holds,
+    //At 'outGeneration' Of Change Log
+    SQL_Status getUAuthAdminHolders(QSet<QString>& outRolePermIds,QHash<QString,int>& outHeldCounts,quint64& outGeneration,QString& lastError);
+    //Get Users By Ids, Keeping Order Of 'userIds'
+    SQL_Status getUsersByIds(const QStringList& userIds,QJsonArray& outUserObjects,QString& lastError);
+    //Get Hierarchy Statistics (Depth, Fan-Out) From Cached Snapshot
+    SQL_Status getHierarchyStatsObject(const QString& requesterId,QJsonObject& outStatsObject,QString& lastError);
+
+    //Get Page Of Change Log After Sequence Or Timestamp ('since'), For Incremental Sync
+    SQL_Status getChangesObject(const QMap<QString,QString>& queryMap,const QString& requesterId,QJsonObject& outChangesObject,QString& lastError);
+    //Get Last Change Log Sequence, It Covers Every Write Committed Before The Call
+    SQL_Status getGeneration(quint64& outGeneration,QString& lastError);
+    //Get Change Log Rows After 'sinceSeq' Up To 'untilSeq' For Change Feed Resume; 'outIsReset' When
+    //Some Are Trimmed, There Are More Than 'maxRows' Or 'sinceSeq' Is Not Of This Database
+    SQL_Status getChangeLogRows(qint64 sinceSeq,qint64 untilSeq,int maxRows,QJsonArray& outRowObjects,bool& outIsReset,QString& lastError);
 };
 
 #endif // SQLHANDLER_H
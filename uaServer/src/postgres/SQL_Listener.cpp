@@ -0,0 +1,293 @@
+#include "SQL_Listener.h"
+#include "../cache/VersionStore.h"
+#include "../feed/ChangeFeed.h"
+#include "../authz/PolicyCache.h"
+
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlDatabase>
+#include <QHash>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+bool SQL_Listener::isConnected(QSqlDatabase &dataBase) const
+{
+    if(!dataBase.isOpen()){
+        return false;
+    }
+    //an idle connection does not notice a dropped server on its own
+    QSqlQuery sqlQuery {dataBase};
+    return sqlQuery.exec("SELECT 1");
+}
+
+bool SQL_Listener::restart(QSqlDatabase &dataBase, QString &lastError)
+{
+    quint64 generation {0};
+    quint64 trimSequence {0};
+    QString databaseId {};
+    QHash<QString,quint64> tableVersions {};
+    {//rows removed by retention count as changed at the last of them
+        const QString queryText {"SELECT GREATEST(COALESCE((SELECT MAX(seq) FROM change_log), 0), seq), seq, database_id FROM change_log_trim WHERE id = 1"};
+        QSqlQuery sqlQuery {dataBase};
+        if(!sqlQuery.exec(queryText) || !sqlQuery.next()){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        generation=sqlQuery.value(0).toULongLong();
+        trimSequence=sqlQuery.value(1).toULongLong();
+        databaseId=sqlQuery.value(2).toString();
+    }
+    //nothing was lost while not connected, catchUp() goes on from the tail; another id is a rebuilt database
+    if(isStarted_ && databaseId==databaseId_ && trimSequence <= tailSequence_ && generation >= tailSequence_){
+        return true;
+    }
+    {//last change of each table, the same on every instance, so they report the same policy version
+        const QString queryText {"SELECT t.table_name, COALESCE((SELECT MAX(c.seq) FROM change_log c WHERE c.table_name = t.table_name), z.seq) "
+                                 "FROM unnest(ARRAY['users', 'roles_permissions', 'roles_permissions_relationship', 'users_roles_permissions']) AS t(table_name), "
+                                 "change_log_trim z WHERE z.id = 1"};
+        QSqlQuery sqlQuery {dataBase};
+        if(!sqlQuery.exec(queryText)){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        while(sqlQuery.next()){
+            tableVersions.insert(sqlQuery.value(0).toString(),sqlQuery.value(1).toULongLong());
+        }
+    }
+    //changes before are unknown, entities are treated as changed
+    versionStorePtr_->setDatabaseId(databaseId);
+    versionStorePtr_->reset(generation,tableVersions);
+    if(changeFeedPtr_){
+        //open sessions missed the trimmed rows, resuming ones find out from the log
+        if(isStarted_){
+            changeFeedPtr_->publish(static_cast<qint64>(generation),QJsonObject {{"type","reset"},{"table","*"}});
+        }
+        changeFeedPtr_->restart(static_cast<qint64>(generation));
+    }
+    tailSequence_=generation;
+    databaseId_=databaseId;
+    isStarted_=true;
+    return true;
+}
+
+void SQL_Listener::applyChange(quint64 sequence, const QString &tableName, const QString &operation,
+                               const QJsonObject &rowObject, const QJsonObject &oldObject)
+{
+    if(changeFeedPtr_){
+        const QJsonObject eventObject {ChangeFeed::makeEventObject(tableName,operation,rowObject,oldObject)};
+        if(!eventObject.isEmpty()){
+            changeFeedPtr_->publish(static_cast<qint64>(sequence),eventObject);
+        }
+    }
+    if(policyCachePtr_){
+        policyCachePtr_->applyChange(sequence,tableName,operation,rowObject);
+    }
+    if(operation=="truncate"){
+        versionStorePtr_->bumpTable(tableName,sequence);
+        return;
+    }
+    if(tableName=="users" || tableName=="roles_permissions"){
+        versionStorePtr_->bumpEntity(tableName,rowObject.value("id").toString(),sequence);
+    }
+    else if(tableName=="users_roles_permissions"){
+        versionStorePtr_->bumpEntity(tableName,rowObject.value("user_id").toString(),sequence);
+    }
+    else if(tableName=="roles_permissions_relationship"){
+        //an edge changes what every holder above it may do
+        versionStorePtr_->bumpTable(tableName,sequence);
+    }
+}
+
+void SQL_Listener::notificationSlot(const QString &name, QSqlDriver::NotificationSource source, const QVariant &payload)
+{
+    Q_UNUSED(source)
+    Q_UNUSED(payload)
+    if(name!=channelName_){
+        return;
+    }
+    QString lastError {};
+    if(!catchUp(lastError)){
+        const QString logMsg {QStringLiteral("Change log not applied, error: %1").arg(lastError)};
+        qWarning(qPrintable(logMsg));
+    }
+}
+
+SQL_Listener::SQL_Listener(QSharedPointer<QSettings> appSettingsPtr, QSharedPointer<VersionStore> versionStorePtr, QObject *parent)
+    :QObject{parent},appSettingsPtr_{appSettingsPtr},versionStorePtr_{versionStorePtr}
+{
+}
+
+SQL_Listener::~SQL_Listener()
+{
+    {
+        QSqlDatabase dataBase {QSqlDatabase::database(connectionName_,false)};
+        if(dataBase.isOpen()){
+            dataBase.driver()->unsubscribeFromNotification(channelName_);
+            dataBase.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName_);
+}
+
+void SQL_Listener::setChangeFeed(QSharedPointer<ChangeFeed> changeFeedPtr)
+{
+    changeFeedPtr_=changeFeedPtr;
+}
+
+void SQL_Listener::setPolicyCache(QSharedPointer<PolicyCache> policyCachePtr)
+{
+    policyCachePtr_=policyCachePtr;
+}
+
+bool SQL_Listener::start(QString &lastError)
+{
+    if(isListening()){
+        return true;
+    }
+    QSqlDatabase dataBase {QSqlDatabase::contains(connectionName_) ? QSqlDatabase::database(connectionName_,false)
+                                                                   : QSqlDatabase::addDatabase("QPSQL",connectionName_)};
+    if(!isConnected(dataBase)){
+        dataBase.close();
+        dataBase.setPort(appSettingsPtr_->value("UA_DB_PORT").toInt());
+        dataBase.setHostName(appSettingsPtr_->value("UA_DB_HOST").toString());
+        dataBase.setDatabaseName(appSettingsPtr_->value("UA_DB_NAME").toString());
+        if(!dataBase.open(appSettingsPtr_->value("UA_DB_USER").toString(),appSettingsPtr_->value("UA_DB_PASS").toString())){
+            lastError=dataBase.lastError().text();
+            return false;
+        }
+        QObject::connect(dataBase.driver(),QOverload<const QString&,QSqlDriver::NotificationSource,const QVariant&>::of(&QSqlDriver::notification),
+                         this,&SQL_Listener::notificationSlot,Qt::UniqueConnection);
+        //subscribed before the generation is read, so no change falls in between; a failed
+        //subscription is retried below and the log is polled meanwhile
+        dataBase.driver()->subscribeToNotification(channelName_);
+        if(!restart(dataBase,lastError)){
+            dataBase.close();
+            return false;
+        }
+    }
+    if(!dataBase.driver()->subscribedToNotifications().contains(channelName_)
+            && !dataBase.driver()->subscribeToNotification(channelName_)){
+        lastError=dataBase.driver()->lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool SQL_Listener::isListening() const
+{
+    if(!QSqlDatabase::contains(connectionName_)){
+        return false;
+    }
+    QSqlDatabase dataBase {QSqlDatabase::database(connectionName_,false)};
+    const QStringList channelNames {dataBase.isOpen() ? dataBase.driver()->subscribedToNotifications() : QStringList {}};
+    if(!channelNames.contains(channelName_)){
+        return false;
+    }
+    return isConnected(dataBase);
+}
+
+bool SQL_Listener::catchUp(QString &lastError)
+{
+    if(!QSqlDatabase::contains(connectionName_)){
+        lastError="Listener connection not open";
+        return false;
+    }
+    QSqlDatabase dataBase {QSqlDatabase::database(connectionName_,false)};
+    if(!dataBase.isOpen()){
+        lastError="Listener connection not open";
+        return false;
+    }
+    {//a long backlog (bulk import, stalled listener) is not replayed row by row
+        QSqlQuery sqlQuery {dataBase};
+        if(!sqlQuery.exec("SELECT COALESCE(MAX(seq), 0) FROM change_log") || !sqlQuery.next()){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        const quint64 maxSequence {sqlQuery.value(0).toULongLong()};
+        if(maxSequence > tailSequence_ + maxReplay_){
+            const QStringList tableNames {"users","roles_permissions","roles_permissions_relationship","users_roles_permissions"};
+            for(const QString& tableName: tableNames){
+                versionStorePtr_->bumpTable(tableName,maxSequence);
+            }
+            tailSequence_=maxSequence;
+            versionStorePtr_->advance(tailSequence_);
+            //one event for the whole statement instead of a row each
+            if(changeFeedPtr_){
+                changeFeedPtr_->publish(static_cast<qint64>(maxSequence),QJsonObject {{"type","reset"},{"table","*"}});
+            }
+            return true;
+        }
+    }
+    //'seq' is given out at commit under a lock, so the rows visible now are every change up to the last of them
+    const QString queryText {"SELECT seq, table_name, operation, row_data, old_data FROM change_log WHERE seq > :seq ORDER BY seq LIMIT :limit"};
+    const int batchSize {1000};
+    int rowCount {batchSize};
+    while(rowCount==batchSize){
+        QSqlQuery sqlQuery {dataBase};
+        sqlQuery.setForwardOnly(true);
+        if(!sqlQuery.prepare(queryText)){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        sqlQuery.bindValue(":seq",tailSequence_);
+        sqlQuery.bindValue(":limit",batchSize);
+        if(!sqlQuery.exec()){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        rowCount=0;
+        while(sqlQuery.next()){
+            const quint64 sequence {sqlQuery.value(0).toULongLong()};
+            const QJsonObject rowObject {QJsonDocument::fromJson(sqlQuery.value(3).toString().toUtf8()).object()};
+            const QJsonObject oldObject {QJsonDocument::fromJson(sqlQuery.value(4).toString().toUtf8()).object()};
+            applyChange(sequence,sqlQuery.value(1).toString(),sqlQuery.value(2).toString(),rowObject,oldObject);
+            tailSequence_=sequence;
+            ++rowCount;
+        }
+        versionStorePtr_->advance(tailSequence_);
+    }
+    return true;
+}
+
+bool SQL_Listener::trimChangeLog(int retentionDays, int &outRemoved, QString &lastError)
+{
+    outRemoved=0;
+    if(!QSqlDatabase::contains(connectionName_)){
+        lastError="Listener connection not open";
+        return false;
+    }
+    QSqlDatabase dataBase {QSqlDatabase::database(connectionName_,false)};
+    if(!dataBase.isOpen()){
+        lastError="Listener connection not open";
+        return false;
+    }
+    //rows are logged in 'seq' order with growing 'changed_at', so every batch cuts a prefix of the log;
+    //small batches keep each statement, and the main thread running it, short
+    const QString queryText {"WITH trimmed AS (DELETE FROM change_log WHERE seq IN "
+                             "(SELECT seq FROM change_log WHERE changed_at < clock_timestamp() - make_interval(days => :days) "
+                             "ORDER BY seq LIMIT :limit) RETURNING seq, changed_at), "
+                             "marked AS (UPDATE change_log_trim SET seq = GREATEST(seq, (SELECT MAX(seq) FROM trimmed)), "
+                             "changed_at = GREATEST(changed_at, (SELECT MAX(changed_at) FROM trimmed)) "
+                             "WHERE id = 1 AND EXISTS (SELECT 1 FROM trimmed)) "
+                             "SELECT COUNT(*) FROM trimmed"};
+    const int batchSize {10000};
+    int removed {batchSize};
+    while(removed==batchSize){
+        QSqlQuery sqlQuery {dataBase};
+        if(!sqlQuery.prepare(queryText)){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        sqlQuery.bindValue(":days",retentionDays);
+        sqlQuery.bindValue(":limit",batchSize);
+        if(!sqlQuery.exec() || !sqlQuery.next()){
+            lastError=sqlQuery.lastError().text();
+            return false;
+        }
+        removed=sqlQuery.value(0).toInt();
+        outRemoved+=removed;
+    }
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef SQLLISTENER_H
+#define SQLLISTENER_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QJsonObject>
+#include <QSqlDriver>
+#include <QSqlDatabase>
+#include <QSharedPointer>
+
+class QSettings;
+class VersionStore;
+class ChangeFeed;
+class PolicyCache;
+
+//Follows 'change_log' (see uaTables) on one QPSQL connection and applies every logged
+//row to VersionStore in 'seq' order, so versions are database-wide and caches built on
+//them pick up writes made by other uaServer instances, by uaShell or by plain sql.
+//The 'uauth_changes' channel, notified by statement triggers on users and the policy
+//tables, wakes it up; where LISTEN is not available (e.g. behind a transaction pooling
+//proxy) catchUp() is called from the integrity check and the log is polled instead.
+//The same rows become ChangeFeed events when a feed is set, a backlog too long to
+//replay becomes one 'reset' event.
+//Lives in the main thread, notifications are delivered by its event loop.
+class SQL_Listener : public QObject
+{
+    Q_OBJECT
+private:
+    const QString connectionName_ {"uauth_listener"};
+    const QString channelName_ {"uauth_changes"};
+    //a longer backlog is applied as one table-wide change per table
+    const quint64 maxReplay_ {10000};
+    QSharedPointer<QSettings> appSettingsPtr_  {nullptr};
+    QSharedPointer<VersionStore> versionStorePtr_ {nullptr};
+    QSharedPointer<ChangeFeed> changeFeedPtr_ {nullptr};
+    QSharedPointer<PolicyCache> policyCachePtr_ {nullptr};
+    quint64 tailSequence_ {0};
+    QString databaseId_ {};
+    bool isStarted_ {false};
+
+    bool isConnected(QSqlDatabase& dataBase) const;
+    //Start The Tail At Current Generation With Last Change Of Each Table, A Reconnect
+    //Keeps It When The Log Still Holds Every Change Since
+    bool restart(QSqlDatabase& dataBase,QString& lastError);
+    void applyChange(quint64 sequence,const QString& tableName,const QString& operation,
+                     const QJsonObject& rowObject,const QJsonObject& oldObject);
+
+private Q_SLOTS:
+    void notificationSlot(const QString& name,QSqlDriver::NotificationSource source,const QVariant& payload);
+
+public:
+    explicit SQL_Listener(QSharedPointer<QSettings> appSettingsPtr,QSharedPointer<VersionStore> versionStorePtr,QObject* parent=nullptr);
+    ~SQL_Listener();
+    void setChangeFeed(QSharedPointer<ChangeFeed> changeFeedPtr);
+    //Assignment Changes Go Into Its Superuser Set One By One
+    void setPolicyCache(QSharedPointer<PolicyCache> policyCachePtr);
+
+    //Connect And Subscribe, Safe To Call Again After Connection Loss, catchUp() Then
+    //Replays What Was Missed. False With An Open Connection Means
+    //Notifications Are Not Available And The Log Has To Be Polled With catchUp()
+    bool start(QString& lastError);
+    bool isListening() const;
+    //Apply Every Change Logged Since The Last Call
+    bool catchUp(QString& lastError);
+    //Remove 'change_log' Rows Older Than 'retentionDays', Oldest First In Batches; Their
+    //Last 'seq' Goes To 'change_log_trim', A Sync From Before It Has To Start Over
+    bool trimChangeLog(int retentionDays,int& outRemoved,QString& lastError);
+};
+
+#endif // SQLLISTENER_H
@@ -1,9 +1,12 @@
+#include <QFile>
 #include <QtCore>
 #include <QString>
 #include <QtGlobal>
 #include <QHostInfo>
 #include <QDateTime>
+#include <QFileInfo>
 #include <QJsonObject>
+#include <QJsonDocument>
 #include <QSharedPointer>
 #include <QCommandLineParser>
 #include <QSqlError>
@@ -11,6 +14,8 @@
 #include <QSqlRecord>
 #include <QSqlDatabase>
 #include <iostream>
+#include "libpq-fe.h"
+#include "postgres/PG_Importer.h"
 #include "../Version.h"
 
 QString timeWithTimezone()
@@ -61,6 +66,65 @@ bool initDatabase(QSqlDatabase& dataBase,const QJsonObject& paramsObject)
     return isDataBaseOk;
 }
 
+QSharedPointer<PGconn> makeConn(const QJsonObject& paramsObject,QString& lastError)
+{
+    const QByteArray UA_DB_NAME {paramsObject.value("UA_DB_NAME").toString().toUtf8()};
+    const QByteArray UA_DB_HOST {paramsObject.value("UA_DB_HOST").toString().toUtf8()};
+    const QByteArray UA_DB_PORT {paramsObject.value("UA_DB_PORT").toString().toUtf8()};
+    const QByteArray UA_DB_USER {paramsObject.value("UA_DB_USER").toString().toUtf8()};
+    const QByteArray UA_DB_PASS {paramsObject.value("UA_DB_PASS").toString().toUtf8()};
+
+    const char* keywords[] {"dbname","host","port","user","password","connect_timeout",nullptr};
+    const char* values[] {UA_DB_NAME.constData(),UA_DB_HOST.constData(),UA_DB_PORT.constData(),
+                          UA_DB_USER.constData(),UA_DB_PASS.constData(),"10",nullptr};
+    QSharedPointer<PGconn> connPtr {PQconnectdbParams(keywords,values,0),&PQfinish};
+    if(PQstatus(connPtr.get())!=CONNECTION_OK){
+        lastError=QString {PQerrorMessage(connPtr.get())};
+        return nullptr;
+    }
+    return connPtr;
+}
+
+bool importUsers(const QJsonObject& paramsObject,const QString& filePath,const QString& format,QString& lastError)
+{
+    QFile usersFile {filePath};
+    if(!usersFile.open(QIODevice::ReadOnly)){
+        lastError=QStringLiteral("Fail to open file '%1', error: %2").arg(filePath,usersFile.errorString());
+        return false;
+    }
+    QSharedPointer<PGconn> connPtr {makeConn(paramsObject,lastError)};
+    if(!connPtr){
+        return false;
+    }
+    QJsonObject outReportObject {};
+    PG_Importer importer {connPtr.get()};
+    if(!importer.importUsers(&usersFile,format,outReportObject,lastError)){
+        return false;
+    }
+    std::cout<<QJsonDocument(outReportObject).toJson().toStdString()<<std::endl;
+    return true;
+}
+
+bool importHierarchy(const QJsonObject& paramsObject,const QString& filePath,QString& lastError)
+{
+    QFile hierarchyFile {filePath};
+    if(!hierarchyFile.open(QIODevice::ReadOnly)){
+        lastError=QStringLiteral("Fail to open file '%1', error: %2").arg(filePath,hierarchyFile.errorString());
+        return false;
+    }
+    QSharedPointer<PGconn> connPtr {makeConn(paramsObject,lastError)};
+    if(!connPtr){
+        return false;
+    }
+    QJsonObject outReportObject {};
+    PG_Importer importer {connPtr.get()};
+    if(!importer.importHierarchy(hierarchyFile.readAll(),outReportObject,lastError)){
+        return false;
+    }
+    std::cout<<QJsonDocument(outReportObject).toJson().toStdString()<<std::endl;
+    return true;
+}
+
 bool postUserObject(QSqlDatabase& dataBase,const QJsonObject& inUserObject,QJsonObject& outUserObject,QString& lastError)
 {
     {//check
@@ -188,13 +252,48 @@ int main(int argc, char *argv[])
         {"id","User id","string"},
         {"email","User email address","string"},
         {"location_id","User location id","string"},
-        {"ou_id","User orgunit id","string"}
+        {"ou_id","User orgunit id","string"},
+        {"import","Import users from NDJSON or CSV file","file"},
+        {"format","Import file format: 'ndjson' or 'csv', taken from file extension if not set","string"},
+        {"import-hierarchy","Import roles/permissions and parent/child edges from JSON file","file"}
     });
     if(!parser.parse(app.arguments())){
         std::cerr<<parser.errorText().toStdString()<<std::endl;
         return 1;
     }
     parser.process(app);
+
+    if(parser.isSet("import")){
+        QString lastError {};
+        QJsonObject paramsObject {};
+        if(!initParams(paramsObject,lastError)){
+            std::cerr<<lastError.toStdString()<<std::endl;
+            return 1;
+        }
+        const QString filePath {parser.value("import")};
+        const QString suffix {QFileInfo(filePath).suffix().toLower()};
+        const QString format {parser.isSet("format") ? parser.value("format") : (suffix=="csv" ? "csv" : "ndjson")};
+        if(!importUsers(paramsObject,filePath,format,lastError)){
+            std::cerr<<lastError.toStdString()<<std::endl;
+            return 1;
+        }
+        std::cout<<"All operations completed success"<<std::endl;
+        return 0;
+    }
+    if(parser.isSet("import-hierarchy")){
+        QString lastError {};
+        QJsonObject paramsObject {};
+        if(!initParams(paramsObject,lastError)){
+            std::cerr<<lastError.toStdString()<<std::endl;
+            return 1;
+        }
+        if(!importHierarchy(paramsObject,parser.value("import-hierarchy"),lastError)){
+            std::cerr<<lastError.toStdString()<<std::endl;
+            return 1;
+        }
+        std::cout<<"All operations completed success"<<std::endl;
+        return 0;
+    }
     QJsonObject inUserObject {};
     const QStringList& optionNames {"id","email","location_id","ou_id",};
 
@@ -200,13 +200,29 @@ bool initTables(QSharedPointer<PGconn> connPtr,QString& lastError)
         }
     }
     {//create table 'users'
+        //'email' is unique at commit, so an import may swap emails between users
         const QString query {"CREATE TABLE IF NOT EXISTS users "
                              "(id uuid PRIMARY KEY NOT NULL, created_at timestamptz NOT NULL, "
                              "updated_at timestamptz NOT NULL, first_name varchar(20) NULL, "
-                             "last_name varchar(20) NULL, email varchar(60) NULL UNIQUE, is_blocked boolean NOT NULL, "
+                             "last_name varchar(20) NULL, email varchar(60) NULL, is_blocked boolean NOT NULL, "
                              "phone_number varchar NULL, position varchar NULL, "
                              "gender gender NULL, location_id uuid NOT NULL, "
-                             "ou_id uuid NOT NULL)"};
+                             "ou_id uuid NOT NULL, "
+                             "CONSTRAINT users_email_key UNIQUE (email) DEFERRABLE INITIALLY DEFERRED)"};
+        resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
+        if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            return false;
+        }
+    }
+    {//defer 'users_email_key' of a table created before it was deferrable, only foreign keys can be altered in place
+        const QString query {"DO $$ BEGIN "
+                             "IF EXISTS (SELECT 1 FROM pg_constraint WHERE conrelid='users'::regclass "
+                             "AND conname='users_email_key' AND NOT condeferrable) THEN "
+                             "ALTER TABLE users DROP CONSTRAINT users_email_key, "
+                             "ADD CONSTRAINT users_email_key UNIQUE (email) DEFERRABLE INITIALLY DEFERRED; "
+                             "END IF; "
+                             "END $$"};
         resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
         if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
             lastError=QString {PQresultErrorMessage(resPtr.get())};
@@ -254,6 +270,109 @@ bool initTables(QSharedPointer<PGconn> connPtr,QString& lastError)
             return false;
         }
     }
+    {//create function 'uauth_notify_change', uaServer listens on 'uauth_changes' to refresh its caches and change feed
+        const QString query {"CREATE OR REPLACE FUNCTION uauth_notify_change() RETURNS trigger AS $$ "
+                             "BEGIN PERFORM pg_notify('uauth_changes', TG_TABLE_NAME); RETURN NULL; END; "
+                             "$$ LANGUAGE plpgsql"};
+        resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
+        if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            return false;
+        }
+    }
+    {//create statement triggers for 'uauth_notify_change', one notification per write statement
+        const QStringList tableNames {"users","roles_permissions","roles_permissions_relationship","users_roles_permissions"};
+        for(const QString& tableName: tableNames){
+            const QStringList queries {
+                QStringLiteral("DROP TRIGGER IF EXISTS uauth_notify_change ON %1").arg(tableName),
+                QStringLiteral("CREATE TRIGGER uauth_notify_change AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON %1 "
+                               "FOR EACH STATEMENT EXECUTE PROCEDURE uauth_notify_change()").arg(tableName)
+            };
+            for(const QString& query: queries){
+                resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
+                if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
+                    lastError=QString {PQresultErrorMessage(resPtr.get())};
+                    return false;
+                }
+            }
+        }
+    }
+    {//create table 'change_log', append-only history served by 'GET /changes?since=', primary key indexes 'seq'
+        //'change_log_trim' keeps the last row removed by retention (see SQL_Listener), an older 'since' can not be served,
+        //and 'database_id', made once with the database, so versions of a rebuilt one are never taken for the same
+        //'seq' is also the version uaServer reports, last change of a table is read through 'change_log_table_seq_idx'
+        const QStringList queries {
+            "CREATE TABLE IF NOT EXISTS change_log "
+            "(seq bigserial PRIMARY KEY, changed_at timestamptz NOT NULL DEFAULT clock_timestamp(), "
+            "table_name varchar NOT NULL, operation varchar NOT NULL, row_data jsonb NULL, old_data jsonb NULL)",
+            "CREATE INDEX IF NOT EXISTS change_log_changed_at_idx ON change_log (changed_at)",
+            "CREATE INDEX IF NOT EXISTS change_log_table_seq_idx ON change_log (table_name, seq)",
+            "CREATE TABLE IF NOT EXISTS change_log_trim "
+            "(id integer PRIMARY KEY CHECK (id = 1), seq bigint NOT NULL, changed_at timestamptz NULL, database_id uuid NOT NULL)",
+            QStringLiteral("INSERT INTO change_log_trim (id, seq, database_id) VALUES (1, 0, '%1') ON CONFLICT (id) DO NOTHING")
+                .arg(QUuid::createUuid().toString(QUuid::WithoutBraces))
+        };
+        for(const QString& query: queries){
+            resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
+            if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
+                lastError=QString {PQresultErrorMessage(resPtr.get())};
+                return false;
+            }
+        }
+    }
+    {//create function 'uauth_log_change'
+        //the advisory lock (key 1430337868 'UALG', this database only) is held until commit, so 'seq' order is
+        //commit order and a reader paging by 'seq' never passes a row that commits later with a lower number;
+        //'changed_at' is taken under the lock, so it follows the same order and a timestamp 'since' is exact.
+        //Row changes are logged by a deferred trigger, so the lock only covers the commit of a transaction
+        //and writers of the logged tables wait for each other's commit, not for each other's whole transaction.
+        //Updates keep the old row in 'old_data', the change feed tells renames and blocks from it
+        const QString query {"CREATE OR REPLACE FUNCTION uauth_log_change() RETURNS trigger AS $$ "
+                             "BEGIN "
+                             "PERFORM pg_advisory_xact_lock(1430337868); "
+                             "IF TG_OP = 'TRUNCATE' THEN "
+                             "INSERT INTO change_log (changed_at, table_name, operation) VALUES (clock_timestamp(), TG_TABLE_NAME, 'truncate'); "
+                             "RETURN NULL; "
+                             "END IF; "
+                             "IF TG_OP = 'DELETE' OR (TG_OP = 'UPDATE' AND TG_TABLE_NAME IN "
+                             "('roles_permissions_relationship', 'users_roles_permissions')) THEN "
+                             "INSERT INTO change_log (changed_at, table_name, operation, row_data) VALUES (clock_timestamp(), TG_TABLE_NAME, 'delete', to_jsonb(OLD)); "
+                             "END IF; "
+                             "IF TG_OP = 'UPDATE' AND TG_TABLE_NAME IN ('users', 'roles_permissions') THEN "
+                             "INSERT INTO change_log (changed_at, table_name, operation, row_data, old_data) VALUES (clock_timestamp(), TG_TABLE_NAME, 'update', to_jsonb(NEW), to_jsonb(OLD)); "
+                             "ELSIF TG_OP IN ('INSERT', 'UPDATE') THEN "
+                             "INSERT INTO change_log (changed_at, table_name, operation, row_data) VALUES (clock_timestamp(), TG_TABLE_NAME, 'insert', to_jsonb(NEW)); "
+                             "END IF; "
+                             "RETURN NULL; "
+                             "END; "
+                             "$$ LANGUAGE plpgsql"};
+        resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
+        if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
+            lastError=QString {PQresultErrorMessage(resPtr.get())};
+            return false;
+        }
+    }
+    {//create triggers for 'uauth_log_change', links are only inserted and deleted, so their updates are logged as both
+        //row triggers are deferred to commit, truncate can not be deferred and locks at once
+        const QStringList tableNames {"users","roles_permissions","roles_permissions_relationship","users_roles_permissions"};
+        for(const QString& tableName: tableNames){
+            const QStringList queries {
+                QStringLiteral("DROP TRIGGER IF EXISTS uauth_log_change ON %1").arg(tableName),
+                QStringLiteral("CREATE CONSTRAINT TRIGGER uauth_log_change AFTER INSERT OR UPDATE OR DELETE ON %1 "
+                               "DEFERRABLE INITIALLY DEFERRED FOR EACH ROW EXECUTE PROCEDURE uauth_log_change()").arg(tableName),
+                QStringLiteral("DROP TRIGGER IF EXISTS uauth_log_change_truncate ON %1").arg(tableName),
+                QStringLiteral("CREATE TRIGGER uauth_log_change_truncate AFTER TRUNCATE ON %1 "
+                               "FOR EACH STATEMENT EXECUTE PROCEDURE uauth_log_change()").arg(tableName)
+            };
+            for(const QString& query: queries){
+                resPtr.reset(PQexec(connPtr.get(),query.toStdString().c_str()),&PQclear);
+                if(PQresultStatus(resPtr.get()) != PGRES_COMMAND_OK){
+                    lastError=QString {PQresultErrorMessage(resPtr.get())};
+                    return false;
+                }
+            }
+        }
+    }
     return true;
 }
 